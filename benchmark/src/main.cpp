@@ -0,0 +1,876 @@
+// Steps the bundled demos, levels and generated box pyramids for a fixed number of frames and prints the timings of the physics phases as json.
+// Usage: physics_benchmark [--frames <count>] [--solver-iterations <count>] [--threads <count>] [--levels <directory>] [--pyramid <box count>]... [--load-test <body count>]... [--disable-sleeping] [--disable-graph-coloring] [--scalar-contact-solver] [--wide-bvh] [--spatial-hash] [--compare-contact-solvers] [--compare-broadphases] [--circles <count>] [--sweep-and-prune] [--disable-continuous-collision] [--disable-speculative-contacts] [--gjk-narrowphase] [--disable-sat-cache] [--narrowphase-timings] [--substeps <count>] [--raycasts <count>] [--output <path>]
+// The simulation is deterministic so the timings between runs can be compared as long as the arguments are the same.
+
+#include <game/physicsWorld.hpp>
+#include <game/ent.hpp>
+#include <game/demos/pyramidDemo.hpp>
+#include <game/demos/hexagonalPyramidDemo.hpp>
+#include <game/demos/doubleDominoDemo.hpp>
+#include <game/demos/leaningTowerOfLireDemo.hpp>
+#include <game/demos/theoJansenLinkageDemo.hpp>
+#include <utils/timer.hpp>
+#include <utils/simd.hpp>
+#include <json/Json.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+
+struct BenchmarkSettings {
+	i32 frames = 600;
+	float dt = 1.0f / 60.0f;
+	i32 solverIterations = 10;
+	// Every frame is split into this many steps of dt / substeps like in the game.
+	i32 substeps = 1;
+	i32 threads = 1;
+};
+
+// Creates boxCount boxes stacked like in PyramidDemo. The rows are filled starting from the bottom so the top row might not be full. The ground is made wide enough to fit the pyramid.
+static auto loadBoxPyramid(i32 boxCount) -> void {
+	const auto boxSize = 1.0f;
+	const auto gapSize = 0.1f;
+	i32 height = 0;
+	while (height * (height + 1) / 2 < boxCount) {
+		height++;
+	}
+
+	const auto groundWidth = std::max(200.0f, height * (boxSize + boxSize / 4.0f) + 20.0f);
+	ent.body.create(Body{ Vec2{ 0.0f, -50.0f }, BoxCollider{ Vec2{ groundWidth, 100.0f } }, true });
+	i32 created = 0;
+	for (i32 i = height; i >= 1 && created < boxCount; i--) {
+		for (i32 j = 0; j < i && created < boxCount; j++) {
+			const auto y = (height + 1 - i) * (boxSize + gapSize);
+			const auto x = -i * (boxSize / 2.0f + boxSize / 8.0f) + j * (boxSize + boxSize / 4.0f);
+			ent.body.create(Body{ Vec2{ x, y }, BoxCollider{ Vec2{ boxSize } }, false });
+			created++;
+		}
+	}
+}
+
+// The radii of the circles in loadCircles.
+enum class CircleSizes {
+	EQUAL,
+	UNIFORM,
+	MOSTLY_SMALL,
+};
+
+static auto circleSizesName(CircleSizes sizes) -> const char* {
+	switch (sizes) {
+	case CircleSizes::EQUAL: return "equal";
+	case CircleSizes::UNIFORM: return "uniform";
+	case CircleSizes::MOSTLY_SMALL: return "mostly small";
+	}
+	return "";
+}
+
+// Drops circleCount circles into a container, like in a particle simulation. Uses a fixed seed so both broadphases get the same scene.
+static auto loadCircles(i32 circleCount, CircleSizes sizes) -> void {
+	std::mt19937 random{ 1234 };
+	auto randomInRange = [&random](float min, float max) {
+		return min + (max - min) * (static_cast<float>(random() >> 8) / static_cast<float>(1 << 24));
+	};
+	const auto maxRadius = sizes == CircleSizes::MOSTLY_SMALL ? 1.5f : 0.5f;
+	const auto columns = static_cast<i32>(ceil(sqrt(static_cast<float>(circleCount))));
+	const auto spacing = maxRadius * 2.0f + 0.1f;
+	const auto width = columns * spacing;
+	ent.body.create(Body{ Vec2{ 0.0f, -5.0f }, BoxCollider{ Vec2{ width + 20.0f, 10.0f } }, true });
+	const auto wallHeight = (circleCount / columns + 1) * spacing * 2.0f;
+	ent.body.create(Body{ Vec2{ -width / 2.0f - 5.0f, wallHeight / 2.0f }, BoxCollider{ Vec2{ 10.0f, wallHeight } }, true });
+	ent.body.create(Body{ Vec2{ width / 2.0f + 5.0f, wallHeight / 2.0f }, BoxCollider{ Vec2{ 10.0f, wallHeight } }, true });
+	for (i32 i = 0; i < circleCount; i++) {
+		float radius = 0.25f;
+		if (sizes == CircleSizes::UNIFORM) {
+			radius = randomInRange(0.1f, 0.5f);
+		} else if (sizes == CircleSizes::MOSTLY_SMALL) {
+			radius = randomInRange(0.0f, 1.0f) < 0.05f ? 1.5f : 0.2f;
+		}
+		const auto x = -width / 2.0f + (i % columns + 0.5f) * spacing;
+		const auto y = (i / columns + 0.5f) * spacing + 0.5f;
+		ent.body.create(Body{ Vec2{ x, y }, CircleCollider{ radius }, false });
+	}
+}
+
+// A row of boxes sliding without friction along a long ground, so the bodies only move along one axis.
+static auto loadSlidingBoxes(i32 boxCount) -> void {
+	const auto spacing = 1.5f;
+	const auto length = boxCount * spacing;
+	auto ground = ent.body.create(Body{ Vec2{ length, -5.0f }, BoxCollider{ Vec2{ length * 4.0f, 10.0f } }, true });
+	ground->coefficientOfFriction = 0.0f;
+	for (i32 i = 0; i < boxCount; i++) {
+		auto box = ent.body.create(Body{ Vec2{ i * spacing, 0.5f }, BoxCollider{ Vec2{ 1.0f } }, false });
+		box->coefficientOfFriction = 0.0f;
+		// Different speeds so the boxes catch up with each other.
+		box->vel = Vec2{ (i % 3 == 0) ? 6.0f : 4.0f, 0.0f };
+	}
+}
+
+// Concave L and T shapes made of boxes dropped into a container. Every shape is a compound so the broadphases have one leaf per box and the bodies collide with each other through pairs of children.
+static auto loadCompounds(i32 bodyCount) -> void {
+	const auto columns = 20;
+	const auto spacing = 3.0f;
+	const auto width = columns * spacing;
+	ent.body.create(Body{ Vec2{ 0.0f, -5.0f }, BoxCollider{ Vec2{ width + 20.0f, 10.0f } }, true });
+	const auto wallHeight = (bodyCount / columns + 1) * spacing * 2.0f;
+	ent.body.create(Body{ Vec2{ -width / 2.0f - 5.0f, wallHeight / 2.0f }, BoxCollider{ Vec2{ 10.0f, wallHeight } }, true });
+	ent.body.create(Body{ Vec2{ width / 2.0f + 5.0f, wallHeight / 2.0f }, BoxCollider{ Vec2{ 10.0f, wallHeight } }, true });
+	for (i32 i = 0; i < bodyCount; i++) {
+		CompoundCollider compound;
+		compound.children.push_back(CompoundChild{ Transform{ Vec2{ 0.0f, 0.0f }, 0.0f }, BoxCollider{ Vec2{ 2.0f, 0.5f } } });
+		if (i % 2 == 0) {
+			compound.children.push_back(CompoundChild{ Transform{ Vec2{ -0.75f, 0.75f }, 0.0f }, BoxCollider{ Vec2{ 0.5f, 1.0f } } });
+		} else {
+			compound.children.push_back(CompoundChild{ Transform{ Vec2{ 0.0f, 0.75f }, 0.0f }, BoxCollider{ Vec2{ 0.5f, 1.0f } } });
+		}
+		const auto centerOfMass = compound.centerChildren();
+		const auto x = -width / 2.0f + (i % columns + 0.5f) * spacing;
+		const auto y = (i / columns + 0.5f) * spacing + 1.0f;
+		// Rotated so the shapes don't land flat on each other.
+		auto body = ent.body.create(Body{ Vec2{ x, y } + centerOfMass, compound, false });
+		body->transform.rot = Rotation{ (i % 5) * 0.6f };
+	}
+}
+
+// Small circles and boxes shot in random directions inside a box made of thin walls, like the ones made with the line tool. Without continuous collision detection and speculative contacts most of them pass through the walls in the first steps.
+static constexpr float BULLETS_CONTAINER_SIZE = 40.0f;
+static auto loadBullets(i32 bodyCount) -> void {
+	const auto size = BULLETS_CONTAINER_SIZE;
+	const auto wallWidth = 0.05f;
+	ent.body.create(Body{ Vec2{ 0.0f, -size / 2.0f }, BoxCollider{ Vec2{ size, wallWidth } }, true });
+	ent.body.create(Body{ Vec2{ 0.0f, size / 2.0f }, BoxCollider{ Vec2{ size, wallWidth } }, true });
+	ent.body.create(Body{ Vec2{ -size / 2.0f, 0.0f }, BoxCollider{ Vec2{ wallWidth, size } }, true });
+	ent.body.create(Body{ Vec2{ size / 2.0f, 0.0f }, BoxCollider{ Vec2{ wallWidth, size } }, true });
+	std::mt19937 random{ 8765 };
+	auto randomInRange = [&random](float min, float max) {
+		return min + (max - min) * (static_cast<float>(random() >> 8) / static_cast<float>(1 << 24));
+	};
+	for (i32 i = 0; i < bodyCount; i++) {
+		const Collider collider = i % 2 == 0 ? Collider{ CircleCollider{ 0.1f } } : Collider{ BoxCollider{ Vec2{ 0.2f, 0.1f } } };
+		auto body = ent.body.create(Body{ Vec2{ randomInRange(-0.4f, 0.4f), randomInRange(-0.4f, 0.4f) } * size, collider, false });
+		body->vel = Vec2::fromPolar(randomInRange(0.0f, 6.28f), randomInRange(50.0f, 300.0f));
+		body->angularVel = randomInRange(-20.0f, 20.0f);
+	}
+}
+
+static auto bodiesOutsideBulletsContainer() -> i32 {
+	i32 result = 0;
+	for (const auto& [_, body] : ent.body) {
+		const auto& pos = body.transform.pos;
+		if (!body.isStatic() && (std::abs(pos.x) > BULLETS_CONTAINER_SIZE / 2.0f || std::abs(pos.y) > BULLETS_CONTAINER_SIZE / 2.0f)) {
+			result++;
+		}
+	}
+	return result;
+}
+
+// A big static level of boxes, circles and polygons scattered on a jittered grid for the query benchmarks. Returns the size of the square it fills.
+static auto loadQueryLevel(i32 bodyCount) -> float {
+	std::mt19937 random{ 4321 };
+	auto randomInRange = [&random](float min, float max) {
+		return min + (max - min) * (static_cast<float>(random() >> 8) / static_cast<float>(1 << 24));
+	};
+	const auto columns = static_cast<i32>(ceil(sqrt(static_cast<float>(bodyCount))));
+	const auto spacing = 3.0f;
+	for (i32 i = 0; i < bodyCount; i++) {
+		const Vec2 pos{ (i % columns + randomInRange(0.2f, 0.8f)) * spacing, (i / columns + randomInRange(0.2f, 0.8f)) * spacing };
+		Collider collider = CircleCollider{ randomInRange(0.2f, 0.8f) };
+		if (i % 3 == 1) {
+			collider = BoxCollider{ Vec2{ randomInRange(0.3f, 1.5f), randomInRange(0.3f, 1.5f) } };
+		} else if (i % 3 == 2) {
+			collider = ConvexPolygon::regular(3 + i % 5, randomInRange(0.3f, 0.8f));
+		}
+		auto body = ent.body.create(Body{ pos, collider, true });
+		body->transform.rot = Rotation{ randomInRange(0.0f, 6.28f) };
+	}
+	return columns * spacing;
+}
+
+struct PhaseSamples {
+	const char* name;
+	std::vector<float> milliseconds;
+};
+
+static auto phaseStatistics(std::vector<float> samples) -> Json::Value {
+	if (samples.empty()) {
+		return Json::Value::null();
+	}
+	std::sort(samples.begin(), samples.end());
+	float sum = 0.0f;
+	for (const auto sample : samples) {
+		sum += sample;
+	}
+	auto percentile = [&samples](float p) -> float {
+		const auto index = std::min(static_cast<usize>(p * static_cast<float>(samples.size())), samples.size() - 1);
+		return samples[index];
+	};
+	return Json::Value{
+		{ "mean", sum / static_cast<float>(samples.size()) },
+		{ "p50", percentile(0.5f) },
+		{ "p99", percentile(0.99f) },
+	};
+}
+
+// load has to create the entites of the scene. physicsStep is called before each step like Demo::physicsStep.
+static auto runScene(
+	PhysicsWorld& physics,
+	const BenchmarkSettings& settings,
+	const std::string& name,
+	const std::function<bool()>& load,
+	const std::function<void()>& physicsStep = [] {}) -> Json::Value {
+
+	physics.reset();
+	if (!load()) {
+		std::cerr << "failed to load " << name << '\n';
+		return Json::Value::null();
+	}
+	physics.afterLoad();
+	const auto bodyCount = ent.body.aliveCount();
+
+	PhaseSamples phases[]{
+		{ "collideUpdateBvh" },
+		{ "collideDetectCollisions" },
+		{ "collideFindPairs" },
+		{ "collideTotal" },
+		{ "continuousCollision" },
+		{ "solvePrestep" },
+		{ "solveVelocities" },
+		{ "solveTotal" },
+		{ "total" },
+	};
+	for (auto& phase : phases) {
+		phase.milliseconds.reserve(settings.frames);
+	}
+
+	PhysicsProfile lastProfile;
+	i64 enlargedAabbs = 0;
+	i64 shrunkAabbs = 0;
+	i64 speculativeContactPoints = 0;
+	i64 continuousBodies = 0;
+	i64 timeOfImpactHits = 0;
+	i64 satCacheTests = 0;
+	i64 satCacheHits = 0;
+	i64 gjkIterations = 0;
+	i64 wideContactBatches = 0;
+	i64 narrowphasePairs[PhysicsProfile::COLLIDER_TYPE_COUNT][PhysicsProfile::COLLIDER_TYPE_COUNT]{};
+	float narrowphaseMilliseconds[PhysicsProfile::COLLIDER_TYPE_COUNT][PhysicsProfile::COLLIDER_TYPE_COUNT]{};
+	Timer sceneTimer;
+	for (i32 i = 0; i < settings.frames; i++) {
+		ent.update();
+		physics.collisionSystem().update();
+		physicsStep();
+
+		PhysicsProfile profile;
+		Timer timer;
+		for (i32 substep = 0; substep < settings.substeps; substep++) {
+			physics.step(settings.dt / settings.substeps, settings.solverIterations, profile);
+		}
+		profile.total = timer.elapsedMilliseconds();
+
+		const float values[]{
+			profile.collideUpdateBvh,
+			profile.collideDetectCollisions,
+			profile.collideFindPairs,
+			profile.collideTotal,
+			profile.continuousCollision,
+			profile.solvePrestep,
+			profile.solveVelocities,
+			profile.solveTotal,
+			profile.total,
+		};
+		static_assert(std::size(values) == std::size(phases));
+		for (usize phase = 0; phase < std::size(phases); phase++) {
+			phases[phase].milliseconds.push_back(values[phase]);
+		}
+		enlargedAabbs += profile.collideEnlargedAabbs;
+		shrunkAabbs += profile.collideShrunkAabbs;
+		speculativeContactPoints += profile.speculativeContactPoints;
+		continuousBodies += profile.continuousBodies;
+		timeOfImpactHits += profile.timeOfImpactHits;
+		satCacheTests += profile.satCacheTests;
+		satCacheHits += profile.satCacheHits;
+		gjkIterations += profile.gjkIterations;
+		wideContactBatches += profile.wideContactBatches;
+		for (i32 a = 0; a < PhysicsProfile::COLLIDER_TYPE_COUNT; a++) {
+			for (i32 b = 0; b < PhysicsProfile::COLLIDER_TYPE_COUNT; b++) {
+				narrowphasePairs[a][b] += profile.narrowphasePairs[a][b];
+				narrowphaseMilliseconds[a][b] += profile.narrowphaseMilliseconds[a][b];
+			}
+		}
+		lastProfile = profile;
+	}
+	const auto elapsedSeconds = sceneTimer.elapsedMilliseconds() / 1000.0f;
+	// Computed once after the timed steps, because the steps only compute it if PhysicsWorld::bvhStatistics is set.
+	BvhStatistics bvhAtEnd;
+	if (physics.broadphaseType() == PhysicsWorld::BroadphaseType::BVH) {
+		bvhAtEnd = physics.bvhCollisionSystem.statistics();
+	}
+
+	auto phasesJson = Json::Value::emptyObject();
+	for (auto& phase : phases) {
+		phasesJson[phase.name] = phaseStatistics(std::move(phase.milliseconds));
+	}
+
+	std::cerr << name << ": " << settings.frames / elapsedSeconds << " steps/s\n";
+	Json::Value result{
+		{ "name", name },
+		{ "bodies", static_cast<Json::Value::IntType>(bodyCount) },
+		{ "contactsAtEnd", static_cast<Json::Value::IntType>(physics.contacts.size()) },
+		{ "solverIslandsAtEnd", lastProfile.solverIslands },
+		{ "coloredIslandsAtEnd", lastProfile.coloredIslands },
+		{ "graphColorsAtEnd", lastProfile.graphColors },
+		{ "bvhInternalNodeAreaAtEnd", bvhAtEnd.internalNodeArea },
+		{ "bvhMaxDepthAtEnd", bvhAtEnd.maxDepth },
+		{ "bvhAverageLeafDepthAtEnd", bvhAtEnd.averageLeafDepth },
+		{ "stepsPerSecond", settings.frames / elapsedSeconds },
+		{ "enlargedAabbsPerStep", static_cast<float>(enlargedAabbs) / settings.frames },
+		{ "shrunkAabbsPerStep", static_cast<float>(shrunkAabbs) / settings.frames },
+		{ "speculativeContactPointsPerStep", static_cast<float>(speculativeContactPoints) / settings.frames },
+		{ "continuousBodiesPerStep", static_cast<float>(continuousBodies) / settings.frames },
+		{ "timeOfImpactHitsPerStep", static_cast<float>(timeOfImpactHits) / settings.frames },
+		// Summed over all the steps. Zero if the wide contact solver never ran, for example with 1 thread.
+		{ "wideContactBatches", static_cast<Json::Value::IntType>(wideContactBatches) },
+		// The fraction of the pairs with a cached face from the last step for which the full SAT was skipped.
+		{ "satCacheHitRate", satCacheTests == 0 ? 0.0f : static_cast<float>(satCacheHits) / satCacheTests },
+		{ "phases", phasesJson },
+	};
+	if (PhysicsWorld::gjkNarrowphase) {
+		i64 pairs = 0;
+		for (i32 a = 0; a < PhysicsProfile::COLLIDER_TYPE_COUNT; a++) {
+			for (i32 b = 0; b < PhysicsProfile::COLLIDER_TYPE_COUNT; b++) {
+				pairs += narrowphasePairs[a][b];
+			}
+		}
+		result["gjkIterationsPerPair"] = pairs == 0 ? 0.0f : static_cast<float>(gjkIterations) / pairs;
+	}
+	// Only the pair types that occur in the scene.
+	auto narrowphaseJson = Json::Value::emptyObject();
+	for (i32 a = 0; a < PhysicsProfile::COLLIDER_TYPE_COUNT; a++) {
+		for (i32 b = a; b < PhysicsProfile::COLLIDER_TYPE_COUNT; b++) {
+			if (narrowphasePairs[a][b] == 0)
+				continue;
+			auto pairType = Json::Value::emptyObject();
+			pairType["pairsPerStep"] = static_cast<float>(narrowphasePairs[a][b]) / settings.frames;
+			if (PhysicsWorld::narrowphaseTimings) {
+				pairType["millisecondsPerStep"] = narrowphaseMilliseconds[a][b] / settings.frames;
+			}
+			narrowphaseJson[std::string(colliderTypeName(a)) + "-" + colliderTypeName(b)] = pairType;
+		}
+	}
+	result["narrowphase"] = narrowphaseJson;
+	if (lastProfile.coloredIslands != 0) {
+		auto colorConstraints = Json::Value::emptyArray();
+		for (i32 i = 0; i < lastProfile.graphColors; i++) {
+			colorConstraints.array().push_back(lastProfile.graphColorConstraints[i]);
+		}
+		result["graphColorConstraintsAtEnd"] = colorConstraints;
+		result["graphColorOverflowConstraintsAtEnd"] = lastProfile.graphColorOverflowConstraints;
+	}
+#ifdef _DEBUG
+	const auto& ignored = lastProfile.collisionsToIgnore;
+	result["collisionsToIgnore"] = Json::Value{
+		{ "size", static_cast<Json::Value::IntType>(ignored.size) },
+		{ "loadFactor", ignored.loadFactor },
+		{ "maxBucketSize", static_cast<Json::Value::IntType>(ignored.maxBucketSize) },
+		{ "averageProbeLength", ignored.averageProbeLength },
+	};
+#endif
+	return result;
+}
+
+// Creates bodyCount boxes in a grid above a static ground and measures how long it takes to register them in the collision system and how long the broadphase takes in the first step.
+static auto runLoadTest(PhysicsWorld& physics, const BenchmarkSettings& settings, i32 bodyCount, bool bulkBuild) -> Json::Value {
+	const auto oldBulkBuild = BvhCollisionSystem::bulkBuild;
+	BvhCollisionSystem::bulkBuild = bulkBuild;
+	physics.reset();
+	const auto columns = static_cast<i32>(ceil(sqrt(static_cast<float>(bodyCount))));
+	const auto spacing = 1.5f;
+	ent.body.create(Body{ Vec2{ columns * spacing / 2.0f, -50.0f }, BoxCollider{ Vec2{ columns * spacing + 20.0f, 100.0f } }, true });
+	for (i32 i = 0; i < bodyCount; i++) {
+		ent.body.create(Body{ Vec2{ (i % columns) * spacing, (i / columns) * spacing + 1.0f }, BoxCollider{ Vec2{ 1.0f } }, false });
+	}
+
+	Timer loadTimer;
+	physics.afterLoad();
+	const auto loadMilliseconds = loadTimer.elapsedMilliseconds();
+
+	ent.update();
+	physics.collisionSystem().update();
+	PhysicsProfile profile;
+	physics.step(settings.dt, settings.solverIterations, profile);
+	BvhCollisionSystem::bulkBuild = oldBulkBuild;
+	const auto bvh = physics.bvhCollisionSystem.statistics();
+
+	std::cerr << "load test " << bodyCount << (bulkBuild ? " bulk build" : " incremental") << ": " << loadMilliseconds << "ms\n";
+	return Json::Value{
+		{ "bodies", bodyCount },
+		{ "bulkBuild", bulkBuild },
+		{ "loadMilliseconds", loadMilliseconds },
+		{ "firstStepCollideUpdateBvh", profile.collideUpdateBvh },
+		{ "firstStepCollideDetectCollisions", profile.collideDetectCollisions },
+		{ "bvhInternalNodeArea", bvh.internalNodeArea },
+		{ "bvhMaxDepth", bvh.maxDepth },
+		{ "bvhAverageLeafDepth", bvh.averageLeafDepth },
+	};
+}
+
+static constexpr i32 QUERY_LEVEL_BODY_COUNT = 20000;
+
+// Measures the queries of every broadphase with rayCount random rays, boxes and circle casts in the level from loadQueryLevel. The hit counts should be the same for all the broadphases.
+static auto runQueryBenchmark(PhysicsWorld& physics, const BenchmarkSettings& settings, i32 rayCount) -> Json::Value {
+	const auto broadphaseType = physics.broadphaseType();
+	std::mt19937 random{ 5678 };
+	auto randomInRange = [&random](float min, float max) {
+		return min + (max - min) * (static_cast<float>(random() >> 8) / static_cast<float>(1 << 24));
+	};
+	std::vector<Broadphase::Ray> rays;
+	std::vector<Aabb> boxes;
+	std::vector<std::optional<Broadphase::RayHit>> batchedHits(rayCount);
+	std::vector<Broadphase::RayHit> allHits;
+	std::vector<BodyId> bodies;
+
+	auto results = Json::Value::emptyArray();
+	for (const auto type : { PhysicsWorld::BroadphaseType::BVH, PhysicsWorld::BroadphaseType::SPATIAL_HASH, PhysicsWorld::BroadphaseType::SWEEP_AND_PRUNE }) {
+		// Switching before loading like in the broadphase comparison, because reload would add the bodies created this frame twice.
+		physics.setBroadphase(type);
+		physics.reset();
+		const auto levelSize = loadQueryLevel(QUERY_LEVEL_BODY_COUNT);
+		physics.afterLoad();
+		ent.update();
+		physics.collisionSystem().update();
+		PhysicsProfile profile;
+		physics.collisionSystem().updateBvh(settings.dt, profile);
+
+		if (rays.empty()) {
+			for (i32 i = 0; i < rayCount; i++) {
+				const Vec2 start{ randomInRange(0.0f, levelSize), randomInRange(0.0f, levelSize) };
+				const auto angle = randomInRange(0.0f, 6.28f);
+				const auto length = randomInRange(1.0f, 30.0f);
+				rays.push_back(Broadphase::Ray{ start, start + Vec2::fromPolar(angle, length) });
+				boxes.push_back(Aabb::fromPosSize(start, Vec2{ randomInRange(1.0f, 10.0f), randomInRange(1.0f, 10.0f) }));
+			}
+		}
+		const auto& broadphase = physics.collisionSystem();
+
+		auto result = Json::Value::emptyObject();
+		result["broadphase"] = static_cast<i32>(type);
+		auto measure = [&](const char* name, const std::function<i64()>& run) {
+			Timer timer;
+			const auto hits = run();
+			const auto seconds = timer.elapsedMilliseconds() / 1000.0f;
+			result[name] = Json::Value{
+				{ "queriesPerSecond", rayCount / seconds },
+				{ "hits", static_cast<Json::Value::IntType>(hits) },
+			};
+			std::cerr << "queries " << static_cast<i32>(type) << ' ' << name << ": " << rayCount / seconds << " queries/s\n";
+		};
+		measure("raycast", [&] {
+			i64 hits = 0;
+			for (const auto& ray : rays) {
+				hits += broadphase.raycast(ray.start, ray.end).has_value();
+			}
+			return hits;
+		});
+		measure("batchedRaycast", [&] {
+			broadphase.raycast(rays, batchedHits, physics.jobSystem);
+			return std::count_if(batchedHits.begin(), batchedHits.end(), [](const std::optional<Broadphase::RayHit>& hit) { return hit.has_value(); });
+		});
+		measure("raycastAll", [&] {
+			i64 hits = 0;
+			for (const auto& ray : rays) {
+				broadphase.raycastAll(ray.start, ray.end, allHits);
+				hits += allHits.size();
+			}
+			return hits;
+		});
+		measure("circleCast", [&] {
+			i64 hits = 0;
+			for (const auto& ray : rays) {
+				hits += broadphase.circleCast(ray.start, ray.end, 0.25f).has_value();
+			}
+			return hits;
+		});
+		measure("queryAabb", [&] {
+			i64 hits = 0;
+			for (const auto& box : boxes) {
+				bodies.clear();
+				broadphase.queryAabb(box, bodies);
+				hits += bodies.size();
+			}
+			return hits;
+		});
+		results.array().push_back(result);
+	}
+	physics.setBroadphase(broadphaseType);
+	return Json::Value{
+		{ "bodies", QUERY_LEVEL_BODY_COUNT },
+		{ "queries", rayCount },
+		{ "broadphases", results },
+	};
+}
+
+static auto runDemo(PhysicsWorld& physics, const BenchmarkSettings& settings, Demo& demo) -> Json::Value {
+	return runScene(physics, settings, demo.name(),
+		[&demo] {
+			demo.load();
+			return true;
+		},
+		[&demo] {
+			demo.physicsStep();
+		}
+	);
+}
+
+auto main(int argc, char** argv) -> int {
+	BenchmarkSettings settings;
+	fs::path levelsPath = PHYSICS_ENGINE_LEVELS_DIRECTORY;
+	std::vector<i32> pyramidBoxCounts;
+	std::optional<std::string> outputPath;
+	bool compareContactSolvers = false;
+	bool spatialHash = false;
+	bool sweepAndPrune = false;
+	bool compareBroadphases = false;
+	i32 broadphaseCircleCount = 5000;
+	std::vector<i32> loadTestBodyCounts;
+	i32 queryCount = 0;
+
+	try {
+		for (i32 i = 1; i < argc; i++) {
+			const std::string_view arg = argv[i];
+			if (arg == "--disable-sleeping") {
+				PhysicsWorld::sleepingEnabled = false;
+				continue;
+			}
+			if (arg == "--disable-graph-coloring") {
+				PhysicsWorld::graphColoring = false;
+				continue;
+			}
+			if (arg == "--scalar-contact-solver") {
+				PhysicsWorld::wideContactSolver = false;
+				continue;
+			}
+			if (arg == "--disable-continuous-collision") {
+				PhysicsWorld::continuousCollisionDetection = false;
+				continue;
+			}
+			if (arg == "--disable-speculative-contacts") {
+				PhysicsWorld::speculativeContacts = false;
+				continue;
+			}
+			if (arg == "--gjk-narrowphase") {
+				PhysicsWorld::gjkNarrowphase = true;
+				continue;
+			}
+			if (arg == "--disable-sat-cache") {
+				PhysicsWorld::satCache = false;
+				continue;
+			}
+			if (arg == "--narrowphase-timings") {
+				PhysicsWorld::narrowphaseTimings = true;
+				continue;
+			}
+			if (arg == "--wide-bvh") {
+				BvhCollisionSystem::wideTree = true;
+				continue;
+			}
+			if (arg == "--spatial-hash") {
+				spatialHash = true;
+				continue;
+			}
+			if (arg == "--sweep-and-prune") {
+				sweepAndPrune = true;
+				continue;
+			}
+			if (arg == "--compare-broadphases") {
+				compareBroadphases = true;
+				continue;
+			}
+			if (arg == "--compare-contact-solvers") {
+				compareContactSolvers = true;
+				continue;
+			}
+			if (i + 1 >= argc) {
+				throw std::invalid_argument{ "missing value" };
+			}
+			const char* value = argv[++i];
+			if (arg == "--frames") {
+				settings.frames = std::stoi(value);
+			} else if (arg == "--solver-iterations") {
+				settings.solverIterations = std::stoi(value);
+			} else if (arg == "--substeps") {
+				settings.substeps = std::stoi(value);
+			} else if (arg == "--threads") {
+				settings.threads = std::stoi(value);
+			} else if (arg == "--levels") {
+				levelsPath = value;
+			} else if (arg == "--pyramid") {
+				pyramidBoxCounts.push_back(std::stoi(value));
+			} else if (arg == "--circles") {
+				broadphaseCircleCount = std::stoi(value);
+			} else if (arg == "--raycasts") {
+				queryCount = std::stoi(value);
+			} else if (arg == "--load-test") {
+				loadTestBodyCounts.push_back(std::stoi(value));
+			} else if (arg == "--output") {
+				outputPath = value;
+			} else {
+				throw std::invalid_argument{ "unknown argument" };
+			}
+		}
+	} catch (const std::exception&) {
+		std::cerr << "usage: " << argv[0] << " [--frames <count>] [--solver-iterations <count>] [--threads <count>] [--levels <directory>] [--pyramid <box count>]... [--load-test <body count>]... [--disable-sleeping] [--disable-graph-coloring] [--scalar-contact-solver] [--wide-bvh] [--spatial-hash] [--compare-contact-solvers] [--compare-broadphases] [--circles <count>] [--sweep-and-prune] [--disable-continuous-collision] [--disable-speculative-contacts] [--gjk-narrowphase] [--disable-sat-cache] [--narrowphase-timings] [--substeps <count>] [--raycasts <count>] [--output <path>]\n";
+		return EXIT_FAILURE;
+	}
+
+	if (pyramidBoxCounts.empty()) {
+		pyramidBoxCounts = { 100, 1000 };
+	}
+
+	PhysicsWorld physics;
+	physics.jobSystem.setThreadCount(settings.threads);
+	if (spatialHash) {
+		physics.setBroadphase(PhysicsWorld::BroadphaseType::SPATIAL_HASH);
+	} else if (sweepAndPrune) {
+		physics.setBroadphase(PhysicsWorld::BroadphaseType::SWEEP_AND_PRUNE);
+	}
+	auto scenes = Json::Value::emptyArray();
+
+	PyramidDemo pyramid;
+	HexagonalPyramid hexagonalPyramid;
+	DoubleDominoDemo doubleDomino;
+	LeaningTowerOfLireDemo leaningTowerOfLire;
+	TheoJansenLinkageDemo theoJansenLinkage;
+	Demo* demos[]{ &pyramid, &hexagonalPyramid, &doubleDomino, &leaningTowerOfLire, &theoJansenLinkage };
+	for (auto demo : demos) {
+		scenes.array().push_back(runDemo(physics, settings, *demo));
+	}
+
+	// Sorting so the order doesn't depend on the order of the directory iteration.
+	std::vector<fs::path> levelPaths;
+	if (fs::is_directory(levelsPath)) {
+		for (const auto& entry : fs::directory_iterator(levelsPath)) {
+			if (entry.is_regular_file()) {
+				levelPaths.push_back(entry.path());
+			}
+		}
+	} else {
+		std::cerr << "levels directory " << levelsPath << " doesn't exist\n";
+	}
+	std::sort(levelPaths.begin(), levelPaths.end());
+	for (const auto& path : levelPaths) {
+		scenes.array().push_back(runScene(physics, settings, path.filename().string(), [&physics, &path] {
+			const auto level = physics.loadLevelFromFile(path.string().c_str());
+			if (level.has_value()) {
+				std::cerr << *level << '\n';
+			}
+			return !level.has_value();
+		}));
+	}
+
+	for (const auto boxCount : pyramidBoxCounts) {
+		scenes.array().push_back(runScene(physics, settings, "box pyramid " + std::to_string(boxCount), [boxCount] {
+			loadBoxPyramid(boxCount);
+			return true;
+		}));
+	}
+
+	{
+		const auto compoundCount = 500;
+		scenes.array().push_back(runScene(physics, settings, std::to_string(compoundCount) + " compounds", [compoundCount] {
+			loadCompounds(compoundCount);
+			return true;
+		}));
+	}
+
+	{
+		const auto bulletCount = 200;
+		auto bullets = runScene(physics, settings, std::to_string(bulletCount) + " bullets", [bulletCount] {
+			loadBullets(bulletCount);
+			return true;
+		});
+		bullets["bodiesOutsideWallsAtEnd"] = bodiesOutsideBulletsContainer();
+		scenes.array().push_back(bullets);
+	}
+
+	// Runs the pyramids with both contact solvers. The wide solver should give the same results so the differences should be zero or very small.
+	auto contactSolverComparison = Json::Value::emptyArray();
+	if (compareContactSolvers) {
+		const auto wideContactSolver = PhysicsWorld::wideContactSolver;
+		// The wide solver only solves the colored islands, which aren't colored with 1 thread.
+		const auto comparisonThreads = std::max(settings.threads, 2);
+		physics.jobSystem.setThreadCount(comparisonThreads);
+		for (const auto boxCount : pyramidBoxCounts) {
+			std::vector<Body> scalarBodies;
+			Json::Value sceneResults[2];
+			for (i32 i = 0; i < 2; i++) {
+				PhysicsWorld::wideContactSolver = i == 1;
+				const auto name = "box pyramid " + std::to_string(boxCount) + (PhysicsWorld::wideContactSolver ? " wide" : " scalar");
+				sceneResults[i] = runScene(physics, settings, name, [boxCount] {
+					loadBoxPyramid(boxCount);
+					return true;
+				});
+				if (i == 0) {
+					for (const auto& [_, body] : ent.body) {
+						scalarBodies.push_back(body);
+					}
+				}
+			}
+			float maxPositionDifference = 0.0f;
+			float maxVelocityDifference = 0.0f;
+			usize bodyIndex = 0;
+			for (const auto& [_, body] : ent.body) {
+				const auto& scalarBody = scalarBodies[bodyIndex];
+				maxPositionDifference = std::max(maxPositionDifference, (body.transform.pos - scalarBody.transform.pos).length());
+				maxVelocityDifference = std::max(maxVelocityDifference, (body.vel - scalarBody.vel).length());
+				bodyIndex++;
+			}
+			contactSolverComparison.array().push_back(Json::Value{
+				{ "name", "box pyramid " + std::to_string(boxCount) },
+				{ "scalarStepsPerSecond", sceneResults[0]["stepsPerSecond"] },
+				{ "wideStepsPerSecond", sceneResults[1]["stepsPerSecond"] },
+				{ "scalarSolveVelocities", sceneResults[0]["phases"]["solveVelocities"] },
+				{ "wideSolveVelocities", sceneResults[1]["phases"]["solveVelocities"] },
+				{ "maxPositionDifference", maxPositionDifference },
+				{ "maxVelocityDifference", maxVelocityDifference },
+				{ "threads", comparisonThreads },
+				{ "wideContactBatches", sceneResults[1]["wideContactBatches"] },
+			});
+			if (sceneResults[1]["wideContactBatches"].intNumber() == 0) {
+				std::cerr << "warning: the wide contact solver wasn't used in box pyramid " << boxCount << ", so the comparison doesn't test it\n";
+			}
+		}
+		PhysicsWorld::wideContactSolver = wideContactSolver;
+		physics.jobSystem.setThreadCount(settings.threads);
+	}
+
+	// Runs the scenes with every broadphase. They find the same pairs so the differences from the bvh should be zero.
+	auto broadphaseComparison = Json::Value::emptyArray();
+	if (compareBroadphases) {
+		const auto broadphaseType = physics.broadphaseType();
+		struct ComparedScene {
+			std::string name;
+			std::function<void()> load;
+		};
+		std::vector<ComparedScene> comparedScenes;
+		for (const auto sizes : { CircleSizes::EQUAL, CircleSizes::UNIFORM, CircleSizes::MOSTLY_SMALL }) {
+			comparedScenes.push_back(ComparedScene{
+				std::to_string(broadphaseCircleCount) + " circles " + circleSizesName(sizes),
+				[=] { loadCircles(broadphaseCircleCount, sizes); }
+			});
+		}
+		comparedScenes.push_back(ComparedScene{
+			std::to_string(broadphaseCircleCount) + " sliding boxes",
+			[=] { loadSlidingBoxes(broadphaseCircleCount); }
+		});
+		comparedScenes.push_back(ComparedScene{
+			"500 compounds",
+			[] { loadCompounds(500); }
+		});
+
+		struct ComparedBroadphase {
+			PhysicsWorld::BroadphaseType type;
+			const char* name;
+		};
+		const ComparedBroadphase comparedBroadphases[]{
+			{ PhysicsWorld::BroadphaseType::BVH, "bvh" },
+			{ PhysicsWorld::BroadphaseType::SPATIAL_HASH, "spatial hash" },
+			{ PhysicsWorld::BroadphaseType::SWEEP_AND_PRUNE, "sweep and prune" },
+		};
+		for (const auto& scene : comparedScenes) {
+			std::vector<Body> bvhBodies;
+			auto results = Json::Value::emptyArray();
+			for (const auto& broadphase : comparedBroadphases) {
+				physics.setBroadphase(broadphase.type);
+				const auto sceneResult = runScene(physics, settings, scene.name + " " + broadphase.name, [&scene] {
+					scene.load();
+					return true;
+				});
+				float maxPositionDifference = 0.0f;
+				usize bodyIndex = 0;
+				for (const auto& [_, body] : ent.body) {
+					if (broadphase.type == PhysicsWorld::BroadphaseType::BVH) {
+						bvhBodies.push_back(body);
+					} else {
+						maxPositionDifference = std::max(maxPositionDifference, (body.transform.pos - bvhBodies[bodyIndex].transform.pos).length());
+					}
+					bodyIndex++;
+				}
+				results.array().push_back(Json::Value{
+					{ "broadphase", broadphase.name },
+					{ "stepsPerSecond", sceneResult["stepsPerSecond"] },
+					{ "collideUpdateBvh", sceneResult["phases"]["collideUpdateBvh"] },
+					{ "collideFindPairs", sceneResult["phases"]["collideFindPairs"] },
+					{ "enlargedAabbsPerStep", sceneResult["enlargedAabbsPerStep"] },
+					{ "shrunkAabbsPerStep", sceneResult["shrunkAabbsPerStep"] },
+					{ "maxPositionDifference", maxPositionDifference },
+				});
+			}
+			broadphaseComparison.array().push_back(Json::Value{
+				{ "name", scene.name },
+				{ "broadphases", results },
+			});
+		}
+		physics.setBroadphase(broadphaseType);
+	}
+
+	// Compares building the tree at once with inserting the bodies one by one.
+	auto loadTests = Json::Value::emptyArray();
+	for (const auto bodyCount : loadTestBodyCounts) {
+		loadTests.array().push_back(runLoadTest(physics, settings, bodyCount, false));
+		loadTests.array().push_back(runLoadTest(physics, settings, bodyCount, true));
+	}
+
+	auto queries = Json::Value::null();
+	if (queryCount > 0) {
+		queries = runQueryBenchmark(physics, settings, queryCount);
+	}
+
+	Json::Value result{
+		{ "frames", settings.frames },
+		{ "dt", settings.dt },
+		{ "solverIterations", settings.solverIterations },
+		{ "substeps", settings.substeps },
+		{ "threads", settings.threads },
+		{ "sleeping", PhysicsWorld::sleepingEnabled },
+		{ "graphColoring", PhysicsWorld::graphColoring },
+		{ "wideContactSolver", PhysicsWorld::wideContactSolver },
+		{ "wideContactSolverLanes", FloatWide::LANES },
+		{ "continuousCollisionDetection", PhysicsWorld::continuousCollisionDetection },
+		{ "speculativeContacts", PhysicsWorld::speculativeContacts },
+		{ "gjkNarrowphase", PhysicsWorld::gjkNarrowphase },
+		{ "satCache", PhysicsWorld::satCache },
+		{ "narrowphaseTimings", PhysicsWorld::narrowphaseTimings },
+		{ "wideBvh", BvhCollisionSystem::wideTree },
+		{ "broadphase", static_cast<i32>(physics.broadphaseType()) },
+		{ "scenes", scenes },
+	};
+	if (compareContactSolvers) {
+		result["contactSolverComparison"] = contactSolverComparison;
+	}
+	if (compareBroadphases) {
+		result["broadphaseComparison"] = broadphaseComparison;
+	}
+	if (!loadTestBodyCounts.empty()) {
+		result["loadTests"] = loadTests;
+	}
+	if (queryCount > 0) {
+		result["queries"] = queries;
+	}
+
+	if (outputPath.has_value()) {
+		std::ofstream file{ *outputPath };
+		if (file.fail()) {
+			std::cerr << "failed to open " << *outputPath << '\n';
+			return EXIT_FAILURE;
+		}
+		Json::prettyPrint(file, result);
+	} else {
+		Json::prettyPrint(std::cout, result);
+		std::cout << '\n';
+	}
+}
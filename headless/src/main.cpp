@@ -0,0 +1,68 @@
+// Runs a level without the window, renderer or input so it can be used on machines without a display.
+// Usage: physics_headless <level path> [steps] [dt] [solver iterations] [substeps] [threads]
+
+#include <game/physicsWorld.hpp>
+#include <game/ent.hpp>
+#include <utils/timer.hpp>
+
+#include <iostream>
+#include <string>
+
+auto main(int argc, char** argv) -> int {
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " <level path> [steps] [dt] [solver iterations] [substeps] [threads]\n";
+		return EXIT_FAILURE;
+	}
+
+	const char* levelPath = argv[1];
+	i32 steps = 600;
+	float dt = 1.0f / 60.0f;
+	i32 solverIterations = 10;
+	i32 substeps = 1;
+	i32 threads = 1;
+	try {
+		if (argc > 2) steps = std::stoi(argv[2]);
+		if (argc > 3) dt = std::stof(argv[3]);
+		if (argc > 4) solverIterations = std::stoi(argv[4]);
+		if (argc > 5) substeps = std::stoi(argv[5]);
+		if (argc > 6) threads = std::stoi(argv[6]);
+	} catch (const std::exception&) {
+		std::cerr << "invalid argument\n";
+		return EXIT_FAILURE;
+	}
+
+	PhysicsWorld physics;
+	physics.jobSystem.setThreadCount(threads);
+	if (const auto error = physics.loadLevelFromFile(levelPath); error.has_value()) {
+		std::cerr << *error << '\n';
+		return EXIT_FAILURE;
+	}
+
+	PhysicsProfile total;
+	Timer timer;
+	for (i32 i = 0; i < steps; i++) {
+		ent.update();
+		physics.collisionSystem().update();
+		PhysicsProfile profile;
+		for (i32 j = 0; j < substeps; j++) {
+			physics.step(dt / substeps, solverIterations, profile);
+		}
+		total.collideUpdateBvh += profile.collideUpdateBvh;
+		total.collideDetectCollisions += profile.collideDetectCollisions;
+		total.collideTotal += profile.collideTotal;
+		total.solvePrestep += profile.solvePrestep;
+		total.solveVelocities += profile.solveVelocities;
+		total.solveTotal += profile.solveTotal;
+	}
+	total.total = timer.elapsedMilliseconds();
+
+	std::cout << "level: " << levelPath << '\n';
+	std::cout << "bodies: " << ent.body.aliveCount() << '\n';
+	std::cout << "contacts: " << physics.contacts.size() << '\n';
+	std::cout << "steps: " << steps << " dt: " << dt << " solver iterations: " << solverIterations << " substeps: " << substeps << " threads: " << threads << '\n';
+	std::cout << "total: " << total.total << "ms (" << steps / (total.total / 1000.0f) << " steps/s)\n";
+	std::cout << "collideUpdateBvh: " << total.collideUpdateBvh << "ms\n";
+	std::cout << "collideDetectCollisions: " << total.collideDetectCollisions << "ms\n";
+	std::cout << "solvePrestep: " << total.solvePrestep << "ms\n";
+	std::cout << "solveVelocities: " << total.solveVelocities << "ms\n";
+}
@@ -105,6 +105,12 @@ auto Debug::drawCollider(const Collider& collider, Vec2 pos, float orientation,
 			Debug::drawLine(poly->verts[i] * transform, poly->verts[next] * transform, color);
 		}
 	}
+	else if (const auto compound = std::get_if<CompoundCollider>(&collider)) {
+		for (const auto& child : compound->children) {
+			const auto childTransform = child.transform * Transform{ pos, orientation };
+			Debug::drawCollider(child.collider, childTransform.pos, childTransform.angle(), color);
+		}
+	}
 	else ASSERT_NOT_REACHED();
 }
 
@@ -32,6 +32,10 @@ Body::Body(Vec2 pos, const Collider& collider, bool isStatic)
 
 	torque = 0.0f;
 	force = Vec2{ 0.0f };
+
+	isAwake = true;
+	sleepTime = 0.0f;
+	isBullet = false;
 }
 
 auto Body::updateInvMassAndInertia() -> void {
@@ -49,11 +53,21 @@ auto Body::isStatic() const -> bool {
 	return invMass == 0.0f;
 }
 
+auto Body::wake() -> void {
+	isAwake = true;
+	sleepTime = 0.0f;
+}
+
+auto Body::isSleeping() const -> bool {
+	return !isAwake && !isStatic();
+}
+
 auto Body::makeStatic() -> void {
 	vel = Vec2{ 0.0f };
 	angularVel = 0.0f;
 	mass = std::numeric_limits<float>::infinity();
 	updateInvMassAndInertia();
+	wake();
 }
 
 auto Body::updateMass(float density) -> void {
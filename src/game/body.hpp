@@ -13,6 +13,10 @@ struct Body {
 	auto isStatic() const -> bool;
 	auto makeStatic() -> void;
 	auto updateMass(float density = DEFAULT_DENSITY) -> void;
+	// Should be called when something outside the simulation changes the body.
+	auto wake() -> void;
+	// Static bodies are always awake.
+	auto isSleeping() const -> bool;
 
 	Transform transform;
 	Vec2 vel;
@@ -25,6 +29,21 @@ struct Body {
 	float torque;
 	float invMass;
 	float invRotationalInertia;
+
+	// Sleeping bodies aren't integrated, their aabbs aren't updated and collisions between them aren't detected or solved. A body is put to sleep when it's whole island has been resting for some time.
+	bool isAwake;
+	// How long the body has been moving slower than the sleep thresholds.
+	float sleepTime;
+	// Bullets always use continuous collision detection and also against dynamic bodies. Other bodies only use it against static bodies and only when they move further than their innerRadius in a step.
+	bool isBullet;
 };
 
 using BodyId = EntityArray<Body>::Id;
+
+// The part of the body state that is read and written by the velocity solver. The solver iterates the constraints many times per step and Body is large, mostly because of the collider, so the solver works on a separate tightly packed array of these instead. Indexed by BodyId::index().
+struct SolverBody {
+	Vec2 vel;
+	float angularVel;
+	float invMass;
+	float invRotationalInertia;
+};
@@ -0,0 +1,307 @@
+#include <game/broadphase.hpp>
+#include <game/physicsWorld.hpp>
+#include <utils/timer.hpp>
+#include <algorithm>
+
+auto Broadphase::fatAabb(const Body& body, i32 shape, float dt) -> Aabb {
+	const auto [collider, transform] = colliderShape(body.collider, body.transform, shape);
+	const auto tightAabb = aabb(collider, transform);
+	auto result = tightAabb.addedPadding(aabbMargin(tightAabb));
+	const auto displacement = body.vel * (dt * AABB_PREDICTED_STEPS);
+	if (displacement.x > 0.0f) {
+		result.max.x += displacement.x;
+	} else {
+		result.min.x += displacement.x;
+	}
+	if (displacement.y > 0.0f) {
+		result.max.y += displacement.y;
+	} else {
+		result.min.y += displacement.y;
+	}
+	return result;
+}
+
+auto Broadphase::updatedFatAabb(const Body& body, i32 shape, const Aabb& storedAabb, float dt, PhysicsProfile& profile) -> std::optional<Aabb> {
+	const auto [collider, transform] = colliderShape(body.collider, body.transform, shape);
+	const auto tightAabb = aabb(collider, transform);
+	// The aabb also has to contain where the body will be at the end of this step, so the pairs for the speculative contacts are found after something changed the direction of the body.
+	const auto displacement = body.vel * dt;
+	// Aabb::contains(const Aabb&) subtracts the sizes, which can round the wrong way.
+	if (!(storedAabb.contains(tightAabb.min) && storedAabb.contains(tightAabb.max) && storedAabb.contains(tightAabb.min + displacement) && storedAabb.contains(tightAabb.max + displacement))) {
+		profile.collideEnlargedAabbs++;
+		return fatAabb(body, shape, dt);
+	}
+	const auto newAabb = fatAabb(body, shape, dt);
+	// Only the sizes are compared. A moving body is always near one end of the aabb extended in its direction of motion, which doesn't mean the aabb is too big.
+	const auto extraSize = storedAabb.size() - newAabb.size();
+	const auto maxExtraSize = aabbMargin(tightAabb) * AABB_SHRINK_MARGINS;
+	if (extraSize.x > maxExtraSize || extraSize.y > maxExtraSize) {
+		profile.collideShrunkAabbs++;
+		return newAabb;
+	}
+	return std::nullopt;
+}
+
+auto Broadphase::aabbMargin(const Aabb& aabb) -> float {
+	const auto size = aabb.size();
+	return std::clamp(std::max(size.x, size.y) * AABB_MARGIN_SIZE_FRACTION, AABB_MIN_MARGIN, AABB_MAX_MARGIN);
+}
+
+auto Broadphase::bodiesToReload() -> std::vector<BodyId> {
+	std::vector<bool> addedThisFrame(ent.body.entities.size(), false);
+	for (const auto& id : ent.body.entitiesAddedThisFrame()) {
+		addedThisFrame[id.index()] = true;
+	}
+	std::vector<BodyId> result;
+	for (const auto& [id, _] : ent.body) {
+		if (!addedThisFrame[id.index()]) {
+			result.push_back(id);
+		}
+	}
+	return result;
+}
+
+auto Broadphase::raycast(Vec2 start, Vec2 end) const -> std::optional<RayHit> {
+	std::optional<RayHit> closest;
+	visitRay(start, end, Vec2{ 0.0f }, [&](BodyId id, i32 shape) -> float {
+		const auto body = ent.body.get(id);
+		const auto [collider, transform] = colliderShape(body->collider, body->transform, shape);
+		if (const auto hit = ::raycast(start, end, collider, transform); hit.has_value() && (!closest.has_value() || hit->t < closest->t)) {
+			closest = RayHit{ id, hit->t, hit->normal };
+		}
+		return closest.has_value() ? closest->t : 1.0f;
+	});
+	return closest;
+}
+
+auto Broadphase::raycast(Span<const Ray> rays, Span<std::optional<RayHit>> hits, JobSystem& jobSystem) const -> void {
+	ASSERT(rays.size() == hits.size());
+	// Single rays are too cheap to be jobs.
+	static constexpr i32 RAYS_PER_JOB = 64;
+	const auto rayCount = static_cast<i32>(rays.size());
+	jobSystem.parallelFor((rayCount + RAYS_PER_JOB - 1) / RAYS_PER_JOB, [&](i32 jobIndex, i32) {
+		const auto end = std::min((jobIndex + 1) * RAYS_PER_JOB, rayCount);
+		for (i32 i = jobIndex * RAYS_PER_JOB; i < end; i++) {
+			hits[i] = raycast(rays[i].start, rays[i].end);
+		}
+	});
+}
+
+auto Broadphase::raycastAll(Vec2 start, Vec2 end, std::vector<RayHit>& hits) const -> void {
+	hits.clear();
+	visitRay(start, end, Vec2{ 0.0f }, [&](BodyId id, i32 shape) -> float {
+		const auto body = ent.body.get(id);
+		const auto [collider, transform] = colliderShape(body->collider, body->transform, shape);
+		if (const auto hit = ::raycast(start, end, collider, transform); hit.has_value()) {
+			hits.push_back(RayHit{ id, hit->t, hit->normal });
+		}
+		return 1.0f;
+	});
+	// A body can be hit more than once, because a shape can be visited more than once and because a compound can be hit by many of its children. Only the closest hit of every body is kept.
+	std::sort(hits.begin(), hits.end(), [](const RayHit& a, const RayHit& b) {
+		return a.body.index() < b.body.index() || (a.body.index() == b.body.index() && a.t < b.t);
+	});
+	hits.erase(std::unique(hits.begin(), hits.end(), [](const RayHit& a, const RayHit& b) { return a.body == b.body; }), hits.end());
+	std::sort(hits.begin(), hits.end(), [](const RayHit& a, const RayHit& b) {
+		return a.t < b.t || (a.t == b.t && a.body.index() < b.body.index());
+	});
+}
+
+auto Broadphase::queryAabb(const Aabb& aabb, std::vector<BodyId>& bodies) const -> void {
+	const auto oldSize = bodies.size();
+	auto visitedCompound = false;
+	visitAabb(aabb, [&](BodyId id, i32 shape) {
+		const auto body = ent.body.get(id);
+		const auto [collider, transform] = colliderShape(body->collider, body->transform, shape);
+		if (::aabb(collider, transform).collides(aabb)) {
+			bodies.push_back(id);
+			visitedCompound |= std::holds_alternative<CompoundCollider>(body->collider);
+		}
+	});
+	// Multiple children of a compound can overlap the aabb.
+	if (visitedCompound) {
+		const auto added = bodies.begin() + static_cast<std::ptrdiff_t>(oldSize);
+		std::sort(added, bodies.end(), [](BodyId a, BodyId b) { return a.index() < b.index(); });
+		bodies.erase(std::unique(added, bodies.end()), bodies.end());
+	}
+}
+
+auto Broadphase::shapeCast(const Collider& shape, const Transform& transform, Vec2 translation) const -> std::optional<RayHit> {
+	// Casting the aabb of the shape is the same as casting its center against the aabbs extended by its half size.
+	const auto shapeAabb = aabb(shape, transform);
+	const auto start = shapeAabb.center();
+	std::optional<RayHit> closest;
+	visitRay(start, start + translation, shapeAabb.size() / 2.0f, [&](BodyId id, i32 bodyShape) -> float {
+		const auto body = ent.body.get(id);
+		const auto [collider, colliderTransform] = colliderShape(body->collider, body->transform, bodyShape);
+		if (const auto hit = ::shapeCast(shape, transform, translation, collider, colliderTransform); hit.has_value() && (!closest.has_value() || hit->t < closest->t)) {
+			closest = RayHit{ id, hit->t, hit->normal };
+		}
+		return closest.has_value() ? closest->t : 1.0f;
+	});
+	return closest;
+}
+
+auto Broadphase::circleCast(Vec2 start, Vec2 end, float radius) const -> std::optional<RayHit> {
+	return shapeCast(CircleCollider{ radius }, Transform{ start, Rotation{ 1.0f, 0.0f } }, end - start);
+}
+
+auto Broadphase::addPotentialPair(BodyId a, i32 shapeA, BodyId b, i32 shapeB, const IgnoredCollisions& collisionsToIgnore, std::vector<PotentialPair>& pairs) const -> void {
+	if (a == b)
+		return;
+	const auto aBody = ent.body.get(a);
+	const auto bBody = ent.body.get(b);
+	if (!aBody.has_value() || !bBody.has_value()) {
+		ASSERT_NOT_REACHED();
+		return;
+	}
+	if (aBody->isStatic() && bBody->isStatic())
+		return;
+
+	const ShapePair key{ a, shapeA, b, shapeB };
+	if (collisionsToIgnore.contains(key.bodies()))
+		return;
+
+	const auto aCanMove = !aBody->isStatic() && aBody->isAwake;
+	const auto bCanMove = !bBody->isStatic() && bBody->isAwake;
+	pairs.push_back(PotentialPair{ key, !aCanMove && !bCanMove });
+}
+
+auto Broadphase::beginFindingPairs(JobSystem& jobSystem) -> void {
+	threadPairs.resize(jobSystem.threadCount());
+	for (auto& buffer : threadPairs) {
+		buffer.clear();
+	}
+}
+
+auto Broadphase::endFindingPairs() -> void {
+	pairs.clear();
+	for (const auto& buffer : threadPairs) {
+		pairs.insert(pairs.end(), buffer.begin(), buffer.end());
+	}
+	std::sort(pairs.begin(), pairs.end(), [](const PotentialPair& a, const PotentialPair& b) { return CollisionMap::lessThan(a.key, b.key); });
+}
+
+auto Broadphase::speculativeDistance(const Body& a, const Body& b, float dt) -> float {
+	if (!PhysicsWorld::speculativeContacts)
+		return 0.0f;
+	// An upper bound on how much closer any points of the bodies can get in this step. The velocities already include gravity, because they are integrated before the collisions are detected.
+	const auto relativeSpeed = (b.vel - a.vel).length() + std::abs(a.angularVel) * rotationRadius(a.collider) + std::abs(b.angularVel) * rotationRadius(b.collider);
+	return relativeSpeed * dt;
+}
+
+auto Broadphase::collidePairs(float dt, CollisionMap& collisions, JobSystem& jobSystem, PhysicsProfile& profile) -> void {
+	pairCollisions.clear();
+	pairCollisions.resize(pairs.size());
+
+	// The collisions from the last step are still in the map, until endUpdate. Both are sorted in the same order so the old collision of a pair can be found by advancing through the map.
+	const auto useGjk = PhysicsWorld::gjkNarrowphase;
+	pairSatCaches.clear();
+	pairGjkCaches.clear();
+	if (useGjk) {
+		pairGjkCaches.resize(pairs.size());
+	} else if (PhysicsWorld::satCache) {
+		pairSatCaches.resize(pairs.size());
+	}
+	if (!pairSatCaches.empty() || !pairGjkCaches.empty()) {
+		auto old = collisions.begin();
+		for (usize i = 0; i < pairs.size(); i++) {
+			const auto& key = pairs[i].key;
+			while (old != collisions.end() && CollisionMap::lessThan(old->key, key)) {
+				++old;
+			}
+			if (old == collisions.end() || !(old->key == key))
+				continue;
+			if (useGjk) {
+				pairGjkCaches[i] = old->collision.gjkCache;
+			} else {
+				pairSatCaches[i] = old->collision.satCache;
+			}
+		}
+	}
+
+	threadNarrowphaseStatistics.resize(jobSystem.threadCount());
+	std::fill(threadNarrowphaseStatistics.begin(), threadNarrowphaseStatistics.end(), NarrowphaseStatistics{});
+	const auto measureTime = PhysicsWorld::narrowphaseTimings;
+	jobSystem.parallelFor(static_cast<i32>(pairs.size()), [this, dt, measureTime, useGjk](i32 pairIndex, i32 threadIndex) {
+		const auto& pair = pairs[pairIndex];
+		if (pair.keepOld)
+			return;
+		// The bodies are only read here. Waking them up has to wait until all the threads are done.
+		const auto a = ent.body.get(pair.key.a);
+		const auto b = ent.body.get(pair.key.b);
+		auto& collision = pairCollisions[pairIndex];
+		const auto aShape = colliderShape(a->collider, a->transform, pair.key.shapeA);
+		const auto bShape = colliderShape(b->collider, b->transform, pair.key.shapeB);
+		const auto typeA = aShape.collider.index();
+		const auto typeB = bShape.collider.index();
+		auto& statistics = threadNarrowphaseStatistics[threadIndex];
+		const auto satCache = pairSatCaches.empty() ? nullptr : &pairSatCaches[pairIndex];
+		const auto gjkCache = pairGjkCaches.empty() ? nullptr : &pairGjkCaches[pairIndex];
+		if (satCache != nullptr && satCache->valid) {
+			statistics.satCacheTests++;
+		}
+		const auto narrowphase = [&]() -> std::optional<Collision> {
+			const auto distance = speculativeDistance(*a, *b, dt);
+			if (useGjk) {
+				return ::collideGjk(aShape.transform, aShape.collider, bShape.transform, bShape.collider, distance, gjkCache);
+			}
+			return ::collide(aShape.transform, aShape.collider, bShape.transform, bShape.collider, distance, satCache);
+		};
+		if (measureTime) {
+			Timer timer;
+			collision = narrowphase();
+			statistics.milliseconds[std::min(typeA, typeB)][std::max(typeA, typeB)] += timer.elapsedMilliseconds();
+		} else {
+			collision = narrowphase();
+		}
+		statistics.pairs[std::min(typeA, typeB)][std::max(typeA, typeB)]++;
+		if (satCache != nullptr && satCache->hit) {
+			statistics.satCacheHits++;
+		}
+		if (gjkCache != nullptr) {
+			statistics.gjkIterations += gjkCache->iterations;
+		}
+		if (collision.has_value()) {
+			// TODO: Move this into some function or constructor probably when making a better collision system.
+			collision->coefficientOfFriction = sqrt(a->coefficientOfFriction * b->coefficientOfFriction);
+			if (satCache != nullptr) {
+				collision->satCache = *satCache;
+			}
+			if (gjkCache != nullptr) {
+				collision->gjkCache = *gjkCache;
+			}
+		}
+	});
+	for (const auto& statistics : threadNarrowphaseStatistics) {
+		for (i32 i = 0; i < PhysicsProfile::COLLIDER_TYPE_COUNT; i++) {
+			for (i32 j = 0; j < PhysicsProfile::COLLIDER_TYPE_COUNT; j++) {
+				profile.narrowphasePairs[i][j] += statistics.pairs[i][j];
+				profile.narrowphaseMilliseconds[i][j] += statistics.milliseconds[i][j];
+			}
+		}
+		profile.satCacheTests += statistics.satCacheTests;
+		profile.satCacheHits += statistics.satCacheHits;
+		profile.gjkIterations += statistics.gjkIterations;
+	}
+
+	for (usize i = 0; i < pairs.size(); i++) {
+		const auto& pair = pairs[i];
+		if (pair.keepOld) {
+			collisions.keep(pair.key);
+			continue;
+		}
+		const auto& collision = pairCollisions[i];
+		if (!collision.has_value())
+			continue;
+
+		collisions.add(pair.key, *collision);
+		// A sleeping body touched by an awake one. The rest of its island is woken up after the step.
+		for (const auto& id : { pair.key.a, pair.key.b }) {
+			if (auto body = ent.body.get(id); body->isSleeping()) {
+				body->wake();
+			}
+		}
+	}
+	collisions.endUpdate();
+}
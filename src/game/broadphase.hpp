@@ -0,0 +1,106 @@
+#pragma once
+
+#include <game/ent.hpp>
+#include <game/collisionSystem.hpp>
+#include <utils/jobSystem.hpp>
+#include <game/physicsProfile.hpp>
+#include <utils/span.hpp>
+
+#include <functional>
+#include <vector>
+
+// The interface of the collision systems, so the one used by PhysicsWorld can be chosen at runtime. The implementations only differ in how they find the pairs with overlapping aabbs. The narrowphase and the order of the results are shared, so every implementation gives exactly the same simulation.
+// The structures store an aabb for every shape of a body, see colliderShape, so the children of a compound body are found separately and only the children close to something are collided.
+class Broadphase {
+public:
+	virtual ~Broadphase() = default;
+
+	// Adds the bodies created last frame and removes the dead ones.
+	virtual auto update() -> void = 0;
+	virtual auto reset() -> void = 0;
+	// Removes everything and adds all the alive bodies. Used when switching to this broadphase.
+	virtual auto reload() -> void = 0;
+	// Updates the structure after the bodies moved. The velocities are used to predict where the bodies will be in the next steps.
+	virtual auto updateBvh(float dt, PhysicsProfile& profile) -> void = 0;
+	// Finds the pairs with overlapping aabbs and runs the narrowphase on them using the threads of the jobSystem. The result doesn't depend on the thread count.
+	// The dt is used to choose how far apart the bodies can be to get speculative contacts.
+	virtual auto detectCollisions(float dt, CollisionMap& collisions, const IgnoredCollisions& collisionsToIgnore, JobSystem& jobSystem, PhysicsProfile& profile) -> void = 0;
+
+	// The queries only read the structure so they can run on multiple threads at once, but not while the physics is updated. Like raycast they don't return hits when the ray or the shape starts inside a collider.
+	// The structure is only updated in updateBvh so a body that moved out of its stored aabb since then can be missed. PhysicsWorld::step integrates after updateBvh, but the margins of the stored aabbs almost always cover that.
+	struct RayHit {
+		BodyId body;
+		float t;
+		Vec2 normal;
+	};
+	struct Ray {
+		Vec2 start;
+		Vec2 end;
+	};
+	auto raycast(Vec2 start, Vec2 end) const -> std::optional<RayHit>;
+	// hits[i] is the closest hit of rays[i]. The rays are split between the threads of the jobSystem.
+	auto raycast(Span<const Ray> rays, Span<std::optional<RayHit>> hits, JobSystem& jobSystem) const -> void;
+	// Replaces hits with all the bodies hit by the ray sorted by t.
+	auto raycastAll(Vec2 start, Vec2 end, std::vector<RayHit>& hits) const -> void;
+	// Appends the bodies whose colliders' aabbs overlap the aabb.
+	auto queryAabb(const Aabb& aabb, std::vector<BodyId>& bodies) const -> void;
+	// The first body hit by the shape moving by translation without rotating.
+	auto shapeCast(const Collider& shape, const Transform& transform, Vec2 translation) const -> std::optional<RayHit>;
+	auto circleCast(Vec2 start, Vec2 end, float radius) const -> std::optional<RayHit>;
+
+protected:
+	// Returns the new maxT. The traversals skip the aabbs the ray enters after it, so the closest hit queries return the t of the closest hit found so far.
+	using RayVisitor = std::function<float(BodyId body, i32 shape)>;
+	// Calls the visitor with the shapes whose stored aabbs, extended by halfSize on every side, are hit by the segment before maxT. The shapes don't have to be visited in order and can be visited more than once.
+	virtual auto visitRay(Vec2 start, Vec2 end, Vec2 halfSize, const RayVisitor& visitor) const -> void = 0;
+	// Calls the visitor once for every shape whose stored aabb overlaps the aabb.
+	virtual auto visitAabb(const Aabb& aabb, const std::function<void(BodyId body, i32 shape)>& visitor) const -> void = 0;
+
+	// The aabb stored in the structure. The padding is added so the structures don't need to be updated as often. It allows the objects move a bit and still remain in the same place with the same aabb.
+	// The margin is proportional to the size of the body, because a fixed one made small bodies overlap many of their neighbours. The aabb is also extended by the distance the body moves in AABB_PREDICTED_STEPS steps, in the direction it moves, so fast bodies don't leave their aabbs every step. This is what b2_aabbMultiplier did in Box2D.
+	static auto fatAabb(const Body& body, i32 shape, float dt) -> Aabb;
+	// Returns the new aabb if the body left the stored one or if the stored one is much bigger than needed, for example after the body slowed down. Counts the updates in the profile.
+	static auto updatedFatAabb(const Body& body, i32 shape, const Aabb& storedAabb, float dt, PhysicsProfile& profile) -> std::optional<Aabb>;
+	static constexpr float AABB_MARGIN_SIZE_FRACTION = 0.1f;
+	static constexpr float AABB_MIN_MARGIN = 0.02f;
+	static constexpr float AABB_MAX_MARGIN = 0.2f;
+	static constexpr float AABB_PREDICTED_STEPS = 4.0f;
+	// The stored aabb is shrunk once it is this many margins longer than the new one along some axis.
+	static constexpr float AABB_SHRINK_MARGINS = 4.0f;
+	static auto aabbMargin(const Aabb& aabb) -> float;
+	// The bodies reload should add. The ones created this frame are skipped, because update adds them after the next ent.update.
+	static auto bodiesToReload() -> std::vector<BodyId>;
+
+	struct PotentialPair {
+		ShapePair key;
+		// Neither of the bodies can move so the collision from the last step is still valid and the narrowphase is skipped.
+		bool keepOld;
+	};
+	// Skips the pairs of shapes of the same body, the ones between static bodies and the ones in collisionsToIgnore.
+	auto addPotentialPair(BodyId a, i32 shapeA, BodyId b, i32 shapeB, const IgnoredCollisions& collisionsToIgnore, std::vector<PotentialPair>& pairs) const -> void;
+	// Clears a buffer for every thread.
+	auto beginFindingPairs(JobSystem& jobSystem) -> void;
+	// Merges the buffers of the threads. Which thread found which pair depends on the timing, but every pair is found exactly once so after sorting the order is always the same.
+	auto endFindingPairs() -> void;
+	// How far apart the bodies can be to get speculative contacts. The broadphase finds the pairs within this distance, because the fat aabbs are extended by the distance the bodies move in AABB_PREDICTED_STEPS steps.
+	static auto speculativeDistance(const Body& a, const Body& b, float dt) -> float;
+	// Runs the narrowphase on the pairs in parallel and then updates the collisions and wakes up the bodies on one thread.
+	auto collidePairs(float dt, CollisionMap& collisions, JobSystem& jobSystem, PhysicsProfile& profile) -> void;
+
+	// Every thread writes to it's own buffer so no synchronization is needed.
+	std::vector<std::vector<PotentialPair>> threadPairs;
+	std::vector<PotentialPair> pairs;
+	std::vector<std::optional<Collision>> pairCollisions;
+	// The narrowphase caches of the collisions from the last step. Only the one of the narrowphase in use is filled, pairSatCaches only if PhysicsWorld::satCache is enabled.
+	std::vector<SatCache> pairSatCaches;
+	std::vector<GjkCache> pairGjkCaches;
+	struct NarrowphaseStatistics {
+		i32 pairs[PhysicsProfile::COLLIDER_TYPE_COUNT][PhysicsProfile::COLLIDER_TYPE_COUNT];
+		float milliseconds[PhysicsProfile::COLLIDER_TYPE_COUNT][PhysicsProfile::COLLIDER_TYPE_COUNT];
+		i32 satCacheTests;
+		i32 satCacheHits;
+		i32 gjkIterations;
+	};
+	// Summed into the profile after the threads are done.
+	std::vector<NarrowphaseStatistics> threadNarrowphaseStatistics;
+};
@@ -1,6 +1,12 @@
 #include <game/bvhCollisionSystem.hpp>
-#include <utils/io.hpp>
-#include <engine/debug.hpp>
+#include <utils/timer.hpp>
+#include <algorithm>
+#include <iterator>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PHYSICS_ENGINE_SSE
+#endif
 
 BvhCollisionSystem::BvhCollisionSystem()
 	: rootNode{ NULL_NODE }
@@ -17,26 +23,56 @@ auto BvhCollisionSystem::update() -> void {
 	for (const auto& node : nodesToRemove) {
 		removeLeafNode(node);
 		freeNode(node);
-		std::erase(leafNodes, node);
+	}
+	if (!nodesToRemove.empty()) {
+		std::erase_if(leafNodes, [this](u32 n) { return !ent.body.isAlive(node(n).body); });
+		// The freed nodes can be reused by the leaves created below.
+		std::erase_if(movedLeaves, [this](u32 n) {
+			if (ent.body.isAlive(node(n).body))
+				return false;
+			leafMoved[n] = false;
+			return true;
+		});
+		std::erase_if(cachedPairs, [](const LeafPair& pair) { return !ent.body.isAlive(pair.key.a) || !ent.body.isAlive(pair.key.b); });
 	}
 
+	newLeafNodes.clear();
 	for (const auto bodyId : ent.body.entitiesAddedLastFrame()) {
-		const auto& body = ent.body.get(bodyId);
-		if (!body.has_value()) {
-			ASSERT_NOT_REACHED();
-			continue;
-		}
+#ifdef _DEBUG
+		// O(n) so it would make loading big levels quadratic in release.
 		if (std::find_if(leafNodes.begin(), leafNodes.end(), [&](u32 n) { return node(n).body == bodyId; }) != leafNodes.end()) {
 			ASSERT_NOT_REACHED();
 			continue;
 		}
-		insert(bodyId);
+#endif
+		const auto firstNewLeaf = leafNodes.size();
+		createLeafNodes(bodyId);
+		for (auto i = firstNewLeaf; i < leafNodes.size(); i++) {
+			newLeafNodes.push_back(leafNodes[i]);
+			markLeafMoved(leafNodes[i]);
+		}
 	}
 
+	const auto newLeafCount = static_cast<i32>(newLeafNodes.size());
+	if (bulkBuild && newLeafCount >= BULK_BUILD_MIN_NEW_LEAVES && newLeafCount * 4 >= static_cast<i32>(leafNodes.size())) {
+		rebuild();
+	} else {
+		for (const auto leaf : newLeafNodes) {
+			insertLeaf(leaf);
+		}
+	}
 }
 
 auto BvhCollisionSystem::reset() -> void {
 	leafNodes.clear();
+	internalNodeAreaAfterRebuild = 0.0f;
+	wideTreeOutdated = true;
+	cachedPairs.clear();
+	pairCacheOutdated = true;
+	for (const auto leaf : movedLeaves) {
+		leafMoved[leaf] = false;
+	}
+	movedLeaves.clear();
 	freeNodes.clear();
 	for (usize i = 0; i < nodes.size(); i++) {
 		freeNodes.push_back(static_cast<i32>(i));
@@ -44,270 +80,719 @@ auto BvhCollisionSystem::reset() -> void {
 	rootNode = NULL_NODE;
 }
 
-auto BvhCollisionSystem::updateBvh() -> void {
-	for (const auto& nodeIndex : leafNodes) {
-		auto& node = BvhCollisionSystem::node(nodeIndex);
+auto BvhCollisionSystem::reload() -> void {
+	reset();
+	for (const auto& id : bodiesToReload()) {
+		createLeafNodes(id);
+	}
+	rebuild();
+}
 
-		const auto& body = ent.body.get(node.body);
+auto BvhCollisionSystem::updateBvh(float dt, PhysicsProfile& profile) -> void {
+	for (const auto& nodeIndex : leafNodes) {
+		const auto& leaf = node(nodeIndex);
+		const auto& body = ent.body.get(leaf.body);
 		if (!body.has_value()) {
 			ASSERT_NOT_REACHED();
 			continue;
 		}
-		// @Performance Add sleeping flag for bodies that haven't moved and check it here.
-		if (body->isStatic())
+		if (body->isStatic() || body->isSleeping())
 			continue;
 
-		const auto updatedAabb = aabb(body->collider, body->transform);
-		if (!(node.aabb.contains(updatedAabb.min) && node.aabb.contains(updatedAabb.max))) {
+		auto& nodeAabb = bounds(nodeIndex);
+		if (const auto updatedAabb = updatedFatAabb(*body, leaf.shape, nodeAabb, dt, profile); updatedAabb.has_value()) {
 			if (leafNodes.size() == 1) {
-				node.aabb = addPaddingToAabb(updatedAabb);
+				nodeAabb = *updatedAabb;
+				wideTreeOutdated = true;
 			} else {
 				removeLeafNode(nodeIndex);
-				node.aabb = addPaddingToAabb(updatedAabb);
-				insertHelper(rootNode, nodeIndex);
+				// Removing doesn't allocate so the reference is still valid.
+				nodeAabb = *updatedAabb;
+				insertLeaf(nodeIndex);
 			}
-
+			markLeafMoved(nodeIndex);
 		}
 	}
 }
 
-#include <chrono>
+auto BvhCollisionSystem::detectCollisions(float dt, CollisionMap& collisions, const IgnoredCollisions& collisionsToIgnore, JobSystem& jobSystem, PhysicsProfile& profile) -> void {
+	Timer findPairsTimer;
+	if (pairCacheOutdated || static_cast<float>(movedLeaves.size()) >= static_cast<float>(leafNodes.size()) * FULL_TRAVERSAL_MOVED_LEAF_FRACTION) {
+		findAllPairs(jobSystem);
+	} else if (!movedLeaves.empty()) {
+		updateCachedPairs(jobSystem);
+	}
+	for (const auto leaf : movedLeaves) {
+		leafMoved[leaf] = false;
+	}
+	movedLeaves.clear();
 
-// @Performance: Don't check collision between sleeping objects.
-auto BvhCollisionSystem::detectCollisions(CollisionMap& collisions, const IgnoredCollisions& collisionsToIgnore) -> void {
-	if (rootNode == NULL_NODE || node(rootNode).isLeaf())
-		return;
+	// The cache is already sorted so the pairs are added on one thread.
+	pairs.clear();
+	for (const auto& pair : cachedPairs) {
+		addPotentialPair(pair.key.a, pair.key.shapeA, pair.key.b, pair.key.shapeB, collisionsToIgnore, pairs);
+	}
+	profile.collideFindPairs = findPairsTimer.elapsedMilliseconds();
 
-	auto& root = node(rootNode);
-	clearCrossedFlag(rootNode);
-	newCollisions.clear();
-	collide(newCollisions, collisionsToIgnore, root.children[0], root.children[1]);
+	collidePairs(dt, collisions, jobSystem, profile);
+}
 
-	// Removing inside collide would require in total checking all the variations.
-	for (auto it = collisions.begin(); it != collisions.end(); ) {
-		const auto& oldCollisionKey = it->first;
-		if (newCollisions.find(oldCollisionKey) == newCollisions.end()) {
-			it = collisions.erase(it);
-		} else {
-			++it;
+auto BvhCollisionSystem::markLeafMoved(u32 leafNode) -> void {
+	if (leafMoved[leafNode])
+		return;
+	leafMoved[leafNode] = true;
+	movedLeaves.push_back(leafNode);
+}
+
+auto BvhCollisionSystem::findAllPairs(JobSystem& jobSystem) -> void {
+	pairCacheOutdated = false;
+	threadFoundPairs.resize(jobSystem.threadCount());
+	for (auto& buffer : threadFoundPairs) {
+		buffer.clear();
+	}
+	if (wideTree) {
+		if (wideTreeOutdated) {
+			buildWideTree();
+		}
+		wideTraversalTasks.clear();
+		if (wideRootNode != NULL_NODE) {
+			addWideTraversalTasks(wideRootNode, bounds(rootNode), NULL_NODE, bounds(rootNode), 0);
 		}
+		jobSystem.parallelFor(static_cast<i32>(wideTraversalTasks.size()), [&](i32 taskIndex, i32 threadIndex) {
+			const auto& task = wideTraversalTasks[taskIndex];
+			if (task.b == NULL_NODE) {
+				collideSelfWide(task.a, threadFoundPairs[threadIndex]);
+			} else {
+				collideCrossWide(task.a, task.aAabb, task.b, task.bAabb, threadFoundPairs[threadIndex]);
+			}
+		});
+	} else {
+		traversalTasks.clear();
+		if (rootNode != NULL_NODE) {
+			addTraversalTasks(rootNode, NULL_NODE, 0);
+		}
+		jobSystem.parallelFor(static_cast<i32>(traversalTasks.size()), [&](i32 taskIndex, i32 threadIndex) {
+			const auto& task = traversalTasks[taskIndex];
+			if (task.nodeB == NULL_NODE) {
+				collideSelf(task.nodeA, threadFoundPairs[threadIndex]);
+			} else {
+				collideCross(task.nodeA, task.nodeB, threadFoundPairs[threadIndex]);
+			}
+		});
 	}
 
-	for (auto& [newCollisionKey, newCollision] : newCollisions) {
-		// @Performance: There might be a better function for doing this.
-		auto oldCollision = collisions.find(newCollisionKey);
-		if (oldCollision == collisions.end()) {
-			collisions[newCollisionKey] = newCollision;
-		} else {
-			oldCollision->second.update(newCollision);
+	// Every pair is found exactly once.
+	cachedPairs.clear();
+	for (const auto& buffer : threadFoundPairs) {
+		cachedPairs.insert(cachedPairs.end(), buffer.begin(), buffer.end());
+	}
+	std::sort(cachedPairs.begin(), cachedPairs.end(), leafPairLessThan);
+}
+
+auto BvhCollisionSystem::updateCachedPairs(JobSystem& jobSystem) -> void {
+	// The aabbs of the other pairs didn't change so they still overlap.
+	std::erase_if(cachedPairs, [this](const LeafPair& pair) {
+		return (leafMoved[pair.leafA] || leafMoved[pair.leafB]) && !bounds(pair.leafA).collides(bounds(pair.leafB));
+	});
+
+	threadFoundPairs.resize(jobSystem.threadCount());
+	threadQueryStacks.resize(jobSystem.threadCount());
+	for (auto& buffer : threadFoundPairs) {
+		buffer.clear();
+	}
+	jobSystem.parallelFor(static_cast<i32>(movedLeaves.size()), [this](i32 i, i32 threadIndex) {
+		queryMovedLeaf(movedLeaves[i], threadQueryStacks[threadIndex], threadFoundPairs[threadIndex]);
+	});
+	foundPairs.clear();
+	for (const auto& buffer : threadFoundPairs) {
+		foundPairs.insert(foundPairs.end(), buffer.begin(), buffer.end());
+	}
+	std::sort(foundPairs.begin(), foundPairs.end(), leafPairLessThan);
+
+	// Most of the found pairs overlapped before the leaves moved and are already in the cache. Those are only kept once.
+	mergedPairs.clear();
+	std::set_union(cachedPairs.begin(), cachedPairs.end(), foundPairs.begin(), foundPairs.end(), std::back_inserter(mergedPairs), leafPairLessThan);
+	std::swap(cachedPairs, mergedPairs);
+}
+
+auto BvhCollisionSystem::queryMovedLeaf(u32 leafNode, std::vector<u32>& stack, std::vector<LeafPair>& found) const -> void {
+	const auto& leafAabb = bounds(leafNode);
+	const auto leafBody = node(leafNode).body;
+	const auto leafShape = node(leafNode).shape;
+	stack.clear();
+	stack.push_back(rootNode);
+	while (!stack.empty()) {
+		const auto nodeIndex = stack.back();
+		stack.pop_back();
+		if (!bounds(nodeIndex).collides(leafAabb))
+			continue;
+
+		const auto& n = node(nodeIndex);
+		if (!n.isLeaf()) {
+			stack.push_back(n.children[0]);
+			stack.push_back(n.children[1]);
+			continue;
 		}
+		if (nodeIndex == leafNode || (leafMoved[nodeIndex] && nodeIndex < leafNode))
+			continue;
+		found.push_back(LeafPair{ ShapePair{ leafBody, leafShape, n.body, n.shape }, leafNode, nodeIndex });
 	}
 }
 
-auto BvhCollisionSystem::raycast(Vec2 start, Vec2 end) const -> std::optional<RaycastResult> {
+auto BvhCollisionSystem::leafPairLessThan(const LeafPair& a, const LeafPair& b) -> bool {
+	return CollisionMap::lessThan(a.key, b.key);
+}
+
+auto BvhCollisionSystem::visitRay(Vec2 start, Vec2 end, Vec2 halfSize, const RayVisitor& visitor) const -> void {
 	if (rootNode == NULL_NODE)
-		return std::nullopt;
+		return;
 
-	return raycastHelper(rootNode, start, end);
-}
+	const auto dir = end - start;
+	const Vec2 invDir{ 1.0f / dir.x, 1.0f / dir.y };
+	auto maxT = 1.0f;
+	auto entryT = [&](u32 nodeIndex) {
+		const auto& aabb = bounds(nodeIndex);
+		return Aabb{ aabb.min - halfSize, aabb.max + halfSize }.rayEntryT(start, invDir, maxT);
+	};
+	const auto infinity = std::numeric_limits<float>::infinity();
 
-auto BvhCollisionSystem::raycastHelper(u32 nodeIndex, Vec2 start, Vec2 end) const -> std::optional<RaycastResult> {
-	const auto& node = BvhCollisionSystem::node(nodeIndex);
+	struct StackEntry {
+		u32 node;
+		float entryT;
+	};
+	// thread_local, because the queries can run on multiple threads.
+	thread_local std::vector<StackEntry> stack;
+	stack.clear();
+	if (const auto t = entryT(rootNode); t != infinity) {
+		stack.push_back(StackEntry{ rootNode, t });
+	}
+	while (!stack.empty()) {
+		const auto entry = stack.back();
+		stack.pop_back();
+		// A hit closer than the node might have been found after it was pushed.
+		if (entry.entryT > maxT)
+			continue;
 
-	if (!node.aabb.rayHits(start, end))
-		return std::nullopt;
+		const auto& n = node(entry.node);
+		if (n.isLeaf()) {
+			maxT = std::min(maxT, visitor(n.body, n.shape));
+			continue;
+		}
+		// The closer child is pushed last so it is visited first and the hits inside it can prune the other one.
+		const auto t0 = entryT(n.children[0]);
+		const auto t1 = entryT(n.children[1]);
+		const auto closerIs0 = t0 <= t1;
+		const StackEntry closer{ closerIs0 ? n.children[0] : n.children[1], closerIs0 ? t0 : t1 };
+		const StackEntry further{ closerIs0 ? n.children[1] : n.children[0], closerIs0 ? t1 : t0 };
+		if (further.entryT != infinity) {
+			stack.push_back(further);
+		}
+		if (closer.entryT != infinity) {
+			stack.push_back(closer);
+		}
+	}
+}
 
-	if (node.isLeaf()) {
-		const auto& body = ent.body.get(node.body);
-		if (!body.has_value()) {
-			ASSERT_NOT_REACHED();
-			return std::nullopt;
+auto BvhCollisionSystem::visitAabb(const Aabb& aabb, const std::function<void(BodyId body, i32 shape)>& visitor) const -> void {
+	if (rootNode == NULL_NODE)
+		return;
+
+	thread_local std::vector<u32> stack;
+	stack.clear();
+	stack.push_back(rootNode);
+	while (!stack.empty()) {
+		const auto nodeIndex = stack.back();
+		stack.pop_back();
+		if (!bounds(nodeIndex).collides(aabb))
+			continue;
+		const auto& n = node(nodeIndex);
+		if (n.isLeaf()) {
+			visitor(n.body, n.shape);
+		} else {
+			stack.push_back(n.children[0]);
+			stack.push_back(n.children[1]);
 		}
-		return ::raycast(start, end, body->collider, body->transform);
 	}
+}
 
-	const auto result0 = raycastHelper(node.children[0], start, end);
-	if (!result0.has_value())
-		return raycastHelper(node.children[1], start, end);
-	
-	const auto result1 = raycastHelper(node.children[1], start, end);
-	if (!result1.has_value())
-		return result0;
+auto BvhCollisionSystem::addTraversalTasks(u32 nodeA, u32 nodeB, i32 depth) -> void {
+	// 4 levels give at most a few hundred tasks, which is enough to keep the threads busy and to balance the work between them.
+	static constexpr i32 MAX_SPLIT_DEPTH = 4;
+	if (depth == MAX_SPLIT_DEPTH) {
+		traversalTasks.push_back(TraversalTask{ nodeA, nodeB });
+		return;
+	}
 
-	return result0->t < result1->t ? result0 : result1;
+	const auto& a = node(nodeA);
+	if (nodeB == NULL_NODE) {
+		if (a.isLeaf())
+			return;
+		addTraversalTasks(a.children[0], NULL_NODE, depth + 1);
+		addTraversalTasks(a.children[1], NULL_NODE, depth + 1);
+		addTraversalTasks(a.children[0], a.children[1], depth + 1);
+		return;
+	}
+
+	const auto& b = node(nodeB);
+	if (!bounds(nodeA).collides(bounds(nodeB)))
+		return;
+	if (a.isLeaf() && b.isLeaf()) {
+		traversalTasks.push_back(TraversalTask{ nodeA, nodeB });
+	} else if (b.isLeaf() || (!a.isLeaf() && bounds(nodeA).area() >= bounds(nodeB).area())) {
+		addTraversalTasks(a.children[0], nodeB, depth + 1);
+		addTraversalTasks(a.children[1], nodeB, depth + 1);
+	} else {
+		addTraversalTasks(nodeA, b.children[0], depth + 1);
+		addTraversalTasks(nodeA, b.children[1], depth + 1);
+	}
 }
 
-auto BvhCollisionSystem::clearCrossedFlag(u32 nodeIndex) -> void {
-	auto& parent = node(nodeIndex);
-	if (parent.isLeaf())
+auto BvhCollisionSystem::collideSelf(u32 nodeIndex, std::vector<LeafPair>& found) const -> void {
+	const auto& n = node(nodeIndex);
+	if (n.isLeaf())
 		return;
 
-	parent.childrenCrossChecked = false;
-	clearCrossedFlag(parent.children[0]);
-	clearCrossedFlag(parent.children[1]);
+	collideSelf(n.children[0], found);
+	collideSelf(n.children[1], found);
+	collideCross(n.children[0], n.children[1], found);
 }
 
-auto BvhCollisionSystem::collide(CollisionMap& collisions, const IgnoredCollisions& collisionsToIgnore, u32 nodeA, u32 nodeB) -> void {
-	auto& a = node(nodeA);
-	auto& b = node(nodeB);
+auto BvhCollisionSystem::collideCross(u32 nodeA, u32 nodeB, std::vector<LeafPair>& found) const -> void {
+	const auto& a = node(nodeA);
+	const auto& b = node(nodeB);
+	if (!bounds(nodeA).collides(bounds(nodeB)))
+		return;
 
+	// When both nodes are internal the bigger one is split, because it is the one more likely to contain leaves that don't overlap the other node.
 	if (a.isLeaf() && b.isLeaf()) {
-		auto aBody = ent.body.get(a.body);
-		auto bBody = ent.body.get(b.body);
-		if (!aBody.has_value() || !bBody.has_value()) {
-			ASSERT_NOT_REACHED();
-			return;
+		found.push_back(LeafPair{ ShapePair{ a.body, a.shape, b.body, b.shape }, nodeA, nodeB });
+	} else if (b.isLeaf() || (!a.isLeaf() && bounds(nodeA).area() >= bounds(nodeB).area())) {
+		collideCross(a.children[0], nodeB, found);
+		collideCross(a.children[1], nodeB, found);
+	} else {
+		collideCross(nodeA, b.children[0], found);
+		collideCross(nodeA, b.children[1], found);
+	}
+}
+
+auto BvhCollisionSystem::buildWideTree() -> void {
+	wideTreeOutdated = false;
+	wideNodes.clear();
+	wideRootNode = NULL_NODE;
+	// A single leaf can't collide with anything.
+	if (rootNode == NULL_NODE || node(rootNode).isLeaf())
+		return;
+	wideRootNode = buildWideNode(rootNode);
+}
 
+auto BvhCollisionSystem::buildWideNode(u32 binaryNode) -> u32 {
+	u32 children[4]{ node(binaryNode).children[0], node(binaryNode).children[1], NULL_NODE, NULL_NODE };
+	i32 childCount = 2;
+	while (childCount < 4) {
+		i32 biggest = -1;
+		float biggestArea = -1.0f;
+		for (i32 i = 0; i < childCount; i++) {
+			if (!node(children[i]).isLeaf() && bounds(children[i]).perimeter() > biggestArea) {
+				biggest = i;
+				biggestArea = bounds(children[i]).perimeter();
+			}
 		}
-		if (aBody->isStatic() && bBody->isStatic())
-			return;
+		if (biggest == -1)
+			break;
+		const auto& n = node(children[biggest]);
+		children[biggest] = n.children[0];
+		children[childCount] = n.children[1];
+		childCount++;
+	}
 
-		BodyPair key{ a.body, b.body };
+	// Building the children can reallocate wideNodes so the node is always accessed by index.
+	const auto wideNode = static_cast<u32>(wideNodes.size());
+	wideNodes.push_back(WideNode{});
+	for (i32 i = 0; i < 4; i++) {
+		if (i >= childCount) {
+			auto& n = wideNodes[wideNode];
+			n.minX[i] = n.minY[i] = std::numeric_limits<float>::infinity();
+			n.maxX[i] = n.maxY[i] = -std::numeric_limits<float>::infinity();
+			n.children[i] = NULL_NODE;
+			continue;
+		}
+		const auto child = node(children[i]).isLeaf() ? (children[i] | WIDE_LEAF_BIT) : buildWideNode(children[i]);
+		auto& n = wideNodes[wideNode];
+		const auto& aabb = bounds(children[i]);
+		n.minX[i] = aabb.min.x;
+		n.minY[i] = aabb.min.y;
+		n.maxX[i] = aabb.max.x;
+		n.maxY[i] = aabb.max.y;
+		n.children[i] = child;
+	}
+	return wideNode;
+}
 
-		if (collisionsToIgnore.contains(key))
-			return;
+auto BvhCollisionSystem::overlappingChildren(const WideNode& node, const Aabb& aabb) -> i32 {
+	// The same comparisons as in Aabb::collides.
+#ifdef PHYSICS_ENGINE_SSE
+	const auto overlapsX = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minX), _mm_set1_ps(aabb.max.x)), _mm_cmpge_ps(_mm_load_ps(node.maxX), _mm_set1_ps(aabb.min.x)));
+	const auto overlapsY = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minY), _mm_set1_ps(aabb.max.y)), _mm_cmpge_ps(_mm_load_ps(node.maxY), _mm_set1_ps(aabb.min.y)));
+	return _mm_movemask_ps(_mm_and_ps(overlapsX, overlapsY));
+#else
+	i32 mask = 0;
+	for (i32 i = 0; i < 4; i++) {
+		if (node.minX[i] <= aabb.max.x && node.maxX[i] >= aabb.min.x && node.minY[i] <= aabb.max.y && node.maxY[i] >= aabb.min.y) {
+			mask |= 1 << i;
+		}
+	}
+	return mask;
+#endif
+}
 
-		if (a.aabb.collides(b.aabb)) {
+auto BvhCollisionSystem::childBounds(const WideNode& node, i32 childIndex) -> Aabb {
+	return Aabb{ Vec2{ node.minX[childIndex], node.minY[childIndex] }, Vec2{ node.maxX[childIndex], node.maxY[childIndex] } };
+}
 
-			Body* keyA;
-			Body* keyB;
-			// If the body pair swapped the ids then also swap the order so the collision normal and other things point in the correct direction.
-			if (key.a == a.body) {
-				keyA = &*aBody;
-				keyB = &*bBody;
-			} else {
-				keyA = &*bBody;
-				keyB = &*aBody;
+auto BvhCollisionSystem::addWideTraversalTasks(u32 a, const Aabb& aAabb, u32 b, const Aabb& bAabb, i32 depth) -> void {
+	// Every level splits into up to 4 times more tasks than in the binary tree so this gives about as many tasks as addTraversalTasks.
+	static constexpr i32 MAX_SPLIT_DEPTH = 2;
+	if (depth == MAX_SPLIT_DEPTH) {
+		wideTraversalTasks.push_back(WideTraversalTask{ a, aAabb, b, bAabb });
+		return;
+	}
+
+	if (b == NULL_NODE) {
+		const auto& n = wideNodes[a];
+		for (i32 i = 0; i < 4; i++) {
+			const auto child = n.children[i];
+			if (child == NULL_NODE)
+				continue;
+			if ((child & WIDE_LEAF_BIT) == 0) {
+				addWideTraversalTasks(child, childBounds(n, i), NULL_NODE, childBounds(n, i), depth + 1);
 			}
-			if (auto collision = ::collide(keyA->transform, keyA->collider, keyB->transform, keyB->collider); collision.has_value()) {
-				// TODO: Move this into some function or constructor probably when making a better collision system.
-				collision->coefficientOfFriction = sqrt(keyA->coefficientOfFriction * keyB->coefficientOfFriction);
-				collisions[key] = *collision;
+			for (i32 j = i + 1; j < 4; j++) {
+				if (n.children[j] != NULL_NODE && childBounds(n, i).collides(childBounds(n, j))) {
+					addWideTraversalTasks(child, childBounds(n, i), n.children[j], childBounds(n, j), depth + 1);
+				}
 			}
 		}
-	} else if (!a.isLeaf() && !b.isLeaf()) {
-		if (a.aabb.collides(b.aabb)) {
-			collide(collisions, collisionsToIgnore, a.children[0], b.children[0]);
-			collide(collisions, collisionsToIgnore, a.children[0], b.children[1]);
-			collide(collisions, collisionsToIgnore, a.children[1], b.children[0]);
-			collide(collisions, collisionsToIgnore, a.children[1], b.children[1]);
-		}
-		if (!a.childrenCrossChecked) {
-			collide(collisions, collisionsToIgnore, a.children[0], a.children[1]);
-			a.childrenCrossChecked = true;
-		}
-		if (!b.childrenCrossChecked) {
-			collide(collisions, collisionsToIgnore, b.children[0], b.children[1]);
-			b.childrenCrossChecked = true;
-		}
-	} else if (a.isLeaf() && !b.isLeaf()) {
-		if (a.aabb.collides(b.aabb)) {
-			collide(collisions, collisionsToIgnore, nodeA, b.children[0]);
-			collide(collisions, collisionsToIgnore, nodeA, b.children[1]);
-		}
-		if (!b.childrenCrossChecked) {
-			collide(collisions, collisionsToIgnore, b.children[0], b.children[1]);
-			b.childrenCrossChecked = true;
-		}
-	} else if (!a.isLeaf() && b.isLeaf()) {
-		if (a.aabb.collides(b.aabb)) {
-			collide(collisions, collisionsToIgnore, nodeB, a.children[0]);
-			collide(collisions, collisionsToIgnore, nodeB, a.children[1]);
-		}
-		if (!a.childrenCrossChecked) {
-			collide(collisions, collisionsToIgnore, a.children[0], a.children[1]);
-			a.childrenCrossChecked = true;
-		}
+		return;
 	}
+	wideTraversalTasks.push_back(WideTraversalTask{ a, aAabb, b, bAabb });
 }
 
-auto BvhCollisionSystem::addPaddingToAabb(const Aabb& aabb) -> Aabb {
-	// The padding is added so the tree nodes don't need to be updated as often. It allows the objects move a bit and still remain the same node with the same aabb.
-	static constexpr float AABB_PADDING = 0.2f;
-	return aabb.addedPadding(AABB_PADDING);
+auto BvhCollisionSystem::collideSelfWide(u32 wideNode, std::vector<LeafPair>& found) const -> void {
+	const auto& n = wideNodes[wideNode];
+	for (i32 i = 0; i < 4; i++) {
+		const auto child = n.children[i];
+		if (child == NULL_NODE)
+			continue;
+		if ((child & WIDE_LEAF_BIT) == 0) {
+			collideSelfWide(child, found);
+		}
+		const auto childAabb = childBounds(n, i);
+		// Only the children after i so each pair of children is checked once.
+		const auto overlapping = overlappingChildren(n, childAabb) & ~((2 << i) - 1);
+		for (i32 j = i + 1; j < 4; j++) {
+			if (overlapping & (1 << j)) {
+				collideCrossWide(child, childAabb, n.children[j], childBounds(n, j), found);
+			}
+		}
+	}
 }
 
-auto BvhCollisionSystem::insert(BodyId bodyId) -> void {
+auto BvhCollisionSystem::collideCrossWide(u32 a, const Aabb& aAabb, u32 b, const Aabb& bAabb, std::vector<LeafPair>& found) const -> void {
+	const auto aIsLeaf = (a & WIDE_LEAF_BIT) != 0;
+	const auto bIsLeaf = (b & WIDE_LEAF_BIT) != 0;
+	if (aIsLeaf && bIsLeaf) {
+		const auto leafA = a & ~WIDE_LEAF_BIT;
+		const auto leafB = b & ~WIDE_LEAF_BIT;
+		found.push_back(LeafPair{ ShapePair{ node(leafA).body, node(leafA).shape, node(leafB).body, node(leafB).shape }, leafA, leafB });
+		return;
+	}
 
-	auto aabb = [](const Body& body) -> Aabb {
-		const auto aabb = ::aabb(body.collider, body.transform);
-		return addPaddingToAabb(aabb);
-	};
+	// The aabbs of the arguments already overlap. The children of the bigger node are tested against the other node at once.
+	const auto splitA = bIsLeaf || (!aIsLeaf && aAabb.area() >= bAabb.area());
+	const auto& n = wideNodes[splitA ? a : b];
+	const auto& other = splitA ? bAabb : aAabb;
+	const auto otherNode = splitA ? b : a;
+	const auto overlapping = overlappingChildren(n, other);
+	for (i32 i = 0; i < 4; i++) {
+		if (overlapping & (1 << i)) {
+			collideCrossWide(n.children[i], childBounds(n, i), otherNode, other, found);
+		}
+	}
+}
 
+auto BvhCollisionSystem::createLeafNodes(BodyId bodyId) -> void {
 	const auto& body = ent.body.get(bodyId);
-
 	if (!body.has_value()) {
 		ASSERT_NOT_REACHED();
 		return;
 	}
 
-	if (rootNode == NULL_NODE) {
-		rootNode = allocateNode();
-		auto& root = node(rootNode);
-		root = {
-			.parent = NULL_NODE,
-			.body = bodyId,
-			.aabb = aabb(*body),
-		};
-		leafNodes.push_back(rootNode);
-		root.children[0] = NULL_NODE;
-		
-	} else {
+	for (i32 shape = 0; shape < shapeCount(body->collider); shape++) {
 		const auto newNode = allocateNode();
-		node(newNode) = {
-			.children = 0,
+		node(newNode) = Node{
+			.parent = NULL_NODE,
+			.children = { NULL_NODE, NULL_NODE },
 			.body = bodyId,
-			.aabb = aabb(*body),
+			.shape = shape,
 		};
-		node(newNode).children[0] = NULL_NODE;
+		// The time step isn't known here. The aabb gets extended after the body first leaves it.
+		bounds(newNode) = fatAabb(*body, shape, 0.0f);
 		leafNodes.push_back(newNode);
-		rootNode = insertHelper(rootNode, newNode);
 	}
 }
 
-// Returns the new parent node. Can't just pass a reference because it might get invalidated.
-auto BvhCollisionSystem::insertHelper(u32 parentNode, u32 nodeToInsert) -> u32 {
-	if (node(parentNode).isLeaf()) {
-		const auto oldNode = parentNode;
+auto BvhCollisionSystem::rebuild() -> void {
+	// The leaves are kept and only the internal nodes are recreated.
+	if (rootNode != NULL_NODE) {
+		buildNodes.clear();
+		buildNodes.push_back(rootNode);
+		while (!buildNodes.empty()) {
+			const auto nodeIndex = buildNodes.back();
+			buildNodes.pop_back();
+			const auto& n = node(nodeIndex);
+			if (n.isLeaf())
+				continue;
+			buildNodes.push_back(n.children[0]);
+			buildNodes.push_back(n.children[1]);
+			freeNode(nodeIndex);
+		}
+		rootNode = NULL_NODE;
+	}
 
-		parentNode = allocateNode();
-		auto& newParent = node(parentNode);
-		newParent.children[0] = oldNode;
-		newParent.children[1] = nodeToInsert;
-		newParent.aabb = node(newParent.children[0]).aabb.combined(node(newParent.children[1]).aabb);
+	if (leafNodes.empty())
+		return;
+
+	wideTreeOutdated = true;
+	buildNodes = leafNodes;
+	internalNodeAreaAfterRebuild = 0.0f;
+	rootNode = buildHelper(0, static_cast<i32>(buildNodes.size()));
+	node(rootNode).parent = NULL_NODE;
+}
+
+auto BvhCollisionSystem::buildHelper(i32 begin, i32 end) -> u32 {
+	if (end - begin == 1)
+		return buildNodes[begin];
+
+	// The nodes are split by their centers so each node goes to exactly one side.
+	Aabb centerBounds{ Vec2{ std::numeric_limits<float>::infinity() }, Vec2{ -std::numeric_limits<float>::infinity() } };
+	for (i32 i = begin; i < end; i++) {
+		centerBounds = centerBounds.extended(bounds(buildNodes[i]).center());
+	}
+	const auto centerBoundsSize = centerBounds.size();
+	const auto axis = centerBoundsSize.x >= centerBoundsSize.y ? 0 : 1;
+	auto axisValue = [axis](Vec2 v) { return axis == 0 ? v.x : v.y; };
+	const auto axisMin = axisValue(centerBounds.min);
+	const auto axisExtent = axisValue(centerBoundsSize);
+
+	// Instead of trying every possible split, which would require sorting, the nodes are put into bins along the axis and only the splits between bins are evaluated.
+	static constexpr i32 BIN_COUNT = 16;
+	auto binIndex = [&](u32 nodeIndex) -> i32 {
+		const auto t = (axisValue(bounds(nodeIndex).center()) - axisMin) / axisExtent;
+		return std::clamp(static_cast<i32>(t * BIN_COUNT), 0, BIN_COUNT - 1);
+	};
 
-		auto& old = node(oldNode);
-		auto& inserted = node(nodeToInsert);
-		if (old.parent == NULL_NODE) {
-			rootNode = parentNode;
+	auto mid = begin + (end - begin) / 2;
+	if (axisExtent > 0.0f) {
+		struct Bin {
+			i32 count = 0;
+			Aabb aabb{ Vec2{ std::numeric_limits<float>::infinity() }, Vec2{ -std::numeric_limits<float>::infinity() } };
+		};
+		Bin bins[BIN_COUNT];
+		for (i32 i = begin; i < end; i++) {
+			auto& bin = bins[binIndex(buildNodes[i])];
+			bin.count++;
+			bin.aabb = bin.aabb.combined(bounds(buildNodes[i]));
+		}
+
+		// The cost of the split after bin i is the area of each side times the number of nodes in it.
+		float rightCost[BIN_COUNT - 1];
+		Bin right;
+		for (i32 i = BIN_COUNT - 1; i > 0; i--) {
+			right.count += bins[i].count;
+			right.aabb = right.aabb.combined(bins[i].aabb);
+			rightCost[i - 1] = right.count == 0 ? 0.0f : right.count * right.aabb.perimeter();
+		}
+		Bin left;
+		auto bestCost = std::numeric_limits<float>::infinity();
+		i32 bestSplit = -1;
+		for (i32 i = 0; i < BIN_COUNT - 1; i++) {
+			left.count += bins[i].count;
+			left.aabb = left.aabb.combined(bins[i].aabb);
+			if (left.count == 0 || left.count == end - begin)
+				continue;
+			const auto cost = left.count * left.aabb.perimeter() + rightCost[i];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestSplit = i;
+			}
+		}
+
+		if (bestSplit != -1) {
+			const auto splitIt = std::partition(buildNodes.begin() + begin, buildNodes.begin() + end, [&](u32 n) { return binIndex(n) <= bestSplit; });
+			mid = static_cast<i32>(splitIt - buildNodes.begin());
 		}
-		newParent.parent = old.parent;
-		old.parent = parentNode;
-		inserted.parent = parentNode;
-		return parentNode;
+	}
+	// All the centers are in the same place or in one bin. Splitting in the middle still keeps the tree balanced.
+	if (mid == begin || mid == end) {
+		mid = begin + (end - begin) / 2;
+	}
+
+	const auto left = buildHelper(begin, mid);
+	const auto right = buildHelper(mid, end);
+	// Allocating can invalidate the references so they are taken after it.
+	const auto parent = allocateNode();
+	node(parent) = Node{
+		.parent = NULL_NODE,
+		.children = { left, right },
+		.body = BodyId{},
+	};
+	bounds(parent) = bounds(left).combined(bounds(right));
+	node(left).parent = parent;
+	node(right).parent = parent;
+	internalNodeAreaAfterRebuild += bounds(parent).perimeter();
+	return parent;
+}
+
+auto BvhCollisionSystem::rebuildIfDegraded(const BvhStatistics& statistics) -> bool {
+	if (rebuildAreaRatio <= 0.0f || statistics.internalNodeArea <= internalNodeAreaAfterRebuild * rebuildAreaRatio)
+		return false;
+	rebuild();
+	return true;
+}
+
+auto BvhCollisionSystem::insertLeaf(u32 leafNode) -> void {
+	wideTreeOutdated = true;
+	if (rootNode == NULL_NODE) {
+		rootNode = leafNode;
+		node(leafNode).parent = NULL_NODE;
+		return;
+	}
+
+	const auto sibling = findBestSibling(bounds(leafNode));
+	const auto oldParent = node(sibling).parent;
+	// Allocating can invalidate the references so they are taken after it.
+	const auto newParent = allocateNode();
+	node(newParent) = Node{
+		.parent = oldParent,
+		.children = { sibling, leafNode },
+		.body = BodyId{},
+	};
+	bounds(newParent) = bounds(sibling).combined(bounds(leafNode));
+	node(sibling).parent = newParent;
+	node(leafNode).parent = newParent;
+
+	if (oldParent == NULL_NODE) {
+		rootNode = newParent;
 	} else {
-		auto& toInsert = node(nodeToInsert);
-		auto& a = node(node(parentNode).children[0]);
-		auto& b = node(node(parentNode).children[1]);
+		auto& parent = node(oldParent);
+		parent.children[parent.children[0] == sibling ? 0 : 1] = newParent;
+	}
+	refit(newParent, true);
+}
+
+auto BvhCollisionSystem::findBestSibling(const Aabb& leafAabb) -> u32 {
+	const auto leafArea = leafAabb.perimeter();
+	auto bestSibling = rootNode;
+	auto bestCost = bounds(rootNode).combined(leafAabb).perimeter();
+
+	// Min heap by the inherited cost so the most promising nodes are checked first, which makes the bound tighter sooner.
+	auto greater = [](const SiblingCandidate& a, const SiblingCandidate& b) { return a.inheritedCost > b.inheritedCost; };
+	siblingCandidates.clear();
+	siblingCandidates.push_back(SiblingCandidate{ rootNode, 0.0f });
+	while (!siblingCandidates.empty()) {
+		std::pop_heap(siblingCandidates.begin(), siblingCandidates.end(), greater);
+		const auto [nodeIndex, inheritedCost] = siblingCandidates.back();
+		siblingCandidates.pop_back();
+
+		const auto& n = node(nodeIndex);
+		const auto& nodeAabb = bounds(nodeIndex);
+		const auto directCost = nodeAabb.combined(leafAabb).perimeter();
+		const auto cost = directCost + inheritedCost;
+		if (cost < bestCost) {
+			bestCost = cost;
+			bestSibling = nodeIndex;
+		}
+		if (n.isLeaf())
+			continue;
 
-		const auto
-			aAreaIncrease = a.aabb.combined(toInsert.aabb).area() - a.aabb.area(),
-			bAreaIncrease = b.aabb.combined(toInsert.aabb).area() - b.aabb.area();
+		// If this node becomes an ancestor of the new parent its area increases by this much.
+		const auto childInheritedCost = inheritedCost + directCost - nodeAabb.perimeter();
+		// The cheapest a node in the subtree could be is if it had zero area and contained the leaf.
+		const auto lowerBound = leafArea + childInheritedCost;
+		if (lowerBound >= bestCost)
+			continue;
 
-		// @Performance: Could use the sum of the area increases as the cost function also describec by Erin Catto.
-		if (aAreaIncrease < bAreaIncrease)
-			node(parentNode).children[0] = insertHelper(node(parentNode).children[0], nodeToInsert);
-		else 
-			node(parentNode).children[1] = insertHelper(node(parentNode).children[1], nodeToInsert);
+		for (const auto child : n.children) {
+			siblingCandidates.push_back(SiblingCandidate{ child, childInheritedCost });
+			std::push_heap(siblingCandidates.begin(), siblingCandidates.end(), greater);
+		}
+	}
+	return bestSibling;
+}
 
-		node(parentNode).aabb = node(node(parentNode).children[0]).aabb.combined(node(node(parentNode).children[1]).aabb);
-		// @Performance: Could also rotate the tree like described in the presentation by Erin Catto at GDC 2019.
-		return parentNode;
+auto BvhCollisionSystem::refit(u32 nodeIndex, bool rotate) -> void {
+	while (nodeIndex != NULL_NODE) {
+		const auto& n = node(nodeIndex);
+		bounds(nodeIndex) = bounds(n.children[0]).combined(bounds(n.children[1]));
+		if (rotate) {
+			rotateNode(nodeIndex);
+		}
+		nodeIndex = node(nodeIndex).parent;
 	}
 }
 
+auto BvhCollisionSystem::rotateNode(u32 nodeIndex) -> void {
+	auto& a = node(nodeIndex);
+	const auto b = a.children[0];
+	const auto c = a.children[1];
+	const auto& bNode = node(b);
+	const auto& cNode = node(c);
+	if (bNode.isLeaf() && cNode.isLeaf())
+		return;
+
+	// The area of the rotated node and the swapped nodes stays the same. Only the area of the child that gets one of it's children replaced changes.
+	struct Rotation {
+		// The child of a that is swapped with a child of the other child.
+		i32 childIndex;
+		i32 grandchildIndex;
+		float areaDecrease;
+	};
+	Rotation best{ -1, -1, 0.0f };
+	auto tryRotation = [&](i32 childIndex, i32 grandchildIndex) {
+		const auto child = a.children[childIndex];
+		const auto other = a.children[1 - childIndex];
+		const auto& otherNode = node(other);
+		if (otherNode.isLeaf())
+			return;
+		// The grandchild that stays in other.
+		const auto remaining = otherNode.children[1 - grandchildIndex];
+		const auto areaDecrease = bounds(other).perimeter() - bounds(child).combined(bounds(remaining)).perimeter();
+		if (areaDecrease > best.areaDecrease) {
+			best = Rotation{ childIndex, grandchildIndex, areaDecrease };
+		}
+	};
+	tryRotation(0, 0);
+	tryRotation(0, 1);
+	tryRotation(1, 0);
+	tryRotation(1, 1);
+	if (best.childIndex == -1)
+		return;
+
+	const auto child = a.children[best.childIndex];
+	const auto other = a.children[1 - best.childIndex];
+	auto& otherNode = node(other);
+	const auto grandchild = otherNode.children[best.grandchildIndex];
+
+	a.children[best.childIndex] = grandchild;
+	node(grandchild).parent = nodeIndex;
+	otherNode.children[best.grandchildIndex] = child;
+	node(child).parent = other;
+	bounds(other) = bounds(otherNode.children[0]).combined(bounds(otherNode.children[1]));
+}
+
 // Doesn't free the node and doesn't remove the node from leaf nodes. This is because this function is also used to remove and reinsert nodes.
 auto BvhCollisionSystem::removeLeafNode(u32 nodeToRemove) -> void {
+	wideTreeOutdated = true;
 	if (nodeToRemove == rootNode) {
 		rootNode = NULL_NODE;
 		return;
@@ -330,10 +815,40 @@ auto BvhCollisionSystem::removeLeafNode(u32 nodeToRemove) -> void {
 			parentsParent.children[1] = toRemovesSibling;
 		}
 		node(toRemovesSibling).parent = parent.parent;
+		// The ancestors would otherwise keep the area of the removed node.
+		refit(parent.parent, false);
 	}
 	freeNode(toRemove.parent);
 }
 
+auto BvhCollisionSystem::statistics() -> BvhStatistics {
+	BvhStatistics result;
+	if (rootNode == NULL_NODE)
+		return result;
+
+	auto& stack = statisticsStack;
+	stack.clear();
+	stack.push_back(StatisticsEntry{ rootNode, 0 });
+	i64 depthSum = 0;
+	while (!stack.empty()) {
+		const auto [nodeIndex, depth] = stack.back();
+		stack.pop_back();
+		const auto& n = node(nodeIndex);
+		if (n.isLeaf()) {
+			result.leafCount++;
+			result.maxDepth = std::max(result.maxDepth, depth);
+			depthSum += depth;
+			result.leafDepthHistogram[std::min(depth, BvhStatistics::DEPTH_HISTOGRAM_SIZE - 1)]++;
+			continue;
+		}
+		result.internalNodeArea += bounds(nodeIndex).perimeter();
+		stack.push_back(StatisticsEntry{ n.children[0], depth + 1 });
+		stack.push_back(StatisticsEntry{ n.children[1], depth + 1 });
+	}
+	result.averageLeafDepth = static_cast<float>(depthSum) / static_cast<float>(result.leafCount);
+	return result;
+}
+
 auto BvhCollisionSystem::allocateNode() -> u32 {
 	if (freeNodes.size() > 0) {
 		const auto node = freeNodes.back();
@@ -341,7 +856,9 @@ auto BvhCollisionSystem::allocateNode() -> u32 {
 		return node;
 	}
 
-	nodes.push_back(Node{ .aabb = Aabb{ Vec2{ 0.0f }, Vec2{ 0.0f } } });
+	nodes.push_back(Node{});
+	nodeBounds.push_back(Aabb{ Vec2{ 0.0f }, Vec2{ 0.0f } });
+	leafMoved.push_back(false);
 	return static_cast<u32>(nodes.size() - 1);
 }
 
@@ -361,46 +878,14 @@ auto BvhCollisionSystem::node(u32 index) const -> const Node& {
 	return nodes[index];
 }
 
-auto BvhCollisionSystem::debugPrint(u32 rootNodeIndex) -> void {
-	put("%d\n", rootNodeIndex);
-
-	if (node(rootNodeIndex).isLeaf()) {
-		return;
-	}
-	debugPrintHelper(rootNodeIndex, 1);
+auto BvhCollisionSystem::bounds(u32 index) -> Aabb& {
+	return nodeBounds[index];
 }
 
-auto BvhCollisionSystem::debugPrintHelper(u32 rootNodeIndex, i32 depth) -> void {
-	if (node(rootNodeIndex).isLeaf()) {
-		return;
-	}
-
-	auto indent = [&depth]() {
-		for (i32 i = 0; i < depth; i++) put(" ");
-	};
-
-	indent();
-	put("%d\n", node(rootNodeIndex).children[0]);
-	debugPrintHelper(node(rootNode).children[0], depth + 1);
-	indent();
-	put("%d\n", node(rootNodeIndex).children[1]);
-	debugPrintHelper(node(rootNodeIndex).children[1], depth + 1);
+auto BvhCollisionSystem::bounds(u32 index) const -> const Aabb& {
+	return nodeBounds[index];
 }
 
-auto BvhCollisionSystem::debugDrawAabbs(u32 rootNodeIndex, i32 depth) -> void {
-	auto color = Vec3::RED;
-
-	auto& root = node(rootNodeIndex);
-	if (!root.isLeaf())
-		color = (depth % 2 == 0) ? Vec3::GREEN : Vec3::BLUE;
-
-	if (root.isLeaf()) {
-		Debug::drawAabb(root.aabb, color);
-		return;
-	}
-
-	debugDrawAabbs(root.children[0], depth + 1);
-	debugDrawAabbs(root.children[1], depth + 1);
-
-	Debug::drawAabb(Aabb{ root.aabb.min - Vec2{ 0.03f }, root.aabb.max + Vec2{ 0.03f } }, color);
-}
+bool BvhCollisionSystem::bulkBuild = true;
+float BvhCollisionSystem::rebuildAreaRatio = 0.0f;
+bool BvhCollisionSystem::wideTree = false;
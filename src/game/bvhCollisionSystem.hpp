@@ -2,53 +2,166 @@
 
 #include <utils/int.hpp>
 #include <math/aabb.hpp>
-#include <game/ent.hpp>
-#include <game/collisionSystem.hpp>
+#include <game/broadphase.hpp>
 
 #include <vector>
 
 #include <unordered_set>
 // TODO:
-// spatial hashing / bucketing
 // inactive flag on objects
 
 // The exact number of collisions pairs checked in the O(n^2) broadphase is choose(n, 2).
 // choose(n, 2) = n * (n - 1) / 2 = n^2 - n / 2. Taking the limit as n goes to infinity you just get n^2 / 2
 
-class BvhCollisionSystem {
+class BvhCollisionSystem : public Broadphase {
 public:
 	BvhCollisionSystem();
 
 private:
 	std::vector<u32> nodesToRemove;
 public:
-	auto update() -> void;
-	auto reset() -> void;
-	auto updateBvh() -> void;
-	auto detectCollisions(CollisionMap& collisions, const IgnoredCollisions& collisionsToIgnore) -> void;
-
-	auto raycast(Vec2 start, Vec2 end) const -> std::optional<RaycastResult>;
+	auto update() -> void override;
+	auto reset() -> void override;
+	auto reload() -> void override;
+	auto updateBvh(float dt, PhysicsProfile& profile) -> void override;
+	auto detectCollisions(float dt, CollisionMap& collisions, const IgnoredCollisions& collisionsToIgnore, JobSystem& jobSystem, PhysicsProfile& profile) -> void override;
+
+	// Iterates over the whole tree.
+	auto statistics() -> BvhStatistics;
+	// Builds the whole tree from scratch using the binned surface area heuristic. Gives a better tree than inserting the leaves one by one and the result doesn't depend on the order in which the bodies were created. O(n log n).
+	auto rebuild() -> void;
+	// Rebuilds the tree if rebuildAreaRatio is enabled and the area of the internal nodes grew by more than it since the last rebuild. Returns if the tree was rebuilt.
+	auto rebuildIfDegraded(const BvhStatistics& statistics) -> bool;
+
+	// When at least this many bodies are added in one update and they are at least a quarter of all the bodies the tree is rebuilt instead of inserting them one by one. This happens when loading levels and demos and when spawning many bodies at once.
+	static constexpr i32 BULK_BUILD_MIN_NEW_LEAVES = 64;
+	static bool bulkBuild;
+	// Zero disables rebuilding based on the tree quality.
+	static float rebuildAreaRatio;
+	// Find the pairs using a 4-wide copy of the tree. The result is the same.
+	static bool wideTree;
+	// When at least this fraction of the leaves moved the whole tree is traversed instead of querying the moved leaves, because the traversal visits each pair of subtrees once and runs on all threads.
+	static constexpr float FULL_TRAVERSAL_MOVED_LEAF_FRACTION = 0.25f;
+
+protected:
+	// Visits the nodes closest first.
+	auto visitRay(Vec2 start, Vec2 end, Vec2 halfSize, const RayVisitor& visitor) const -> void override;
+	auto visitAabb(const Aabb& aabb, const std::function<void(BodyId body, i32 shape)>& visitor) const -> void override;
 
 private:
-	auto raycastHelper(u32 nodeIndex, Vec2 start, Vec2 end) const -> std::optional<RaycastResult>;
-	auto clearCrossedFlag(u32 nodeIndex) -> void;
-	auto collide(CollisionMap& collisions, const IgnoredCollisions& collisionsToIgnore, u32 nodeA, u32 nodeB) -> void;
-
-	static auto addPaddingToAabb(const Aabb& aabb) -> Aabb;
-
-	CollisionMap newCollisions;
 
+	// Only the topology. The aabbs are stored in nodeBounds at the same index, because most of the nodes visited by the traversals are rejected by just looking at the aabb.
 	struct Node {
 		u32 parent;
 		u32 children[2];
 		BodyId body;
-		Aabb aabb;
-		bool childrenCrossChecked;
+		// The shape of the body the leaf stores.
+		i32 shape;
 		auto isLeaf() const -> bool { return children[0] == NULL_NODE; }
 	};
 
-	auto insert(BodyId bodyId) -> void;
-	auto insertHelper(u32 parentNode, u32 nodeToInsert) -> u32;
+	// A pair of leaves with overlapping aabbs. The pairs ignored by addPotentialPair are also stored, because whether they are ignored can change without the leaves moving.
+	struct LeafPair {
+		ShapePair key;
+		u32 leafA;
+		u32 leafB;
+	};
+	// The pair cache, like the one in Box2D's b2BroadPhase. Stores all the overlapping pairs of leaves sorted by CollisionMap::lessThan. The aabb of a leaf only changes when it is reinserted so only the pairs with a leaf from movedLeaves can start or stop overlapping. Those leaves are queried against the tree and the pairs of them that stopped overlapping are removed, which makes the cost depend on how much the bodies move instead of on the size of the scene.
+	std::vector<LeafPair> cachedPairs;
+	// Set when the pairs have to be found by traversing the whole tree.
+	bool pairCacheOutdated = true;
+	// The leaves whose aabbs changed since the last detectCollisions.
+	std::vector<u32> movedLeaves;
+	// Indexed by the node index.
+	std::vector<bool> leafMoved;
+	auto markLeafMoved(u32 leafNode) -> void;
+	// Finds all the overlapping pairs and replaces the cache with them.
+	auto findAllPairs(JobSystem& jobSystem) -> void;
+	// Updates the cache using the moved leaves.
+	auto updateCachedPairs(JobSystem& jobSystem) -> void;
+	// Finds the leaves overlapping the moved leaf. A pair of moved leaves is only reported by the one with the lower index.
+	auto queryMovedLeaf(u32 leafNode, std::vector<u32>& stack, std::vector<LeafPair>& found) const -> void;
+	std::vector<std::vector<LeafPair>> threadFoundPairs;
+	std::vector<LeafPair> foundPairs;
+	std::vector<LeafPair> mergedPairs;
+	std::vector<std::vector<u32>> threadQueryStacks;
+	struct StatisticsEntry {
+		u32 node;
+		i32 depth;
+	};
+	std::vector<StatisticsEntry> statisticsStack;
+	static auto leafPairLessThan(const LeafPair& a, const LeafPair& b) -> bool;
+
+	// The traversal doesn't modify the tree so the subtrees can be traversed on multiple threads at once.
+	// Finds the overlapping pairs of leaves inside the subtree.
+	auto collideSelf(u32 nodeIndex, std::vector<LeafPair>& found) const -> void;
+	// Finds the overlapping pairs with one leaf in each subtree.
+	auto collideCross(u32 nodeA, u32 nodeB, std::vector<LeafPair>& found) const -> void;
+
+	// A collideSelf call if nodeB is NULL_NODE else a collideCross call.
+	struct TraversalTask {
+		u32 nodeA;
+		u32 nodeB;
+	};
+	// Splits the traversal of the top levels of the tree into tasks that can run in parallel. Doesn't depend on the thread count, but the result wouldn't change if it did, because the pairs get sorted anyway.
+	auto addTraversalTasks(u32 nodeA, u32 nodeB, i32 depth) -> void;
+	std::vector<TraversalTask> traversalTasks;
+
+	// A node of the 4-wide tree. The bounds of the children are stored as a structure of arrays so a box can be tested against all of them at once. Unused children have inverted bounds, which never overlap anything.
+	struct alignas(16) WideNode {
+		float minX[4];
+		float minY[4];
+		float maxX[4];
+		float maxY[4];
+		// Indices into wideNodes or, if WIDE_LEAF_BIT is set, into nodes.
+		u32 children[4];
+	};
+	static constexpr u32 WIDE_LEAF_BIT = 1u << 31;
+	// Collapses the binary tree by replacing the biggest internal children with their children until there are 4 of them. Only redone after the binary tree changes.
+	auto buildWideTree() -> void;
+	auto buildWideNode(u32 binaryNode) -> u32;
+	// Returns a bit for each child of the node that overlaps the aabb.
+	static auto overlappingChildren(const WideNode& node, const Aabb& aabb) -> i32;
+	static auto childBounds(const WideNode& node, i32 childIndex) -> Aabb;
+	// The same traversal as collideSelf and collideCross, but visiting the children 4 at a time.
+	auto collideSelfWide(u32 wideNode, std::vector<LeafPair>& found) const -> void;
+	// The nodes can be wide nodes or leaves marked with WIDE_LEAF_BIT.
+	auto collideCrossWide(u32 a, const Aabb& aAabb, u32 b, const Aabb& bAabb, std::vector<LeafPair>& found) const -> void;
+	// Like TraversalTask. Stores the aabbs, because the wide nodes only store the aabbs of their children.
+	struct WideTraversalTask {
+		u32 a;
+		Aabb aAabb;
+		u32 b;
+		Aabb bAabb;
+	};
+	auto addWideTraversalTasks(u32 a, const Aabb& aAabb, u32 b, const Aabb& bAabb, i32 depth) -> void;
+	std::vector<WideTraversalTask> wideTraversalTasks;
+	std::vector<WideNode> wideNodes;
+	u32 wideRootNode = NULL_NODE;
+	bool wideTreeOutdated = true;
+
+	// Creates a leaf node for every shape of the body and appends them to leafNodes, but doesn't insert them into the tree.
+	auto createLeafNodes(BodyId bodyId) -> void;
+	// Inserts the node as a sibling of the node found by findBestSibling.
+	auto insertLeaf(u32 leafNode) -> void;
+	// Branch and bound search for the sibling that minimizes the surface area heuristic cost described by Erin Catto in "Dynamic Bounding Volume Hierarchies" at GDC 2019. The cost of making a node the sibling is the area of the new parent plus the increase in the areas of all the ancestors, which is inherited from the parent. A subtree is skipped when even a leaf fully contained in it couldn't be cheaper than the best sibling found so far.
+	auto findBestSibling(const Aabb& leafAabb) -> u32;
+	struct SiblingCandidate {
+		u32 node;
+		float inheritedCost;
+	};
+	// Returns the root of the subtree built from buildNodes in [begin, end).
+	auto buildHelper(i32 begin, i32 end) -> u32;
+	std::vector<u32> buildNodes;
+	std::vector<u32> newLeafNodes;
+	float internalNodeAreaAfterRebuild = 0.0f;
+
+	// The priority queue used by findBestSibling.
+	std::vector<SiblingCandidate> siblingCandidates;
+	// Recomputes the aabbs of the node and all its ancestors. If rotate is true also tries to rotate each of them.
+	auto refit(u32 nodeIndex, bool rotate) -> void;
+	// Swaps a child of the node with a grandchild if it decreases the area of the other child. This fixes trees that degenerated after many insertions in the same direction, for example when bodies are spawned along a line.
+	auto rotateNode(u32 nodeIndex) -> void;
 
 	auto removeLeafNode(u32 nodeToRemove) -> void;
 
@@ -60,11 +173,15 @@ private:
 	auto freeNode(u32 index) -> void;
 	auto node(u32 index) -> Node&;
 	auto node(u32 index) const -> const Node&;
+	auto bounds(u32 index) -> Aabb&;
+	auto bounds(u32 index) const -> const Aabb&;
 	auto debugPrint(u32 rootNodeIndex) -> void;
 	auto debugPrintHelper(u32 rootNodeIndex, i32 depth) -> void;
 	auto debugDrawAabbs(u32 rootNodeIndex, i32 depth = 0) -> void;
 
 	// Handles can get invalidated on a allocate call. Could create a class with an overloaded opeartor->, but it would need to store the instance of the collision system inside it.
 	std::vector<Node> nodes;
+	// Aabb is 4 floats so the array is 16 byte aligned like the allocation.
+	std::vector<Aabb> nodeBounds;
 	std::vector<u32> freeNodes;
 };
\ No newline at end of file
@@ -0,0 +1,49 @@
+// The debug helpers are kept separate, because they depend on the engine and the physics core has to build without it.
+#include <game/bvhCollisionSystem.hpp>
+#include <utils/io.hpp>
+#include <engine/debug.hpp>
+
+auto BvhCollisionSystem::debugPrint(u32 rootNodeIndex) -> void {
+	put("%d\n", rootNodeIndex);
+
+	if (node(rootNodeIndex).isLeaf()) {
+		return;
+	}
+	debugPrintHelper(rootNodeIndex, 1);
+}
+
+auto BvhCollisionSystem::debugPrintHelper(u32 rootNodeIndex, i32 depth) -> void {
+	if (node(rootNodeIndex).isLeaf()) {
+		return;
+	}
+
+	auto indent = [&depth]() {
+		for (i32 i = 0; i < depth; i++) put(" ");
+	};
+
+	indent();
+	put("%d\n", node(rootNodeIndex).children[0]);
+	debugPrintHelper(node(rootNode).children[0], depth + 1);
+	indent();
+	put("%d\n", node(rootNodeIndex).children[1]);
+	debugPrintHelper(node(rootNodeIndex).children[1], depth + 1);
+}
+
+auto BvhCollisionSystem::debugDrawAabbs(u32 rootNodeIndex, i32 depth) -> void {
+	auto color = Vec3::RED;
+
+	auto& root = node(rootNodeIndex);
+	if (!root.isLeaf())
+		color = (depth % 2 == 0) ? Vec3::GREEN : Vec3::BLUE;
+
+	if (root.isLeaf()) {
+		Debug::drawAabb(bounds(rootNodeIndex), color);
+		return;
+	}
+
+	debugDrawAabbs(root.children[0], depth + 1);
+	debugDrawAabbs(root.children[1], depth + 1);
+
+	const auto& aabb = bounds(rootNodeIndex);
+	Debug::drawAabb(Aabb{ aabb.min - Vec2{ 0.03f }, aabb.max + Vec2{ 0.03f } }, color);
+}
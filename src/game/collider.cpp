@@ -40,3 +40,84 @@ auto CircleCollider::massInfo(float density) const -> MassInfo {
 auto CircleCollider::aabb(const Transform& transform) const -> Aabb {
 	return Aabb{ transform.pos + Vec2{ -radius }, transform.pos + Vec2{ radius } };
 }
+
+// The center of mass of a shape with uniform density in the space of the shape.
+static auto centroid(const Collider& collider) -> Vec2 {
+	const auto polygon = std::get_if<ConvexPolygon>(&collider);
+	if (polygon == nullptr)
+		return Vec2{ 0.0f };
+	// The centroids of the triangles between the origin and the edges weighted by their signed areas.
+	auto twiceArea = 0.0f;
+	Vec2 weightedSum{ 0.0f };
+	for (usize i = 0; i < polygon->verts.size(); i++) {
+		const auto& a = polygon->verts[i];
+		const auto& b = polygon->verts[(i + 1) % polygon->verts.size()];
+		const auto twiceTriangleArea = det(a, b);
+		twiceArea += twiceTriangleArea;
+		weightedSum += (a + b) * twiceTriangleArea;
+	}
+	if (twiceArea == 0.0f)
+		return Vec2{ 0.0f };
+	return weightedSum / (twiceArea * 3.0f);
+}
+
+auto CompoundCollider::centerChildren() -> Vec2 {
+	auto mass = 0.0f;
+	Vec2 weightedSum{ 0.0f };
+	for (auto& child : children) {
+		// ConvexPolygon::massInfo computes the inertia around the origin of the polygon, which is only right if the origin is inside it.
+		if (const auto polygon = std::get_if<ConvexPolygon>(&child.collider)) {
+			const auto center = centroid(child.collider);
+			for (auto& vert : polygon->verts) {
+				vert -= center;
+			}
+			child.transform.pos = center * child.transform;
+		}
+		// The density doesn't change the center of mass.
+		const auto childMass = ::massInfo(child.collider, 1.0f).mass;
+		mass += childMass;
+		weightedSum += child.transform.pos * childMass;
+	}
+	if (mass == 0.0f)
+		return Vec2{ 0.0f };
+	const auto center = weightedSum / mass;
+	for (auto& child : children) {
+		child.transform.pos -= center;
+	}
+	return center;
+}
+
+auto CompoundCollider::massInfo(float density) const -> MassInfo {
+	MassInfo result{ 0.0f, 0.0f };
+	for (const auto& child : children) {
+		const auto info = ::massInfo(child.collider, density);
+		result.mass += info.mass;
+		// The parallel axis theorem. The inertias of the children are around their centers of mass.
+		result.rotationalInertia += info.rotationalInertia + info.mass * dot(child.transform.pos, child.transform.pos);
+	}
+	return result;
+}
+
+auto CompoundCollider::aabb(const Transform& transform) const -> Aabb {
+	ASSERT(!children.empty());
+	Aabb result{ Vec2{ std::numeric_limits<float>::infinity() }, Vec2{ -std::numeric_limits<float>::infinity() } };
+	for (const auto& child : children) {
+		result = result.combined(::aabb(child.collider, child.transform * transform));
+	}
+	return result;
+}
+
+auto shapeCount(const Collider& collider) -> i32 {
+	if (const auto compound = std::get_if<CompoundCollider>(&collider))
+		return static_cast<i32>(compound->children.size());
+	return 1;
+}
+
+auto colliderShape(const Collider& collider, const Transform& transform, i32 shapeIndex) -> ColliderShape {
+	if (const auto compound = std::get_if<CompoundCollider>(&collider)) {
+		const auto& child = compound->children[shapeIndex];
+		return ColliderShape{ child.collider, child.transform * transform };
+	}
+	ASSERT(shapeIndex == 0);
+	return ColliderShape{ collider, transform };
+}
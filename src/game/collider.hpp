@@ -5,8 +5,10 @@
 #include <math/lineSegment.hpp>
 
 #include <math/transform.hpp>
+#include <utils/smallVec.hpp>
 
 #include <variant>
+#include <vector>
 
 struct MassInfo {
 	float mass;
@@ -18,9 +20,11 @@ struct ConvexPolygon {
 
 	static auto regular(i32 vertCount, float radius) -> ConvexPolygon;
 
-	std::vector<Vec2> verts;
+	// Most polygons have few verts so they are stored inside the collider. Then creating and copying bodies doesn't allocate and the narrowphase reads them from the memory of the body. Bigger hulls are stored on the heap.
+	static constexpr usize INLINE_VERTS = 12;
+	SmallVec<Vec2, INLINE_VERTS> verts;
 	// The normal i belong to the face with endpoints verts[i] and verts[(i + 1) % size].
-	std::vector<Vec2> normals;
+	SmallVec<Vec2, INLINE_VERTS> normals;
 
 	auto calculateNormals() -> void;
 
@@ -44,11 +48,41 @@ struct BoxCollider {
 	auto getEdges(const Transform& transform) const->std::array<LineSegment, 4>;
 };
 
-using Collider = std::variant<BoxCollider, CircleCollider, ConvexPolygon>;
+struct CompoundChild;
+
+// Multiple convex shapes rigidly attached to one body, for concave shapes like the triangulations of the outlines from marchingSquares. Welding separate bodies together with joints costs solver iterations and the joints still stretch.
+// Every child has its own leaf in the broadphase and the narrowphase collides the children separately, so each pair of children gets its own Collision. The children can't be compounds.
+struct CompoundCollider {
+	std::vector<CompoundChild> children;
+
+	// The bodies rotate around their positions, so the center of mass of the children should be at the origin. Moves the children so it is and returns by how much, the body has to be moved back by the returned offset to stay in place.
+	auto centerChildren() -> Vec2;
+
+	auto massInfo(float density) const->MassInfo;
+	auto aabb(const Transform& transform) const->Aabb;
+};
+
+using Collider = std::variant<BoxCollider, CircleCollider, ConvexPolygon, CompoundCollider>;
+
+struct CompoundChild {
+	// Relative to the body.
+	Transform transform;
+	Collider collider;
+};
 
 auto massInfo(const Collider& collider, float density) -> MassInfo;
 auto aabb(const Collider& collider, const Transform& transform) -> Aabb;
 
+// The parts of a collider the broadphase stores as separate leaves and the narrowphase collides separately. Compound colliders have a shape for each child and the other colliders are a single shape with the index 0.
+auto shapeCount(const Collider& collider) -> i32;
+struct ColliderShape {
+	// Never a compound.
+	const Collider& collider;
+	Transform transform;
+};
+// The transform is the transform of the whole collider.
+auto colliderShape(const Collider& collider, const Transform& transform, i32 shapeIndex) -> ColliderShape;
+
 //using Shape = std::variant<BoxCollider, CircleCollider>;
 //struct Collider {
 //	Shape shape;
@@ -1,13 +1,18 @@
 #include <game/collision.hpp>
-#include <game/game.hpp>
+#include <game/physicsWorld.hpp>
 #include <math/mat2.hpp>
 #include <math/utils.hpp>
+#include <utils/overloaded.hpp>
+#include <utils/span.hpp>
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
 #include <math/transform.hpp>
 
 // When a collision between 2 bodies happens and a collision between the same bodies happened on last frame too, the frame accumulators of contacts with the same features are transfered over.
 auto Collision::update(const Collision& newCollision) -> void {
-	if (!Game::warmStarting) {
+	if (!PhysicsWorld::warmStarting) {
 		*this = newCollision;
 		for (i8 i = 0; i < contactCount; i++) {
 			contacts[i].invNormalEffectiveMass = 0.0f;
@@ -46,6 +51,8 @@ auto Collision::update(const Collision& newCollision) -> void {
 		contacts[i] = mergedContacts[i];
 
 	contactCount = newCollision.contactCount;
+	satCache = newCollision.satCache;
+	gjkCache = newCollision.gjkCache;
 }
 
 auto Collision::preStep(Body& a, Body& b, float invDeltaTime) -> void {
@@ -66,8 +73,10 @@ auto Collision::preStep(Body& a, Body& b, float invDeltaTime) -> void {
 
 		/*Vec2 r1 = (c.pos + normal * c.separation) - a.pos;
 		Vec2 r2 = c.pos - b.pos;*/
-		Vec2 r1 = (c.pos + normal * c.separation) - a.transform.pos;
+		Vec2 r1 = (c.pos - normal * c.separation) - a.transform.pos;
 		Vec2 r2 = c.pos - b.transform.pos;
+		c.r1 = r1;
+		c.r2 = r2;
 
 		// Precompute normal mass, tangent mass, and bias.
 		float rn1 = dot(r1, normal);
@@ -95,8 +104,12 @@ auto Collision::preStep(Body& a, Body& b, float invDeltaTime) -> void {
 
 		auto relativeVelAtContact = (b.vel + cross(b.angularVel, r2)) - (a.vel + cross(a.angularVel, r1));
 
-		/*c.bias = -biasFactor * invDeltaTime * std::min(0.0f, c.separation + ALLOWED_PENETRATION);*/
-		c.bias = -biasFactor * invDeltaTime * std::min(0.0f, -std::abs(c.separation) + ALLOWED_PENETRATION);
+		if (c.separation > 0.0f) {
+			// A speculative contact. The bodies can still approach each other by the separation in this step. The impulse only becomes positive if they would overlap at the end of the step, so it doesn't push them apart before they touch.
+			c.bias = -c.separation * invDeltaTime;
+		} else {
+			c.bias = -biasFactor * invDeltaTime * std::min(0.0f, c.separation + ALLOWED_PENETRATION);
+		}
 		/*c->bias = std::max(c->bias, -dot(b->vel - a->vel, c->normal)) * 0.5f;*/
 		
 		//TODO: Slops
@@ -114,7 +127,7 @@ auto Collision::preStep(Body& a, Body& b, float invDeltaTime) -> void {
 
 
 		// Warm starting does nothing without accumulate impulses, but accumulate impulses transfers impulses between applyImpulse calls.
-		if (Game::accumulateImpulses) {
+		if (PhysicsWorld::accumulateImpulses) {
 			// Apply normal + friction impulse
 			Vec2 P = c.accumulatedNormalImpluse * normal + c.accumulatedTangentImpulse * tangent;
 
@@ -127,15 +140,13 @@ auto Collision::preStep(Body& a, Body& b, float invDeltaTime) -> void {
 	}
 }
 
-auto Collision::applyImpulse(Body& a, Body& b) -> void {
+auto Collision::applyImpulse(SolverBody& a, SolverBody& b) -> void {
 	for (i32 i = 0; i < contactCount; i++) {
 		auto& contact = contacts[i];
 		//ASSERT(contact.separation <= 0.0f);
 
-		/*const auto r1 = contact.pos - a.transform.pos;
-		const auto r2 = contact.pos - b.transform.pos;*/
-		Vec2 r1 = (contact.pos + normal * contact.separation) - a.transform.pos;
-		Vec2 r2 = contact.pos - b.transform.pos;
+		const auto r1 = contact.r1;
+		const auto r2 = contact.r2;
 		auto relativeVelAtContact = (b.vel + cross(b.angularVel, r2)) - (a.vel + cross(a.angularVel, r1));
 
 		// Compute normal impulse
@@ -144,7 +155,7 @@ auto Collision::applyImpulse(Body& a, Body& b) -> void {
 
 		auto normalImpulse = contact.invNormalEffectiveMass * (-velocityAlongNormal + contact.bias);
 
-		if (Game::accumulateImpulses) {
+		if (PhysicsWorld::accumulateImpulses) {
 			const auto oldNormalImpluse = contact.accumulatedNormalImpluse;
 			contact.accumulatedNormalImpluse = std::max(oldNormalImpluse + normalImpulse, 0.0f);
 			normalImpulse = contact.accumulatedNormalImpluse - oldNormalImpluse;
@@ -166,7 +177,7 @@ auto Collision::applyImpulse(Body& a, Body& b) -> void {
 		float velocityAlongTangent = dot(relativeVelAtContact, tangent);
 		float tangentImpulse = contact.invTangentEffectiveMass * (-velocityAlongTangent);
 
-		if (Game::accumulateImpulses) {
+		if (PhysicsWorld::accumulateImpulses) {
 			const auto max = coefficientOfFriction * contact.accumulatedNormalImpluse;
 			const auto oldTangentImpulse = contact.accumulatedTangentImpulse;
 			contact.accumulatedTangentImpulse = std::clamp(oldTangentImpulse + tangentImpulse, -max, max);
@@ -190,7 +201,7 @@ auto BoxCollider::massInfo(float density) const -> MassInfo {
 	const auto mass = size.x * size.y * density;
 	return MassInfo{
 		.mass = mass,
-		.rotationalInertia = mass * pow(size.x, 2.0f) * pow(size.y, 2.0f) / 12.0f
+		.rotationalInertia = mass * (pow(size.x, 2.0f) + pow(size.y, 2.0f)) / 12.0f
 	};
 }
 // If there is a std::visit error check if the function is const.
@@ -213,51 +224,73 @@ auto aabb(const Collider& collider, const Transform& transform) -> Aabb {
 	);
 }
 
-auto collide(const Transform& aTransform, const Collider& aCollider, const Transform& bTransform, const Collider& bCollider) -> std::optional<Collision>
-{
-#define GET(collider, name, type) const auto name = std::get_if<type>(&collider); name != nullptr
-
-	if (GET(aCollider, aBox, BoxCollider)) {
-		if (GET(bCollider, bBox, BoxCollider)) {
-			return collide(aTransform, *aBox, bTransform, *bBox);
-		} else if (GET(bCollider, bCircle, CircleCollider)) {
-			return collide(aTransform, *aBox, bTransform, *bCircle);
-		} else if (GET(bCollider, bPoly, ConvexPolygon)) {
-			static ConvexPolygon aShape{ .verts = std::vector<Vec2>(4, Vec2{ 0.0f }), .normals = std::vector<Vec2>(4, Vec2{ 0.0f }) };
-			aShape.verts[3] = aBox->size / 2.0f;
-			aShape.verts[2] = Vec2{ aBox->size.x, -aBox->size.y } / 2.0f;
-			aShape.verts[1] = -aBox->size / 2.0f;
-			aShape.verts[0] = Vec2{ -aBox->size.x, aBox->size.y } / 2.0f;
-			aShape.calculateNormals();
-			return collide(aTransform, aShape, bTransform, *bPoly);
-		}
-	} else if (GET(aCollider, aCircle, CircleCollider)) {
-		if (GET(bCollider, bCircle, CircleCollider)) {
-			return collide(aTransform, *aCircle, bTransform, *bCircle);
-		} else if (GET(bCollider, bBox, BoxCollider)) {
-			auto collision = collide(bTransform, *bBox, aTransform, *aCircle);
-			if (collision.has_value()) {
-				collision->normal = -collision->normal;
-			}
-			return collision;
-		}
-	} else if (GET(aCollider, aPoly, ConvexPolygon)) {
-		if (GET(bCollider, bPoly, ConvexPolygon)) {
-			return collide(aTransform, *aPoly, bTransform, *bPoly);
-		} else if (GET(bCollider, bBox, BoxCollider)) {
-			static ConvexPolygon bShape{ .verts = std::vector<Vec2>(4, Vec2{ 0.0f }), .normals = std::vector<Vec2>(4, Vec2{ 0.0f }) };
-			bShape.verts[3] = bBox->size / 2.0f;
-			bShape.verts[2] = Vec2{ bBox->size.x, -bBox->size.y } / 2.0f;
-			bShape.verts[1] = -bBox->size / 2.0f;
-			bShape.verts[0] = Vec2{ -bBox->size.x, bBox->size.y } / 2.0f;
-			bShape.calculateNormals();
-			return collide(aTransform, *aPoly, bTransform, bShape);
-		}
+auto colliderTypeName(usize typeIndex) -> const char* {
+	static constexpr const char* names[]{ "box", "circle", "polygon", "compound" };
+	static_assert(std::size(names) == std::variant_size_v<Collider>);
+	if (typeIndex >= std::size(names)) {
+		ASSERT_NOT_REACHED();
+		return "";
 	}
-	// Remember to flip the normal if the arguments are in the opposite order.
+	return names[typeIndex];
+}
 
-	ASSERT_NOT_REACHED();
-	return std::nullopt;
+using CollideFunction = auto (*)(const Transform&, const Collider&, const Transform&, const Collider&, float, SatCache*) -> std::optional<Collision>;
+
+// The pairs without circles use SAT.
+template<typename A, typename B>
+static constexpr auto USES_SAT = !std::is_same_v<A, CircleCollider> && !std::is_same_v<B, CircleCollider>;
+
+// The table already checked the types so the variants don't need to be visited.
+template<typename A, typename B>
+static auto collideKernel(const Transform& aTransform, const Collider& aCollider, const Transform& bTransform, const Collider& bCollider, float speculativeDistance, SatCache* cache) -> std::optional<Collision> {
+	if constexpr (USES_SAT<A, B>) {
+		return collide(aTransform, *std::get_if<A>(&aCollider), bTransform, *std::get_if<B>(&bCollider), speculativeDistance, cache);
+	} else {
+		return collide(aTransform, *std::get_if<A>(&aCollider), bTransform, *std::get_if<B>(&bCollider), speculativeDistance);
+	}
+}
+
+// Swaps the roles of the bodies in a collision computed with the arguments in the opposite order.
+static auto flip(Collision& collision) -> void {
+	collision.normal = -collision.normal;
+	for (i32 i = 0; i < collision.contactCount; i++) {
+		auto& point = collision.contacts[i];
+		// The point has to be on the new body B.
+		point.pos = point.pos + collision.normal * point.separation;
+		std::swap(point.id.featureOnA, point.id.featureOnB);
+		std::swap(point.id.featureOnAIndex, point.id.featureOnBIndex);
+	}
+}
+
+template<typename A, typename B>
+static auto collideFlipped(const Transform& aTransform, const Collider& aCollider, const Transform& bTransform, const Collider& bCollider, float speculativeDistance, SatCache*) -> std::optional<Collision> {
+	static_assert(!USES_SAT<A, B>, "The cache would store the face on the wrong body.");
+	auto collision = collide(bTransform, *std::get_if<B>(&bCollider), aTransform, *std::get_if<A>(&aCollider), speculativeDistance);
+	if (collision.has_value()) {
+		flip(*collision);
+	}
+	return collision;
+}
+
+// Indexed by the indices of the types in the Collider variant. The pairs that only have a kernel for the other order use it and flip the result.
+static constexpr CollideFunction collideFunctions[PhysicsProfile::COLLIDER_TYPE_COUNT][PhysicsProfile::COLLIDER_TYPE_COUNT]{
+	{ collideKernel<BoxCollider, BoxCollider>, collideKernel<BoxCollider, CircleCollider>, collideKernel<BoxCollider, ConvexPolygon> },
+	{ collideFlipped<CircleCollider, BoxCollider>, collideKernel<CircleCollider, CircleCollider>, collideFlipped<CircleCollider, ConvexPolygon> },
+	{ collideKernel<ConvexPolygon, BoxCollider>, collideKernel<ConvexPolygon, CircleCollider>, collideKernel<ConvexPolygon, ConvexPolygon> },
+};
+// The compounds are last so the types of their children can index the table.
+static_assert(PhysicsProfile::COLLIDER_TYPE_COUNT == std::variant_size_v<Collider> - 1);
+static_assert(std::is_same_v<std::variant_alternative_t<0, Collider>, BoxCollider>);
+static_assert(std::is_same_v<std::variant_alternative_t<1, Collider>, CircleCollider>);
+static_assert(std::is_same_v<std::variant_alternative_t<2, Collider>, ConvexPolygon>);
+static_assert(std::is_same_v<std::variant_alternative_t<3, Collider>, CompoundCollider>);
+
+auto collide(const Transform& aTransform, const Collider& aCollider, const Transform& bTransform, const Collider& bCollider, float speculativeDistance, SatCache* cache) -> std::optional<Collision> {
+	if (std::holds_alternative<CompoundCollider>(aCollider) || std::holds_alternative<CompoundCollider>(bCollider)) {
+		ASSERT_NOT_REACHED();
+		return std::nullopt;
+	}
+	return collideFunctions[aCollider.index()][bCollider.index()](aTransform, aCollider, bTransform, bCollider, speculativeDistance, cache);
 }
 
 auto contains(Vec2 point, Vec2 pos, float orientation, const Collider& collider) -> bool {
@@ -269,144 +302,216 @@ auto contains(Vec2 point, Vec2 pos, float orientation, const Collider& collider)
 	);
 }
 
-struct Separation {
-	float separation;
-	i16 edgeIndex;
+// The verts and normals of a polygon, which can also point to arrays on the stack, so boxes don't have to be converted into ConvexPolygons.
+struct PolygonView {
+	Span<const Vec2> verts;
+	Span<const Vec2> normals;
 };
 
-// Performs SAT on the shapes a and b. To separate shapes translate shape b by a.normals[edgeIndex] * separation. Returns nullopt if the shapes are already separating.
-static auto minSeparation(const std::vector<Vec2>& aVerts, const std::vector<Vec2>& aNormals, const Transform& aTransform, const std::vector<Vec2>& bVerts, const Transform& bTransform) -> std::optional<Separation> {
-	// Finds the axis of least separation. The least distance the shapes need to be translated to stop overlapping. For example when you put the a box on to of a box then their shadows fully overlap so the least separation, not the max separation axis / face normal is desired.
-	auto minSeparation = std::numeric_limits<float>::infinity();
-	i16 minSeparationNormalIndex = 0;
-
-	for (i16 normalIndex = 0; normalIndex < aNormals.size(); normalIndex++) {
-		const auto n = aNormals[normalIndex];
-
-		// min and max offsets of vertices of a and b along the normal n (the projections onto the normal). 
-		auto minA = std::numeric_limits<float>::infinity();
-		auto maxA = -std::numeric_limits<float>::infinity();
-		auto minB = minA;
-		auto maxB = maxA;
-
-		for (auto v : aVerts) {
-			const auto d = dot(n, v);
-			if (d < minA) minA = d;
-			if (d > maxA) maxA = d;
-		}
-
-		const auto bToAObjectSpace = bTransform * aTransform.inversed();
-		for (auto v : bVerts) {
-			// Convert only B into A's object space instead of converting everything into world space to reduce calculations. 
-			v *= bToAObjectSpace;
-			const auto d = dot(n, v);
-			if (d < minB) minB = d;
-			if (d > maxB) maxB = d;
-		}
-
-		if (const auto projectionsOverlap = minA <= maxB && maxA >= minB) {
-			auto separation = maxA - minB;
-			if (separation < minSeparation) {
-				minSeparation = separation;
-				minSeparationNormalIndex = normalIndex;
-			}
-		} else {
-			// If there is any axis on which the projections don't overlap the shapes don't overlap. To optimize could store this axis and check it first the next frame.
-			return std::nullopt;
-		}
+static auto polygonView(const ConvexPolygon& polygon) -> PolygonView {
+	return PolygonView{
+		Span<const Vec2>{ polygon.verts.data(), polygon.verts.size() },
+		Span<const Vec2>{ polygon.normals.data(), polygon.normals.size() }
+	};
+}
+
+// The normals of a box in the order of the polygon made from boxVerts, so a box has the same feature indices in all the kernels.
+static constexpr Vec2 BOX_NORMALS[4]{ Vec2{ -1.0f, 0.0f }, Vec2{ 0.0f, -1.0f }, Vec2{ 1.0f, 0.0f }, Vec2{ 0.0f, 1.0f } };
+
+static auto boxVert(Vec2 halfSize, i16 index) -> Vec2 {
+	switch (index) {
+	case 0: return Vec2{ -halfSize.x, halfSize.y };
+	case 1: return -halfSize;
+	case 2: return Vec2{ halfSize.x, -halfSize.y };
+	default: return halfSize;
 	}
+}
 
-	return Separation{
-		minSeparation,
-		minSeparationNormalIndex
-	};
+static auto boxVerts(Vec2 halfSize, Vec2 (&verts)[4]) -> void {
+	for (i16 i = 0; i < 4; i++) {
+		verts[i] = boxVert(halfSize, i);
+	}
 }
 
-struct Contact {
-	Vec2 pos;
-	float penetration;
-};
+// The separation along the normal normalIndex of a. To separate shapes translate shape b by a.normals[normalIndex] * separation. A negative separation is the distance between the shapes along that normal.
+static auto polygonSeparation(PolygonView a, i16 normalIndex, PolygonView b, const Transform& bToAObjectSpace) -> float {
+	const auto n = a.normals[normalIndex];
 
-// The computed contact manifold tries to approximate the contact points at which the collision started. These points are only an approximation.
-// This code often uses face indices as vertex indices, this is explained in ConvexPolygon.
-auto collide(const Transform& aTransform, const ConvexPolygon& a, const Transform& bTransform, const ConvexPolygon& b) -> std::optional<Collision> {
-	// minSeparation() only checks the normals of the first arguments so both shapes have to be tested.
-	const auto aSeparation = minSeparation(a.verts, a.normals, aTransform, b.verts, bTransform);
-	if (!aSeparation.has_value())
-		return std::nullopt;
+	// min and max offsets of vertices of a and b along the normal n (the projections onto the normal). 
+	auto maxA = -std::numeric_limits<float>::infinity();
+	auto minB = std::numeric_limits<float>::infinity();
 
-	const auto bSeparation = minSeparation(b.verts, b.normals, bTransform, a.verts, aTransform);
-	if (!bSeparation.has_value())
-		return std::nullopt;
+	for (auto v : a.verts) {
+		const auto d = dot(n, v);
+		if (d > maxA) maxA = d;
+	}
 
-	const ConvexPolygon* reference;
-	const Transform* referenceTransform;
-	const ConvexPolygon* incident;
-	const Transform* incidentTransform;
-	i16 referenceFaceIndex;
-
-	if (aSeparation->separation < bSeparation->separation) {
-		reference = &a;
-		incident = &b;
-		referenceTransform = &aTransform;
-		incidentTransform = &bTransform;
-		referenceFaceIndex = aSeparation->edgeIndex;
-	} else {
-		reference = &b;
-		incident = &a;
-		referenceTransform = &bTransform;
-		incidentTransform = &aTransform;
-		referenceFaceIndex = bSeparation->edgeIndex;
+	for (auto v : b.verts) {
+		// Convert only B into A's object space instead of converting everything into world space to reduce calculations. 
+		v *= bToAObjectSpace;
+		const auto d = dot(n, v);
+		if (d < minB) minB = d;
 	}
 
-	const auto normal = reference->normals[referenceFaceIndex] * referenceTransform->rot;
-	i16 furthestVertOfIndidentInsideReference = 0;
-	auto maxDistance = std::numeric_limits<float>::infinity();
-	for (i16 i = 0; i < incident->verts.size(); i++) {
-		const auto d = dot(normal, incident->verts[i] * *incidentTransform);
-		// Using less than because the normal points towards the shape so the get the furthest point inside you need to find the smallest value of the projection.
-		if (d < maxDistance) {
-			maxDistance = d;
-			furthestVertOfIndidentInsideReference = i;
+	// Only b being in front of the face matters. If b is behind it the shapes don't overlap, but then they are separated along some other normal of a or b with the other shape in front of it, which is also the axis that gives the distance for speculative contacts.
+	return maxA - minB;
+}
+
+// polygonSeparation specialized for boxes, for all the BOX_NORMALS of a. The projection of a box onto an axis is its center plus minus the sum of the half sizes scaled by the absolute values of the dot products of the axis with the box axes, so the verts don't have to be projected. The opposite faces of a have the same axis.
+static auto boxSeparations(Vec2 aHalfSize, Vec2 bHalfSize, const Transform& bToAObjectSpace) -> std::array<float, 4> {
+	const auto bCenter = bToAObjectSpace.pos;
+	const auto bAxisX = Vec2{ 1.0f, 0.0f } * bToAObjectSpace.rot;
+	const auto bAxisY = Vec2{ 0.0f, 1.0f } * bToAObjectSpace.rot;
+	const Vec2 bExtent{
+		bHalfSize.x * std::abs(bAxisX.x) + bHalfSize.y * std::abs(bAxisY.x),
+		bHalfSize.x * std::abs(bAxisX.y) + bHalfSize.y * std::abs(bAxisY.y)
+	};
+	// maxA - minB along each of the BOX_NORMALS.
+	return {
+		aHalfSize.x + bExtent.x + bCenter.x,
+		aHalfSize.y + bExtent.y + bCenter.y,
+		aHalfSize.x + bExtent.x - bCenter.x,
+		aHalfSize.y + bExtent.y - bCenter.y,
+	};
+}
+
+static auto maxVertLength(Span<const Vec2> verts) -> float {
+	auto result = 0.0f;
+	for (const auto& vert : verts) {
+		result = std::max(result, vert.length());
+	}
+	return result;
+}
+
+struct ReferenceFace {
+	i16 index;
+	bool isOnB;
+};
+
+// Performs SAT on the shapes a and b and chooses the face with the least separation as the reference face. For example when you put the a box on to of a box then their shadows fully overlap so the least separation, not the max separation axis / face normal is desired. Returns nullopt if the shapes are separated by more than maxDistance along some normal.
+// aSeparation(i) is the separation along the normal i of a like in polygonSeparation and bSeparation(i) the same for b. The radii are the maxVertLengths, only used if there is a cache.
+// If the cache is valid the cached face is tested first. It is kept if it isn't worse than the best face by more than SAT_CACHE_TOLERANCE and the full SAT is skipped if the shapes moved too little relative to each other for it to stop being kept. Writes the new cache.
+template<typename ASeparation, typename BSeparation>
+static auto chooseReferenceFace(i16 aNormalCount, const ASeparation& aSeparation, i16 bNormalCount, const BSeparation& bSeparation, const Transform& bToAObjectSpace, float aRadius, float bRadius, float maxDistance, SatCache* cache) -> std::optional<ReferenceFace> {
+	const auto separation = [&](ReferenceFace face) -> float {
+		return face.isOnB ? bSeparation(face.index) : aSeparation(face.index);
+	};
+	const auto aPosInB = cache == nullptr ? Vec2{ 0.0f } : bToAObjectSpace.inversed().pos;
+	const Vec2 rotation{ bToAObjectSpace.rot.cos, bToAObjectSpace.rot.sin };
+
+	std::optional<ReferenceFace> cachedFace;
+	float cachedSeparation = 0.0f;
+	if (cache != nullptr && cache->valid && cache->edgeIndex < (cache->edgeIsOnB ? bNormalCount : aNormalCount)) {
+		cachedFace = ReferenceFace{ cache->edgeIndex, cache->edgeIsOnB };
+		cachedSeparation = separation(*cachedFace);
+		cache->hit = true;
+		if (cachedSeparation < -maxDistance) {
+			cache->valid = false;
+			return std::nullopt;
+		}
+		// The separations along the normals of a change by at most the distance the verts of b moved in the space of a and the other way around. The distance a vert at radius r moves when the rotation changes is at most r times the length of the difference of the rotations as complex numbers.
+		const auto rotationChange = (rotation - cache->rotation).length();
+		const auto bMoved = (bToAObjectSpace.pos - cache->bPosInA).length() + rotationChange * bRadius;
+		const auto aMoved = (aPosInB - cache->aPosInB).length() + rotationChange * aRadius;
+		if (cache->margin > 2.0f * std::max(aMoved, bMoved)) {
+			return cachedFace;
 		}
+		cache->hit = false;
 	}
 
-	const auto face0Index = furthestVertOfIndidentInsideReference;
-	const auto face1Index = static_cast<i16>(furthestVertOfIndidentInsideReference - 1 < 0
-		? static_cast<i16>(incident->normals.size()) - 1
-		: furthestVertOfIndidentInsideReference - 1);
-	const auto face0Normal = incident->normals[face0Index] * incidentTransform->rot;
-	const auto face1Normal = incident->normals[face1Index] * incidentTransform->rot;
+	// The 2 least separations along the normals of a shape.
+	struct Least {
+		float separation = std::numeric_limits<float>::infinity();
+		i16 index = 0;
+		float second = std::numeric_limits<float>::infinity();
+	};
+	const auto findLeast = [maxDistance](i16 normalCount, const auto& separation, Least& least) -> bool {
+		for (i16 i = 0; i < normalCount; i++) {
+			const auto s = separation(i);
+			if (s < -maxDistance) {
+				// If there is any axis on which the projections don't overlap the shapes don't overlap.
+				return false;
+			}
+			if (s < least.separation) {
+				least.second = least.separation;
+				least.separation = s;
+				least.index = i;
+			} else if (s < least.second) {
+				least.second = s;
+			}
+		}
+		return true;
+	};
+	Least aLeast, bLeast;
+	if (!findLeast(aNormalCount, aSeparation, aLeast) || !findLeast(bNormalCount, bSeparation, bLeast)) {
+		if (cache != nullptr) {
+			cache->valid = false;
+		}
+		return std::nullopt;
+	}
+	// The least separation along any other normal.
+	const auto leastExcluding = [&](ReferenceFace face) -> float {
+		const auto& own = face.isOnB ? bLeast : aLeast;
+		const auto& other = face.isOnB ? aLeast : bLeast;
+		return std::min(own.index == face.index ? own.second : own.separation, other.separation);
+	};
 
-	i16 incidentFace;
-	// Choose incident face to be the face that is the most parallel to the reference face.
-	if (dot(normal, face0Normal) < dot(normal, face1Normal)) {
-		incidentFace = face0Index;
-	} else {
-		incidentFace = face1Index;
+	ReferenceFace face{ aLeast.index, false };
+	auto faceSeparation = aLeast.separation;
+	if (!(aLeast.separation < bLeast.separation)) {
+		face = ReferenceFace{ bLeast.index, true };
+		faceSeparation = bLeast.separation;
+	}
+	if (cachedFace.has_value() && cachedSeparation <= leastExcluding(*cachedFace) + SAT_CACHE_TOLERANCE) {
+		face = *cachedFace;
+		faceSeparation = cachedSeparation;
 	}
 
+	if (cache != nullptr) {
+		*cache = SatCache{
+			.bPosInA = bToAObjectSpace.pos,
+			.aPosInB = aPosInB,
+			.rotation = rotation,
+			// The face is still kept after the other separations decrease by this amount relative to it.
+			.margin = leastExcluding(face) - faceSeparation + SAT_CACHE_TOLERANCE,
+			.edgeIndex = face.index,
+			.edgeIsOnB = face.isOnB,
+			.valid = true,
+			.hit = false,
+		};
+	}
+	return face;
+}
+
+// A face in world space. The face i has the endpoints i and i + 1.
+struct ManifoldFace {
+	i16 index;
+	i16 endIndex;
+	Vec2 begin;
+	Vec2 end;
+};
+
+// Clips the incident face to the sides of the reference face and keeps the points that are inside the reference shape or closer than speculativeDistance to it. The normal is the world space normal of the reference face. If the reference face is on body B the result is flipped.
+static auto clipIncidentFace(Vec2 normal, const ManifoldFace& reference, const ManifoldFace& incident, float speculativeDistance, bool referenceIsB) -> Collision {
 	struct ClipVert {
 		ContactPointId id;
 		Vec2 pos;
 	};
 
-	const auto incidentFirstVertIndex = incidentFace;
-	const auto incidentSecondVertIndex = static_cast<i16>(incidentFace + 1 >= static_cast<i16>(incident->verts.size()) ? 0 : incidentFace + 1);
 	ClipVert vertsToClip[2]{
 		{
 			.id = {
-				.featureOnA = ContactPointFeature::FACE, .featureOnAIndex = referenceFaceIndex,
-				.featureOnB = ContactPointFeature::VERTEX, .featureOnBIndex = incidentFirstVertIndex
+				.featureOnA = ContactPointFeature::FACE, .featureOnAIndex = reference.index,
+				.featureOnB = ContactPointFeature::VERTEX, .featureOnBIndex = incident.index
 			},
-			.pos = incident->verts[incidentFirstVertIndex] * *incidentTransform
+			.pos = incident.begin
 		},
 		{
 			.id = {
-				.featureOnA = ContactPointFeature::FACE, .featureOnAIndex = referenceFaceIndex,
-				.featureOnB = ContactPointFeature::VERTEX, .featureOnBIndex = incidentSecondVertIndex
+				.featureOnA = ContactPointFeature::FACE, .featureOnAIndex = reference.index,
+				.featureOnB = ContactPointFeature::VERTEX, .featureOnBIndex = incident.endIndex
 			},
-			.pos = incident->verts[incidentSecondVertIndex] * *incidentTransform
+			.pos = incident.end
 		}
 	};
 
@@ -420,7 +525,7 @@ auto collide(const Transform& aTransform, const ConvexPolygon& a, const Transfor
 					vert.id.featureOnA = ContactPointFeature::VERTEX;
 					vert.id.featureOnAIndex = aVertIndex;
 					vert.id.featureOnB = ContactPointFeature::FACE;
-					vert.id.featureOnBIndex = incidentFace;
+					vert.id.featureOnBIndex = incident.index;
 				}
 			}
 			return vert;
@@ -432,78 +537,358 @@ auto collide(const Transform& aTransform, const ConvexPolygon& a, const Transfor
 		verts[1] = clipPoint(verts[1], line, edgeLine, aVertIndex);
 	};
 
-	const auto referenceFaceEndPoint0 = reference->verts[referenceFaceIndex] * *referenceTransform;
-	const auto referenceFaceEndPoint1 = reference->verts[referenceFaceIndex + 1 >= static_cast<i16>(reference->verts.size()) ? 0 : referenceFaceIndex + 1] * *referenceTransform;
-
 	// The normals are flipped to make the positive half space of the line inside the reference face segment.
-	Line lineA{ referenceFaceEndPoint0, referenceFaceEndPoint0 - normal };
-	clipPoints(vertsToClip, lineA, referenceFaceIndex);
-	Line lineB{ referenceFaceEndPoint1, referenceFaceEndPoint1 + normal };
-	clipPoints(vertsToClip, lineB, referenceFaceIndex + 1 >= static_cast<i16>(reference->verts.size()) ? 0 : referenceFaceIndex + 1);
+	Line lineA{ reference.begin, reference.begin - normal };
+	clipPoints(vertsToClip, lineA, reference.index);
+	Line lineB{ reference.end, reference.end + normal };
+	clipPoints(vertsToClip, lineB, reference.endIndex);
 
 	Collision manifold;
 	manifold.normal = normal;
 	manifold.contactCount = 0;
-	std::vector<Vec2> points;
-	Line referenceFaceLine{ referenceFaceEndPoint0, referenceFaceEndPoint1 };
-
-	// Remove all the contacts that lie outside the reference shape. On the negative half space of the reference face.
-	const auto distanceFromReferenceFace0 = signedDistance(referenceFaceLine, vertsToClip[0].pos);
-	if (distanceFromReferenceFace0 >= 0.0f) {
-		manifold.contacts[manifold.contactCount] = ContactPoint{
-			.pos = vertsToClip[0].pos,
-			.separation = distanceFromReferenceFace0,
-			.id = vertsToClip[0].id,
-		};
-		manifold.contactCount++;
-	}
-	const auto distanceFromReferenceFace1 = signedDistance(referenceFaceLine, vertsToClip[1].pos);
-	if (distanceFromReferenceFace1 >= 0.0f) {
-		manifold.contacts[manifold.contactCount] = ContactPoint{
-			.pos = vertsToClip[1].pos,
-			.separation = distanceFromReferenceFace1,
-			.id = vertsToClip[1].id,
-		};
-		manifold.contactCount++;
+	Line referenceFaceLine{ reference.begin, reference.end };
+
+	// Remove all the contacts that lie outside the reference shape. On the negative half space of the reference face. The points closer to it than speculativeDistance are kept as speculative contacts.
+	for (const auto& vert : vertsToClip) {
+		const auto distanceFromReferenceFace = signedDistance(referenceFaceLine, vert.pos);
+		if (distanceFromReferenceFace >= -speculativeDistance) {
+			manifold.contacts[manifold.contactCount] = ContactPoint{
+				.pos = vert.pos,
+				.separation = -distanceFromReferenceFace,
+				.id = vert.id,
+			};
+			manifold.contactCount++;
+		}
 	}
 
 	// All the previous code assuemes that a is the reference shape. If that is not true the features have to be swapped.
-	if (const auto swap = reference == &b) {
-		manifold.normal = -manifold.normal;
-		for (i32 i = 0; i < manifold.contactCount; i++) {
-			auto& point = manifold.contacts[i];
+	if (referenceIsB) {
+		flip(manifold);
+	}
+	return manifold;
+}
 
-			point.pos = point.pos - manifold.normal * point.separation;
-			//point.separation = -point.separation;
-			std::swap(point.id.featureOnA, point.id.featureOnB);
-			std::swap(point.id.featureOnAIndex, point.id.featureOnBIndex);
+// The computed contact manifold tries to approximate the contact points at which the collision started. These points are only an approximation.
+// This code often uses face indices as vertex indices, this is explained in ConvexPolygon.
+static auto collidePolygons(const Transform& aTransform, PolygonView a, const Transform& bTransform, PolygonView b, float speculativeDistance, SatCache* cache) -> std::optional<Collision> {
+	const auto bToAObjectSpace = bTransform * aTransform.inversed();
+	const auto aToBObjectSpace = aTransform * bTransform.inversed();
+	const auto useCache = cache != nullptr && cache->valid;
+	const auto referenceFace = chooseReferenceFace(
+		static_cast<i16>(a.normals.size()), [&](i16 i) { return polygonSeparation(a, i, b, bToAObjectSpace); },
+		static_cast<i16>(b.normals.size()), [&](i16 i) { return polygonSeparation(b, i, a, aToBObjectSpace); },
+		bToAObjectSpace,
+		useCache ? maxVertLength(a.verts) : 0.0f,
+		useCache ? maxVertLength(b.verts) : 0.0f,
+		speculativeDistance,
+		cache
+	);
+	if (!referenceFace.has_value())
+		return std::nullopt;
+
+	const auto referenceIsB = referenceFace->isOnB;
+	const auto& reference = referenceIsB ? b : a;
+	const auto& referenceTransform = referenceIsB ? bTransform : aTransform;
+	const auto& incident = referenceIsB ? a : b;
+	const auto& incidentTransform = referenceIsB ? aTransform : bTransform;
+	const auto referenceFaceIndex = referenceFace->index;
+
+	const auto normal = reference.normals[referenceFaceIndex] * referenceTransform.rot;
+	i16 furthestVertOfIndidentInsideReference = 0;
+	auto maxDistance = std::numeric_limits<float>::infinity();
+	for (i16 i = 0; i < incident.verts.size(); i++) {
+		const auto d = dot(normal, incident.verts[i] * incidentTransform);
+		// Using less than because the normal points towards the shape so the get the furthest point inside you need to find the smallest value of the projection.
+		if (d < maxDistance) {
+			maxDistance = d;
+			furthestVertOfIndidentInsideReference = i;
 		}
 	}
 
-	/*for (i32 i = 0; i < manifold.contactCount; i++) {
-		auto& point = manifold.contacts[i];
-		point.separation = -std::abs(point.separation);
-	}*/
+	const auto face0Index = furthestVertOfIndidentInsideReference;
+	const auto face1Index = static_cast<i16>(furthestVertOfIndidentInsideReference - 1 < 0
+		? static_cast<i16>(incident.normals.size()) - 1
+		: furthestVertOfIndidentInsideReference - 1);
+	const auto face0Normal = incident.normals[face0Index] * incidentTransform.rot;
+	const auto face1Normal = incident.normals[face1Index] * incidentTransform.rot;
 
-	return manifold;
+	i16 incidentFace;
+	// Choose incident face to be the face that is the most parallel to the reference face.
+	if (dot(normal, face0Normal) < dot(normal, face1Normal)) {
+		incidentFace = face0Index;
+	} else {
+		incidentFace = face1Index;
+	}
+
+	const auto incidentFaceEndIndex = static_cast<i16>(incidentFace + 1 >= static_cast<i16>(incident.verts.size()) ? 0 : incidentFace + 1);
+	const auto referenceFaceEndIndex = static_cast<i16>(referenceFaceIndex + 1 >= static_cast<i16>(reference.verts.size()) ? 0 : referenceFaceIndex + 1);
+	return clipIncidentFace(
+		normal,
+		ManifoldFace{
+			referenceFaceIndex,
+			referenceFaceEndIndex,
+			reference.verts[referenceFaceIndex] * referenceTransform,
+			reference.verts[referenceFaceEndIndex] * referenceTransform
+		},
+		ManifoldFace{
+			incidentFace,
+			incidentFaceEndIndex,
+			incident.verts[incidentFace] * incidentTransform,
+			incident.verts[incidentFaceEndIndex] * incidentTransform
+		},
+		speculativeDistance,
+		referenceIsB
+	);
+}
+
+auto collide(const Transform& aTransform, const ConvexPolygon& a, const Transform& bTransform, const ConvexPolygon& b, float speculativeDistance, SatCache* cache) -> std::optional<Collision> {
+	return collidePolygons(aTransform, polygonView(a), bTransform, polygonView(b), speculativeDistance, cache);
+}
+
+auto collide(const Transform& aTransform, const BoxCollider& box, const Transform& bTransform, const ConvexPolygon& polygon, float speculativeDistance, SatCache* cache) -> std::optional<Collision> {
+	Vec2 verts[4];
+	boxVerts(box.size / 2.0f, verts);
+	return collidePolygons(aTransform, PolygonView{ verts, BOX_NORMALS }, bTransform, polygonView(polygon), speculativeDistance, cache);
+}
+
+auto collide(const Transform& aTransform, const ConvexPolygon& polygon, const Transform& bTransform, const BoxCollider& box, float speculativeDistance, SatCache* cache) -> std::optional<Collision> {
+	Vec2 verts[4];
+	boxVerts(box.size / 2.0f, verts);
+	return collidePolygons(aTransform, polygonView(polygon), bTransform, PolygonView{ verts, BOX_NORMALS }, speculativeDistance, cache);
+}
+
+// The same as collidePolygons, but the separations are computed from the box axes and the incident face is the face of the incident box most opposite to the reference normal, because for a box it can be read off the signs of the normal.
+auto collide(const Transform& aTransform, const BoxCollider& aBox, const Transform& bTransform, const BoxCollider& bBox, float speculativeDistance, SatCache* cache) -> std::optional<Collision> {
+	const auto aHalfSize = aBox.size / 2.0f;
+	const auto bHalfSize = bBox.size / 2.0f;
+	const auto bToAObjectSpace = bTransform * aTransform.inversed();
+	const auto aSeparations = boxSeparations(aHalfSize, bHalfSize, bToAObjectSpace);
+	const auto bSeparations = boxSeparations(bHalfSize, aHalfSize, aTransform * bTransform.inversed());
+	const auto referenceFace = chooseReferenceFace(
+		4, [&](i16 i) { return aSeparations[i]; },
+		4, [&](i16 i) { return bSeparations[i]; },
+		bToAObjectSpace,
+		aHalfSize.length(),
+		bHalfSize.length(),
+		speculativeDistance,
+		cache
+	);
+	if (!referenceFace.has_value())
+		return std::nullopt;
+
+	const auto referenceIsB = referenceFace->isOnB;
+	const auto referenceHalfSize = referenceIsB ? bHalfSize : aHalfSize;
+	const auto& referenceTransform = referenceIsB ? bTransform : aTransform;
+	const auto incidentHalfSize = referenceIsB ? aHalfSize : bHalfSize;
+	const auto& incidentTransform = referenceIsB ? aTransform : bTransform;
+	const auto referenceFaceIndex = referenceFace->index;
+
+	const auto normal = BOX_NORMALS[referenceFaceIndex] * referenceTransform.rot;
+	const auto normalInIncidentSpace = normal * incidentTransform.rot.inversed();
+	i16 incidentFace;
+	if (std::abs(normalInIncidentSpace.x) > std::abs(normalInIncidentSpace.y)) {
+		incidentFace = normalInIncidentSpace.x > 0.0f ? 0 : 2;
+	} else {
+		incidentFace = normalInIncidentSpace.y > 0.0f ? 1 : 3;
+	}
+
+	const auto incidentFaceEndIndex = static_cast<i16>((incidentFace + 1) % 4);
+	const auto referenceFaceEndIndex = static_cast<i16>((referenceFaceIndex + 1) % 4);
+	return clipIncidentFace(
+		normal,
+		ManifoldFace{
+			referenceFaceIndex,
+			referenceFaceEndIndex,
+			boxVert(referenceHalfSize, referenceFaceIndex) * referenceTransform,
+			boxVert(referenceHalfSize, referenceFaceEndIndex) * referenceTransform
+		},
+		ManifoldFace{
+			incidentFace,
+			incidentFaceEndIndex,
+			boxVert(incidentHalfSize, incidentFace) * incidentTransform,
+			boxVert(incidentHalfSize, incidentFaceEndIndex) * incidentTransform
+		},
+		speculativeDistance,
+		referenceIsB
+	);
 }
 
-auto collide(const Transform& aTransform, const BoxCollider& aBox, const Transform& bTransform, const BoxCollider& bBox) -> std::optional<Collision> {
-	static ConvexPolygon aShape{ .verts = std::vector<Vec2>(4, Vec2{ 0.0f }), .normals = std::vector<Vec2>(4, Vec2{ 0.0f }) };
-	aShape.verts[3] = aBox.size / 2.0f;
-	aShape.verts[2] = Vec2{ aBox.size.x, -aBox.size.y } / 2.0f;
-	aShape.verts[1] = -aBox.size / 2.0f;
-	aShape.verts[0] = Vec2{ -aBox.size.x, aBox.size.y } / 2.0f;
-	static ConvexPolygon bShape{ .verts = std::vector<Vec2>(4, Vec2{ 0.0f }), .normals = std::vector<Vec2>(4, Vec2{ 0.0f }) };
-	bShape.verts[3] = bBox.size / 2.0f;
-	bShape.verts[2] = Vec2{ bBox.size.x, -bBox.size.y } / 2.0f;
-	bShape.verts[1] = -bBox.size / 2.0f;
-	bShape.verts[0] = Vec2{ -bBox.size.x, bBox.size.y } / 2.0f;
+// The core of a collider for GJK and the normals of its faces. A circle has no faces.
+struct GjkPolygon {
+	GjkShape shape;
+	Span<const Vec2> normals;
+};
 
-	aShape.calculateNormals();
-	bShape.calculateNormals();
+static constexpr Vec2 CIRCLE_CORE[1]{ Vec2{ 0.0f, 0.0f } };
+
+// The verts of a box are computed into boxVertsStorage, so it has to outlive the result.
+static auto gjkPolygon(const Collider& collider, Vec2 (&boxVertsStorage)[4]) -> GjkPolygon {
+	return std::visit(overloaded{
+		[&](const BoxCollider& box) {
+			boxVerts(box.size / 2.0f, boxVertsStorage);
+			return GjkPolygon{ GjkShape{ boxVertsStorage, 0.0f }, BOX_NORMALS };
+		},
+		[](const CircleCollider& circle) {
+			return GjkPolygon{ GjkShape{ CIRCLE_CORE, circle.radius }, Span<const Vec2>{ nullptr, 0 } };
+		},
+		[](const ConvexPolygon& polygon) {
+			const auto view = polygonView(polygon);
+			return GjkPolygon{ GjkShape{ view.verts, 0.0f }, view.normals };
+		},
+		[](const CompoundCollider&) {
+			ASSERT_NOT_REACHED();
+			return GjkPolygon{ GjkShape{ CIRCLE_CORE, 0.0f }, Span<const Vec2>{ nullptr, 0 } };
+		},
+	}, collider);
+}
 
-	return collide(aTransform, aShape, bTransform, bShape);
+// The face whose normal is the closest to dir. It is one of the 2 faces next to the support point along dir, so the faces of big polygons don't all have to be checked.
+static auto mostParallelFace(const GjkPolygon& polygon, Vec2 dir, i16 startIndex) -> i16 {
+	const auto vert = polygon.shape.support(dir, startIndex);
+	const auto previous = static_cast<i16>(vert == 0 ? static_cast<i16>(polygon.normals.size()) - 1 : vert - 1);
+	return dot(polygon.normals[vert], dir) >= dot(polygon.normals[previous], dir) ? vert : previous;
+}
+
+auto collideGjk(const Transform& aTransform, const Collider& aCollider, const Transform& bTransform, const Collider& bCollider, float speculativeDistance, GjkCache* cache) -> std::optional<Collision> {
+	Vec2 aBoxVerts[4], bBoxVerts[4];
+	const auto a = gjkPolygon(aCollider, aBoxVerts);
+	const auto b = gjkPolygon(bCollider, bBoxVerts);
+	const auto bToAObjectSpace = bTransform * aTransform.inversed();
+
+	// EPA starts from the simplex so it is needed even without a cache.
+	auto simplex = cache == nullptr ? GjkCache{} : *cache;
+	const auto distance = gjkDistance(a.shape, b.shape, bToAObjectSpace, &simplex);
+	if (cache != nullptr) {
+		*cache = simplex;
+	}
+
+	// In the space of a. pointB - pointA = normal * separation.
+	Vec2 normal, pointA, pointB;
+	float separation;
+	if (distance.distance > GJK_OVERLAP_DISTANCE) {
+		normal = distance.normal;
+		separation = distance.distance;
+		pointA = distance.pointA;
+		pointB = distance.pointB;
+	} else {
+		const auto penetration = epaPenetration(a.shape, b.shape, bToAObjectSpace, simplex);
+		normal = penetration.normal;
+		separation = -penetration.depth;
+		pointA = penetration.pointA;
+		pointB = penetration.pointB;
+	}
+	separation -= a.shape.radius + b.shape.radius;
+	if (separation > speculativeDistance)
+		return std::nullopt;
+
+	// A circle touches anything in a single point.
+	if (a.normals.size() == 0 || b.normals.size() == 0) {
+		Collision collision;
+		collision.contactCount = 1;
+		collision.normal = normal * aTransform.rot;
+		auto& p = collision.contacts[0];
+		p.separation = separation;
+		p.pos = (pointB - normal * b.shape.radius) * aTransform;
+		p.id = ContactPointId{ .featureOnA = ContactPointFeature::FACE, .featureOnAIndex = 0, .featureOnB = ContactPointFeature::FACE, .featureOnBIndex = 0 };
+		return collision;
+	}
+
+	// Like in the SAT kernels the reference face is the face most parallel to the normal. The face of a is kept unless the face of b is clearly better, so it doesn't switch between parallel faces because of rounding.
+	static constexpr float REFERENCE_FACE_TOLERANCE = 0.001f;
+	const auto normalInB = normal * bToAObjectSpace.rot.inversed();
+	const auto aFace = mostParallelFace(a, normal, simplex.indexA[0]);
+	const auto bFace = mostParallelFace(b, -normalInB, simplex.indexB[0]);
+	const auto referenceIsB = dot(b.normals[bFace], -normalInB) > dot(a.normals[aFace], normal) + REFERENCE_FACE_TOLERANCE;
+
+	const auto& reference = referenceIsB ? b : a;
+	const auto& referenceTransform = referenceIsB ? bTransform : aTransform;
+	const auto& incident = referenceIsB ? a : b;
+	const auto& incidentTransform = referenceIsB ? aTransform : bTransform;
+	const auto referenceFace = referenceIsB ? bFace : aFace;
+	const auto referenceNormal = reference.normals[referenceFace] * referenceTransform.rot;
+	const auto incidentFace = mostParallelFace(incident, -(referenceNormal * incidentTransform.rot.inversed()), referenceIsB ? simplex.indexA[0] : simplex.indexB[0]);
+
+	const auto faceEnd = [](const GjkPolygon& polygon, i16 face) {
+		return static_cast<i16>(face + 1 >= static_cast<i16>(polygon.shape.verts.size()) ? 0 : face + 1);
+	};
+	const auto referenceFaceEnd = faceEnd(reference, referenceFace);
+	const auto incidentFaceEnd = faceEnd(incident, incidentFace);
+	return clipIncidentFace(
+		referenceNormal,
+		ManifoldFace{
+			referenceFace,
+			referenceFaceEnd,
+			reference.shape.verts[referenceFace] * referenceTransform,
+			reference.shape.verts[referenceFaceEnd] * referenceTransform
+		},
+		ManifoldFace{
+			incidentFace,
+			incidentFaceEnd,
+			incident.shape.verts[incidentFace] * incidentTransform,
+			incident.shape.verts[incidentFaceEnd] * incidentTransform
+		},
+		speculativeDistance,
+		referenceIsB
+	);
+}
+
+// Like the box circle collision, but the center is tested against the faces, because a polygon has no axes to clamp to.
+auto collide(const Transform& aTransform, const ConvexPolygon& polygon, const Transform& bTransform, const CircleCollider& circle, float speculativeDistance) -> std::optional<Collision> {
+	const auto center = bTransform.pos * aTransform.inversed();
+	const auto maxDistance = circle.radius + speculativeDistance;
+
+	// The face the center is the furthest in front of. If the center is inside it is the closest face.
+	auto maxSeparation = -std::numeric_limits<float>::infinity();
+	i16 face = 0;
+	for (i16 i = 0; i < polygon.normals.size(); i++) {
+		const auto separation = dot(polygon.normals[i], center - polygon.verts[i]);
+		if (separation > maxDistance) {
+			return std::nullopt;
+		}
+		if (separation > maxSeparation) {
+			maxSeparation = separation;
+			face = i;
+		}
+	}
+
+	const auto faceEnd = static_cast<i16>(face + 1 >= static_cast<i16>(polygon.verts.size()) ? 0 : face + 1);
+	const auto v0 = polygon.verts[face];
+	const auto v1 = polygon.verts[faceEnd];
+	auto normal = polygon.normals[face];
+	auto separation = maxSeparation - circle.radius;
+	ContactPointId id{ .featureOnA = ContactPointFeature::FACE, .featureOnAIndex = face, .featureOnB = ContactPointFeature::FACE, .featureOnBIndex = 0 };
+	// If the center is outside, but not in front of the face, the closest point is one of the endpoints.
+	if (maxSeparation > 0.0f) {
+		std::optional<i16> closestVert;
+		if (dot(center - v0, v1 - v0) < 0.0f) {
+			closestVert = face;
+		} else if (dot(center - v1, v0 - v1) < 0.0f) {
+			closestVert = faceEnd;
+		}
+		if (closestVert.has_value()) {
+			const auto toCenter = center - polygon.verts[*closestVert];
+			const auto distanceSquared = toCenter.lengthSq();
+			if (distanceSquared > pow(maxDistance, 2.0f)) {
+				return std::nullopt;
+			}
+			// Not zero, because the center is in front of the face.
+			const auto distance = sqrt(distanceSquared);
+			normal = toCenter / distance;
+			separation = distance - circle.radius;
+			id.featureOnA = ContactPointFeature::VERTEX;
+			id.featureOnAIndex = *closestVert;
+		}
+	}
+
+	Collision collision;
+	collision.contactCount = 1;
+	collision.normal = normal * aTransform.rot;
+	auto& p = collision.contacts[0];
+	p.separation = separation;
+	// The deepest point of the circle.
+	p.pos = bTransform.pos - collision.normal * circle.radius;
+	p.id = id;
+	return collision;
 }
 
 // Another way to do this that would work is to do the same thing if the center is inside the box else calculate the seperation vector by calculating the distance from the sides of the box to the center. The length would then be circle.radius - v.length().
@@ -512,7 +897,7 @@ auto collide(const Transform& aTransform, const BoxCollider& aBox, const Transfo
 //	std::max(0.0f, abs(alongX) - boxHalfSize.x) * -sign(alongX),
 //	std::max(0.0f, abs(alongY) - boxHalfSize.y) * -sign(alongY)
 //};
-auto collide(const Transform& aTransform, const BoxCollider& box, const Transform& bTransform, const CircleCollider& circle) -> std::optional<Collision> {
+auto collide(const Transform& aTransform, const BoxCollider& box, const Transform& bTransform, const CircleCollider& circle, float speculativeDistance) -> std::optional<Collision> {
 	auto boxOrientation = aTransform.angle();
 	auto boxPos = aTransform.pos;
 	auto circlePos = bTransform.pos;
@@ -555,7 +940,7 @@ auto collide(const Transform& aTransform, const BoxCollider& box, const Transfor
 			std::clamp(circlePosInBoxSpace.y, -boxHalfSize.y, boxHalfSize.y)
 		};
 
-		if ((closestPosOnBox - circlePosInBoxSpace).lengthSq() > pow(circle.radius, 2.0f)) {
+		if ((closestPosOnBox - circlePosInBoxSpace).lengthSq() > pow(circle.radius + speculativeDistance, 2.0f)) {
 			return std::nullopt;
 		}
 	}
@@ -570,18 +955,19 @@ auto collide(const Transform& aTransform, const BoxCollider& box, const Transfor
 	p.separation = collision.normal.length() - circle.radius;
 	if (isCenterInsideBox) p.separation = -(collision.normal.length() + circle.radius);
 	collision.normal = collision.normal.normalized();
-	p.pos = closestPosOnBox;
+	// The deepest point of the circle.
+	p.pos = circlePos - collision.normal * circle.radius;
 	p.id = ContactPointId{ .featureOnA = ContactPointFeature::FACE, .featureOnAIndex = 0, .featureOnB = ContactPointFeature::FACE, .featureOnBIndex = 0 };
 
 	return collision;
 }
 
-auto collide(const Transform& aTransform, const CircleCollider& a, const Transform& bTransform, const CircleCollider& b) -> std::optional<Collision> {
+auto collide(const Transform& aTransform, const CircleCollider& a, const Transform& bTransform, const CircleCollider& b, float speculativeDistance) -> std::optional<Collision> {
 	const auto aPos = aTransform.pos;
 	const auto bPos = bTransform.pos;
 	const auto normal = bPos - aPos;
 	const auto distanceSquared = normal.lengthSq();
-	if (distanceSquared > pow(a.radius + b.radius, 2.0f)) {
+	if (distanceSquared > pow(a.radius + b.radius + speculativeDistance, 2.0f)) {
 		return std::nullopt;
 	}
 
@@ -592,7 +978,7 @@ auto collide(const Transform& aTransform, const CircleCollider& a, const Transfo
 	collision.normal = normal / distance;
 	p.separation = -(a.radius + b.radius - distance);
 	collision.normal = (distanceSquared == 0.0f) ? Vec2{ 1.0f, 0.0f } : collision.normal.normalized();
-	p.pos = aPos + collision.normal * a.radius;
+	p.pos = bPos - collision.normal * b.radius;
 	p.id = ContactPointId{ .featureOnA = ContactPointFeature::FACE, .featureOnAIndex = 0, .featureOnB = ContactPointFeature::FACE, .featureOnBIndex = 0 };
 	return collision;
 }
@@ -617,6 +1003,16 @@ auto contains(Vec2 point, Vec2 pos, float, const CircleCollider& circle) -> bool
 	return (point - pos).lengthSq() <= pow(circle.radius, 2.0f);
 }
 
+auto contains(Vec2 point, Vec2 pos, float orientation, const CompoundCollider& compound) -> bool {
+	const Transform transform{ pos, orientation };
+	for (const auto& child : compound.children) {
+		const auto childTransform = child.transform * transform;
+		if (contains(point, childTransform.pos, childTransform.angle(), child.collider))
+			return true;
+	}
+	return false;
+}
+
 auto contains(Vec2 point, Vec2 pos, float orientation, const ConvexPolygon& convexPolygon) -> bool {
 	const Transform transform{ pos, orientation };
 	for (i32 i = 0; i < convexPolygon.verts.size(); i++) {
@@ -716,10 +1112,341 @@ auto raycast(Vec2 rayBegin, Vec2 rayEnd, const CircleCollider& collider, const T
 	};
 }
 
-auto raycast(Vec2, Vec2, const ConvexPolygon&, const Transform&) -> std::optional<RaycastResult> {
+// Every collider is a convex polygon inflated by a radius. A circle is a single vertex. The vertices are in world space and counterclockwise.
+struct RoundedPolygon {
+	std::vector<Vec2> verts;
+	float radius;
+};
+
+static auto makeCounterclockwise(std::vector<Vec2>& verts) -> void {
+	// Twice the signed area. The shoelace formula.
+	auto area = 0.0f;
+	for (usize i = 0; i < verts.size(); i++) {
+		area += det(verts[i], verts[(i + 1) % verts.size()]);
+	}
+	if (area < 0.0f) {
+		std::reverse(verts.begin(), verts.end());
+	}
+}
+
+static auto roundedPolygon(const Collider& collider, const Transform& transform, RoundedPolygon& result) -> void {
+	result.verts.clear();
+	result.radius = 0.0f;
+	std::visit(overloaded{
+		[&](const BoxCollider& box) {
+			const auto corners = box.getCorners(transform);
+			result.verts.insert(result.verts.end(), corners.begin(), corners.end());
+		},
+		[&](const CircleCollider& circle) {
+			result.verts.push_back(transform.pos);
+			result.radius = circle.radius;
+		},
+		[&](const ConvexPolygon& polygon) {
+			for (const auto& vert : polygon.verts) {
+				result.verts.push_back(vert * transform);
+			}
+		},
+		// The children are handled separately by the callers.
+		[&](const CompoundCollider&) {
+			ASSERT_NOT_REACHED();
+			result.verts.push_back(transform.pos);
+		},
+	}, collider);
+	makeCounterclockwise(result.verts);
+}
+
+// Andrew's monotone chain. Sorts the points and returns the hull counterclockwise.
+static auto convexHull(std::vector<Vec2>& points, std::vector<Vec2>& hull) -> void {
+	std::sort(points.begin(), points.end(), [](Vec2 a, Vec2 b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+	hull.clear();
+	if (points.size() < 3) {
+		hull = points;
+		return;
+	}
+	// The lower hull and then the upper hull. A point is removed when it doesn't make a left turn.
+	for (i32 pass = 0; pass < 2; pass++) {
+		const auto chainStart = hull.size();
+		for (usize i = 0; i < points.size(); i++) {
+			const auto& p = pass == 0 ? points[i] : points[points.size() - 1 - i];
+			while (hull.size() >= chainStart + 2 && det(hull[hull.size() - 1] - hull[hull.size() - 2], p - hull[hull.size() - 2]) <= 0.0f) {
+				hull.pop_back();
+			}
+			hull.push_back(p);
+		}
+		// The last point is the first point of the other chain.
+		hull.pop_back();
+	}
+}
+
+static auto raycastCircle(Vec2 start, Vec2 dir, Vec2 center, float radius) -> std::optional<RaycastResult> {
+	const auto toStart = start - center;
+	const auto
+		a = dot(dir, dir),
+		b = dot(toStart, dir) * 2.0f,
+		c = dot(toStart, toStart) - radius * radius;
+	const auto discriminant = b * b - 4.0f * a * c;
+	if (discriminant < 0.0f || a == 0.0f)
+		return std::nullopt;
+	const auto t = (-b - std::sqrt(discriminant)) / a / 2.0f;
+	if (t > 1.0f || t < 0.0f)
+		return std::nullopt;
+	return RaycastResult{ .t = t, .normal = (start + dir * t - center).normalized() };
+}
+
+// The polygon inflated by the radius is the polygon with the edges moved outwards by the radius and circles at the vertices. Only the edges the ray enters through are tested, so a ray starting inside doesn't hit anything.
+static auto raycastRoundedPolygon(Vec2 start, Vec2 dir, const RoundedPolygon& polygon) -> std::optional<RaycastResult> {
+	const auto& verts = polygon.verts;
+	std::optional<RaycastResult> closest;
+	auto addHit = [&closest](const std::optional<RaycastResult>& hit) {
+		if (hit.has_value() && (!closest.has_value() || hit->t < closest->t)) {
+			closest = hit;
+		}
+	};
+	if (polygon.radius > 0.0f) {
+		for (const auto& vert : verts) {
+			addHit(raycastCircle(start, dir, vert, polygon.radius));
+		}
+	}
+	if (verts.size() < 2)
+		return closest;
+
+	for (usize i = 0; i < verts.size(); i++) {
+		const auto edge = verts[(i + 1) % verts.size()] - verts[i];
+		const auto normal = edge.rotBy90deg().normalized();
+		const auto dirAlongNormal = dot(dir, normal);
+		if (dirAlongNormal >= 0.0f)
+			continue;
+		const auto edgeStart = verts[i] + normal * polygon.radius;
+		const auto t = dot(edgeStart - start, normal) / dirAlongNormal;
+		if (t < 0.0f || t > 1.0f)
+			continue;
+		const auto alongEdge = dot(start + dir * t - edgeStart, edge);
+		if (alongEdge < 0.0f || alongEdge > dot(edge, edge))
+			continue;
+		addHit(RaycastResult{ .t = t, .normal = normal });
+	}
+	return closest;
+}
+
+auto raycast(Vec2 rayBegin, Vec2 rayEnd, const ConvexPolygon& collider, const Transform& transform) -> std::optional<RaycastResult> {
+	// thread_local, because the queries can run on multiple threads.
+	thread_local RoundedPolygon polygon;
+	roundedPolygon(collider, transform, polygon);
+	return raycastRoundedPolygon(rayBegin, rayEnd - rayBegin, polygon);
+}
+
+auto raycast(Vec2 rayBegin, Vec2 rayEnd, const CompoundCollider& collider, const Transform& transform) -> std::optional<RaycastResult> {
+	// The closest hit is on the boundary of the whole shape, so the faces between the children are never hit from outside.
+	std::optional<RaycastResult> closest;
+	for (const auto& child : collider.children) {
+		if (const auto hit = raycast(rayBegin, rayEnd, child.collider, child.transform * transform); hit.has_value() && (!closest.has_value() || hit->t < closest->t)) {
+			closest = hit;
+		}
+	}
+	return closest;
+}
+
+static auto minkowskiDifference(const Collider& a, const Transform& aTransform, const Collider& b, const Transform& bTransform, RoundedPolygon& difference) -> void {
+	thread_local RoundedPolygon aPolygon, bPolygon;
+	thread_local std::vector<Vec2> points;
+	roundedPolygon(a, aTransform, aPolygon);
+	roundedPolygon(b, bTransform, bPolygon);
+	points.clear();
+	for (const auto& bVert : bPolygon.verts) {
+		for (const auto& aVert : aPolygon.verts) {
+			points.push_back(bVert - aVert);
+		}
+	}
+	convexHull(points, difference.verts);
+	difference.radius = aPolygon.radius + bPolygon.radius;
+}
+
+auto shapeCast(const Collider& shape, const Transform& shapeTransform, Vec2 translation, const Collider& collider, const Transform& transform) -> std::optional<RaycastResult> {
+	// The compounds are cast child by child. Like in raycast the first hit is on the boundary of the whole shape.
+	if (std::holds_alternative<CompoundCollider>(shape) || std::holds_alternative<CompoundCollider>(collider)) {
+		std::optional<RaycastResult> closest;
+		for (i32 i = 0; i < shapeCount(shape); i++) {
+			const auto a = colliderShape(shape, shapeTransform, i);
+			for (i32 j = 0; j < shapeCount(collider); j++) {
+				const auto b = colliderShape(collider, transform, j);
+				if (const auto hit = shapeCast(a.collider, a.transform, translation, b.collider, b.transform); hit.has_value() && (!closest.has_value() || hit->t < closest->t)) {
+					closest = hit;
+				}
+			}
+		}
+		return closest;
+	}
+	thread_local RoundedPolygon difference;
+	// The shape at t overlaps the collider if some point p of the shape has p + translation * t inside the collider, which means that translation * t is inside the collider minus the shape. The vertices of the difference are on the hull of the differences of the vertices.
+	minkowskiDifference(shape, shapeTransform, collider, transform, difference);
+	return raycastRoundedPolygon(Vec2{ 0.0f }, translation, difference);
+}
+
+auto colliderDistance(const Collider& a, const Transform& aTransform, const Collider& b, const Transform& bTransform) -> ColliderDistance {
+	if (std::holds_alternative<CompoundCollider>(a) || std::holds_alternative<CompoundCollider>(b)) {
+		std::optional<ColliderDistance> closest;
+		for (i32 i = 0; i < shapeCount(a); i++) {
+			const auto aShape = colliderShape(a, aTransform, i);
+			for (i32 j = 0; j < shapeCount(b); j++) {
+				const auto bShape = colliderShape(b, bTransform, j);
+				const auto distance = colliderDistance(aShape.collider, aShape.transform, bShape.collider, bShape.transform);
+				if (!closest.has_value() || distance.distance < closest->distance) {
+					closest = distance;
+				}
+			}
+		}
+		return *closest;
+	}
+	thread_local RoundedPolygon difference;
+	// The closest points of a and b are the point of the difference closest to the origin.
+	minkowskiDifference(a, aTransform, b, bTransform, difference);
+	const auto& verts = difference.verts;
+	auto closest = verts[0];
+	if (verts.size() >= 3) {
+		auto inside = true;
+		for (usize i = 0; i < verts.size(); i++) {
+			if (det(verts[(i + 1) % verts.size()] - verts[i], -verts[i]) < 0.0f) {
+				inside = false;
+				break;
+			}
+		}
+		if (inside)
+			return ColliderDistance{ 0.0f, Vec2{ 0.0f } };
+	}
+	for (usize i = 0; i < verts.size(); i++) {
+		const auto edgeStart = verts[i];
+		const auto edge = verts[(i + 1) % verts.size()] - edgeStart;
+		const auto edgeLengthSq = dot(edge, edge);
+		if (edgeLengthSq == 0.0f)
+			continue;
+		const auto along = std::clamp(dot(-edgeStart, edge) / edgeLengthSq, 0.0f, 1.0f);
+		const auto point = edgeStart + edge * along;
+		if (dot(point, point) < dot(closest, closest)) {
+			closest = point;
+		}
+	}
+	const auto length = closest.length();
+	if (length <= difference.radius)
+		return ColliderDistance{ 0.0f, Vec2{ 0.0f } };
+	return ColliderDistance{ length - difference.radius, closest / length };
+}
+
+auto BodySweep::at(float t) const -> Transform {
+	return Transform{ start.pos + translation * t, start.rot * Rotation{ rotation * t } };
+}
+
+// The point of the polygon furthest along dir.
+static auto support(const RoundedPolygon& polygon, Vec2 dir) -> Vec2 {
+	auto result = polygon.verts[0];
+	for (const auto& vert : polygon.verts) {
+		if (dot(vert, dir) > dot(result, dir)) {
+			result = vert;
+		}
+	}
+	return result + dir * polygon.radius;
+}
+
+// The shape of a closest to b.
+static auto closestShape(const Collider& a, const Transform& aTransform, const Collider& b, const Transform& bTransform) -> ColliderShape {
+	auto closest = 0;
+	auto closestDistance = std::numeric_limits<float>::infinity();
+	for (i32 i = 0; i < shapeCount(a); i++) {
+		const auto shape = colliderShape(a, aTransform, i);
+		if (const auto distance = colliderDistance(shape.collider, shape.transform, b, bTransform).distance; distance < closestDistance) {
+			closest = i;
+			closestDistance = distance;
+		}
+	}
+	return colliderShape(a, aTransform, closest);
+}
+
+auto timeOfImpact(const Collider& a, const BodySweep& aSweep, const Collider& b, const BodySweep& bSweep, float targetDistance) -> std::optional<TimeOfImpact> {
+	// Conservative advancement. The gap between the shapes along the current normal is never bigger than their distance and it can't shrink faster than the relative velocity along the normal plus the speeds of the points furthest from the centers of rotation. Advancing by the distance divided by this bound never makes the shapes overlap.
+	const auto relativeTranslation = aSweep.translation - bSweep.translation;
+	const auto rotationSpeedBound = std::abs(aSweep.rotation) * rotationRadius(a) + std::abs(bSweep.rotation) * rotationRadius(b);
+	auto t = 0.0f;
+	for (i32 i = 0; i < TIME_OF_IMPACT_MAX_ITERATIONS; i++) {
+		const auto aTransform = aSweep.at(t);
+		const auto distance = colliderDistance(a, aTransform, b, bSweep.at(t));
+		// Only possible at the start or because of rounding, when the distance is already tiny. Below TIME_OF_IMPACT_MIN_DISTANCE the normal is mostly rounding error, so it can point away from the other shape and make the bodies pass through each other. This happens with the bodies stopped by speculative contacts, which end up touching.
+		if (distance.distance < TIME_OF_IMPACT_MIN_DISTANCE)
+			return TimeOfImpact{ t, Vec2{ 0.0f }, aTransform.pos };
+		if (i == 0) {
+			// A body that already is closer than the target, for example after the last substep stopped it, would be stopped at the start again in every substep. Halving the distance instead still always makes progress.
+			targetDistance = std::min(targetDistance, distance.distance / 2.0f);
+		}
+		const auto hit = [&](float t) {
+			thread_local RoundedPolygon aPolygon;
+			const auto aShape = closestShape(a, aTransform, b, bSweep.at(t));
+			roundedPolygon(aShape.collider, aShape.transform, aPolygon);
+			return TimeOfImpact{ t, distance.normal, support(aPolygon, distance.normal) };
+		};
+		if (distance.distance < targetDistance)
+			return hit(t);
+		const auto approachBound = dot(relativeTranslation, distance.normal) + rotationSpeedBound;
+		if (approachBound <= 0.0f)
+			return std::nullopt;
+		// Aiming at half of the target distance, so the shapes end up closer than the target even when the bound is exact.
+		const auto nextT = t + (distance.distance - targetDistance / 2.0f) / approachBound;
+		if (nextT >= 1.0f)
+			return std::nullopt;
+		// Not converging can happen when the bodies spin quickly while passing close to each other. The t reached is still safe.
+		if (i == TIME_OF_IMPACT_MAX_ITERATIONS - 1)
+			return hit(t);
+		t = nextT;
+	}
+	ASSERT_NOT_REACHED();
 	return std::nullopt;
 }
 
+auto innerRadius(const Collider& collider) -> float {
+	return std::visit(overloaded{
+		[](const BoxCollider& box) { return std::min(box.size.x, box.size.y) / 2.0f; },
+		[](const CircleCollider& circle) { return circle.radius; },
+		[](const ConvexPolygon& polygon) {
+			auto result = std::numeric_limits<float>::infinity();
+			for (usize i = 0; i < polygon.verts.size(); i++) {
+				result = std::min(result, std::abs(dot(polygon.verts[i], polygon.normals[i])));
+			}
+			return result;
+		},
+		// The center of a compound can be outside of all the children. Moving less than the inner radius of every child still can't make any of them pass through anything.
+		[](const CompoundCollider& compound) {
+			auto result = std::numeric_limits<float>::infinity();
+			for (const auto& child : compound.children) {
+				result = std::min(result, innerRadius(child.collider));
+			}
+			return result;
+		},
+	}, collider);
+}
+
+auto rotationRadius(const Collider& collider) -> float {
+	return std::visit(overloaded{
+		[](const BoxCollider& box) { return box.size.length() / 2.0f; },
+		// Rotating a circle around its center doesn't move its surface.
+		[](const CircleCollider&) { return 0.0f; },
+		[](const ConvexPolygon& polygon) {
+			auto result = 0.0f;
+			for (const auto& vert : polygon.verts) {
+				result = std::max(result, vert.length());
+			}
+			return result;
+		},
+		[](const CompoundCollider& compound) {
+			auto result = 0.0f;
+			for (const auto& child : compound.children) {
+				// The children are rotated around the center of the body so the whole surface of a circle moves.
+				const auto childRadius = std::holds_alternative<CircleCollider>(child.collider)
+					? std::get<CircleCollider>(child.collider).radius
+					: rotationRadius(child.collider);
+				result = std::max(result, child.transform.pos.length() + childRadius);
+			}
+			return result;
+		},
+	}, collider);
+}
+
 // An aabb contains a shape if it contains it's aabb, because if an aabb contains a shape <=> it contains the points on it most in the -x, x, -y and y directions (which just means the aabb of the shape) and vice-versa.
 auto aabbContains(const Aabb& aabb, const Collider& collider, Vec2 pos, float orientation) -> bool {
 	return std::visit(
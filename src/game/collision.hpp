@@ -27,17 +27,14 @@
 
 #include <math/transform.hpp>
 #include <game/body.hpp>
+#include <game/gjk.hpp>
 
 enum class ContactPointFeature : u8 {
 	FACE, VERTEX
 };
 
-// BELOW IS WRONG.
-// Using just a index for the collider doesn't allow the colliders to have different materials like in box2d. They have the same friction and resitution. Would need to make colliders entities and then store 
+// Collisions are stored per pair of shapes (see ShapePair), like in box2d, so the ids only have to be unique between the contacts of one pair of shapes and don't store which child of a compound the feature belongs to.
 // TODO: Could store the properites like bounciness and friction insde the shape instead of the body. 
-// The issue with using pairs of shapes as the keys in the collision system like in box2d is that body ids would also need to be stored somewere.
-// If use use the BodyIds and shape indexes as the keys you get an issue with storing duplicate data because the collision also needs to store things like the id's of the shape in contact point id. 
-// The box2d soution seems better. One issue with it is that it introduces 
 struct ContactPointId {
 	ContactPointFeature featureOnA;
 	i16 featureOnAIndex;
@@ -46,12 +43,17 @@ struct ContactPointId {
 };
 
 struct ContactPoint {
+	// A point on the surface of body B. pos - normal * separation is on the surface of body A.
 	Vec2 pos;
 
-	// Negative if the objects are colliding. So this should always be negative, because the collide function returns nullopt if the objects are not colliding.
+	// Negative if the objects are colliding. Positive for speculative contacts, which are the points that aren't touching yet, but are closer than the speculativeDistance passed to collide.
 	float separation;
 	ContactPointId id;
 
+	// The vectors from the centers of mass of the bodies to the contact point. Computed in preStep, because the positions don't change while solving the velocities.
+	Vec2 r1;
+	Vec2 r2;
+
 	float accumulatedNormalImpluse = 0.0f;
 	float invNormalEffectiveMass = 0.0f;
 	float accumulatedTangentImpulse = 0.0f;
@@ -61,10 +63,28 @@ struct ContactPoint {
 	float bias = 0.0;
 };
 
+// The reference face the SAT chose for a pair in the last step. For resting contacts it almost never changes, so it is tested first. See collide.
+struct SatCache {
+	// The relative transform of the bodies when the face was chosen.
+	Vec2 bPosInA;
+	Vec2 aPosInB;
+	// The rotation of B in the space of A as cos and sin.
+	Vec2 rotation;
+	// The face is kept until the separation along some other normal decreases by this much relative to it.
+	float margin;
+	i16 edgeIndex;
+	bool edgeIsOnB;
+	bool valid = false;
+	// Set by collide if the cached face was used without doing the full SAT.
+	bool hit = false;
+};
+// Switching the reference face between 2 faces with almost equal separations, like the top of one box and the bottom of the box resting on it, changes the feature ids so the impulses aren't warm started. A cached face is kept while it isn't worse than the best face by more than this. 10% of the allowed penetration.
+static constexpr float SAT_CACHE_TOLERANCE = 0.001f;
+
 struct Collision {
 	auto update(const Collision& newCollision) -> void;
 	auto preStep(Body& a, Body& b, float invDeltaTime) -> void;
-	auto applyImpulse(Body& a, Body& b) -> void;
+	auto applyImpulse(SolverBody& a, SolverBody& b) -> void;
 
 	// SAT with clipping can return at most 2 contactPoints. I don't think there is a case when a convex shape would need more than 2 contact points. There is either face vs face, face vs vertex or vertex vs vertex.
 	ContactPoint contacts[2];
@@ -73,18 +93,32 @@ struct Collision {
 	Vec2 normal;
 
 	float coefficientOfFriction;
+	SatCache satCache;
+	GjkCache gjkCache;
 };
 
-auto collide(const Transform& aTransform, const Collider& aCollider, const Transform& bTransform, const Collider& bCollider) -> std::optional<Collision>;
-auto collide(const Transform& aTransform, const BoxCollider& aBox, const Transform& bTransform, const BoxCollider& bBox) -> std::optional<Collision>;
-auto collide(const Transform& aTransform, const BoxCollider& box, const Transform& bTransform, const CircleCollider& circle) -> std::optional<Collision>;
-auto collide(const Transform& aTransform, const CircleCollider& a, const Transform& bTransform, const CircleCollider& b)-> std::optional<Collision>;
-auto collide(const Transform& aTransform, const ConvexPolygon& a, const Transform& bTransform, const ConvexPolygon& b) -> std::optional<Collision>;
+// Also returns the points that are separated by at most speculativeDistance, so the solver can stop the bodies before they start overlapping. See PhysicsWorld::speculativeContacts.
+// Dispatches through a table indexed by the types of the colliders to the overloads below. All of them only use the stack so they can run on multiple threads.
+// The pairs of boxes and polygons use SAT. If a cache is passed they start from the face in it and write the new one into it. Without a cache there is no hysteresis so the results can differ.
+// The colliders can't be compounds. Their children are collided separately, see colliderShape.
+auto collide(const Transform& aTransform, const Collider& aCollider, const Transform& bTransform, const Collider& bCollider, float speculativeDistance = 0.0f, SatCache* cache = nullptr) -> std::optional<Collision>;
+auto collide(const Transform& aTransform, const BoxCollider& aBox, const Transform& bTransform, const BoxCollider& bBox, float speculativeDistance = 0.0f, SatCache* cache = nullptr) -> std::optional<Collision>;
+auto collide(const Transform& aTransform, const BoxCollider& box, const Transform& bTransform, const CircleCollider& circle, float speculativeDistance = 0.0f) -> std::optional<Collision>;
+auto collide(const Transform& aTransform, const BoxCollider& box, const Transform& bTransform, const ConvexPolygon& polygon, float speculativeDistance = 0.0f, SatCache* cache = nullptr) -> std::optional<Collision>;
+auto collide(const Transform& aTransform, const CircleCollider& a, const Transform& bTransform, const CircleCollider& b, float speculativeDistance = 0.0f)-> std::optional<Collision>;
+auto collide(const Transform& aTransform, const ConvexPolygon& polygon, const Transform& bTransform, const BoxCollider& box, float speculativeDistance = 0.0f, SatCache* cache = nullptr) -> std::optional<Collision>;
+auto collide(const Transform& aTransform, const ConvexPolygon& polygon, const Transform& bTransform, const CircleCollider& circle, float speculativeDistance = 0.0f) -> std::optional<Collision>;
+auto collide(const Transform& aTransform, const ConvexPolygon& a, const Transform& bTransform, const ConvexPolygon& b, float speculativeDistance = 0.0f, SatCache* cache = nullptr) -> std::optional<Collision>;
+// Works for every pair of shapes, using GJK for the distance between the shapes and EPA for the penetration when they overlap. The normal chooses the reference and incident faces, which are clipped like in the SAT kernels, so the boxes and polygons get 2 contact points. If a cache is passed GJK starts from the simplex in it and writes the new one into it. Like collide doesn't take compounds. See PhysicsWorld::gjkNarrowphase.
+auto collideGjk(const Transform& aTransform, const Collider& aCollider, const Transform& bTransform, const Collider& bCollider, float speculativeDistance = 0.0f, GjkCache* cache = nullptr) -> std::optional<Collision>;
+// The name of the type with the index typeIndex in the Collider variant.
+auto colliderTypeName(usize typeIndex) -> const char*;
 
 auto contains(Vec2 point, Vec2 pos, float orientation, const Collider& collider) -> bool;
 auto contains(Vec2 point, Vec2 pos, float orientation, const BoxCollider& box) -> bool;
 auto contains(Vec2 point, Vec2 pos, float orientation, const CircleCollider& circle) -> bool;
 auto contains(Vec2 point, Vec2 pos, float orientation, const ConvexPolygon& convexPolygon) -> bool;
+auto contains(Vec2 point, Vec2 pos, float orientation, const CompoundCollider& compound) -> bool;
 
 struct RaycastResult {
 	float t;
@@ -96,6 +130,43 @@ auto raycast(Vec2 rayBegin, Vec2 rayEnd, const Collider& collider, const Transfo
 auto raycast(Vec2 rayBegin, Vec2 rayEnd, const BoxCollider& collider, const Transform& transform) -> std::optional<RaycastResult>;
 auto raycast(Vec2 rayBegin, Vec2 rayEnd, const CircleCollider& collider, const Transform& transform) -> std::optional<RaycastResult>;
 auto raycast(Vec2 rayBegin, Vec2 rayEnd, const ConvexPolygon& collider, const Transform& transform) -> std::optional<RaycastResult>;
+auto raycast(Vec2 rayBegin, Vec2 rayEnd, const CompoundCollider& collider, const Transform& transform) -> std::optional<RaycastResult>;
+// Returns the first t at which the shape moved by t * translation, without rotating, touches the collider. The normal points out of the collider. Like raycast doesn't return a hit if the shape already overlaps the collider.
+// The shape moving into the collider is the same as a ray from the origin going into the Minkowski difference of the collider and the shape, so this is exact and doesn't step through time.
+auto shapeCast(const Collider& shape, const Transform& shapeTransform, Vec2 translation, const Collider& collider, const Transform& transform) -> std::optional<RaycastResult>;
+
+struct ColliderDistance {
+	float distance;
+	// Points from a to b. Zero when the colliders overlap.
+	Vec2 normal;
+};
+// Exact, computed from the Minkowski difference like shapeCast. Zero if the colliders overlap.
+auto colliderDistance(const Collider& a, const Transform& aTransform, const Collider& b, const Transform& bTransform) -> ColliderDistance;
+
+// The motion of a body during a step. The position and the angle change linearly.
+struct BodySweep {
+	Transform start;
+	Vec2 translation;
+	float rotation;
+
+	auto at(float t) const -> Transform;
+};
+struct TimeOfImpact {
+	float t;
+	// Points from a to b. Zero if the colliders overlap at t.
+	Vec2 normal;
+	// The point of a closest to b.
+	Vec2 point;
+};
+static constexpr i32 TIME_OF_IMPACT_MAX_ITERATIONS = 20;
+// Closer shapes are treated as overlapping.
+static constexpr float TIME_OF_IMPACT_MIN_DISTANCE = 0.0001f;
+// Returns the first t at which the distance between the moving colliders is less than targetDistance. Stopping a bit before they touch leaves room for the rounding errors. Returns t = 0 if the colliders already overlap at the start. Doesn't return a hit if they don't get closer.
+auto timeOfImpact(const Collider& a, const BodySweep& aSweep, const Collider& b, const BodySweep& bSweep, float targetDistance) -> std::optional<TimeOfImpact>;
+// The radius of the biggest circle around the center of the collider that fits inside it. A body that moves less than this in a step can't pass through anything.
+auto innerRadius(const Collider& collider) -> float;
+// The distance of the point furthest from the center that moves when the collider rotates.
+auto rotationRadius(const Collider& collider) -> float;
 
 // For intersection tests could just use collide.
 auto aabbContains(const Aabb& aabb, const Collider& collider, Vec2 pos, float orientation) -> bool;
\ No newline at end of file
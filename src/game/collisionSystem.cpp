@@ -0,0 +1,58 @@
+#include <game/collisionSystem.hpp>
+#include <algorithm>
+
+auto CollisionMap::add(const ShapePair& key, const Collision& collision) -> void {
+	newCollisions.push_back(NewEntry{ Entry{ key, collision }, false });
+}
+
+auto CollisionMap::keep(const ShapePair& key) -> void {
+	newCollisions.push_back(NewEntry{ Entry{ key, Collision{} }, true });
+}
+
+auto CollisionMap::endUpdate() -> void {
+	// The pairs are unique so the order after sorting doesn't depend on the order in which they were added.
+	std::sort(newCollisions.begin(), newCollisions.end(), [](const NewEntry& a, const NewEntry& b) { return lessThan(a.entry.key, b.entry.key); });
+
+	// Both arrays are sorted so the old collision with the same key can be found by just advancing the old index.
+	mergedCollisions.clear();
+	usize oldIndex = 0;
+	for (const auto& [newCollision, keepOld] : newCollisions) {
+		while (oldIndex < collisions.size() && lessThan(collisions[oldIndex].key, newCollision.key)) {
+			oldIndex++;
+		}
+
+		if (oldIndex < collisions.size() && collisions[oldIndex].key == newCollision.key) {
+			auto& oldCollision = collisions[oldIndex];
+			if (!keepOld) {
+				oldCollision.collision.update(newCollision.collision);
+			}
+			mergedCollisions.push_back(oldCollision);
+			oldIndex++;
+		} else if (!keepOld) {
+			mergedCollisions.push_back(newCollision);
+		}
+	}
+	std::swap(collisions, mergedCollisions);
+	newCollisions.clear();
+}
+
+auto CollisionMap::clear() -> void {
+	collisions.clear();
+	newCollisions.clear();
+}
+
+auto CollisionMap::lessThan(const ShapePair& a, const ShapePair& b) -> bool {
+	// The version is compared so a pair with a body that was destroyed and replaced on the same index isn't treated as the old pair.
+	if (a.a.index() != b.a.index())
+		return a.a.index() < b.a.index();
+	if (a.b.index() != b.b.index())
+		return a.b.index() < b.b.index();
+	// The pairs of shapes of the same bodies are next to each other, so the solver goes over the contacts of a pair of bodies together.
+	if (a.shapeA != b.shapeA)
+		return a.shapeA < b.shapeA;
+	if (a.shapeB != b.shapeB)
+		return a.shapeB < b.shapeB;
+	if (a.a.version() != b.a.version())
+		return a.a.version() < b.a.version();
+	return a.b.version() < b.b.version();
+}
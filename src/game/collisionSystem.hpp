@@ -1,8 +1,9 @@
 #pragma once
 
 #include <game/collision.hpp>
-#include <unordered_map>
+#include <vector>
 #include <game/body.hpp>
+#include <utils/pairHash.hpp>
 
 struct BodyPair {
 	BodyPair(BodyId bodyA, BodyId bodyB) {
@@ -27,7 +28,39 @@ struct BodyPair {
 
 struct BodyPairHasher {
 	auto operator()(const BodyPair& x) const -> size_t {
-		return std::hash<EntityArray<Body>>()(x.a) * std::hash<EntityArray<Body>>()(x.b);
+		// The versions aren't hashed, because there can't be 2 pairs of alive bodies with the same indices. A stale pair only shares the bucket with the new one.
+		return static_cast<size_t>(hashPair(x.a.index(), x.b.index()));
+	}
+};
+
+// The key of a collision. Every pair of shapes of the bodies has its own collision, so compound bodies get a contact manifold for every pair of touching children and the contacts are matched for warm starting only between the same shapes. The shapes are the indices passed to colliderShape, always 0 for bodies that aren't compounds.
+struct ShapePair {
+	ShapePair(BodyId bodyA, i32 shapeA, BodyId bodyB, i32 shapeB) {
+		if (bodyA.index() < bodyB.index() || (bodyA.index() == bodyB.index() && shapeA < shapeB)) {
+			a = bodyA;
+			b = bodyB;
+			this->shapeA = shapeA;
+			this->shapeB = shapeB;
+		} else {
+			a = bodyB;
+			b = bodyA;
+			this->shapeA = shapeB;
+			this->shapeB = shapeA;
+		}
+	}
+
+	auto operator==(const ShapePair& other) const -> bool = default;
+	auto bodies() const -> BodyPair { return BodyPair{ a, b }; }
+
+	BodyId a;
+	BodyId b;
+	i32 shapeA;
+	i32 shapeB;
+};
+
+struct ShapePairHasher {
+	auto operator()(const ShapePair& x) const -> size_t {
+		return static_cast<size_t>(hashCombine(hashPair(x.a.index(), x.b.index()), hashPair(static_cast<u32>(x.shapeA), static_cast<u32>(x.shapeB))));
 	}
 };
 
@@ -45,5 +78,39 @@ struct hash<BodyPair> {
 
 }
 
-// unordered_map shouldn't be used here because it makes the collisions be resolved in a different order depending on the allocation location and the insertion order. Using a std::map and making a custom comparasion function would work. There must a consistent way to order the entites. This could be done be either using handles instead of pointers or storing an index inside the Body.
-using CollisionMap = std::unordered_map<BodyPair, Collision, BodyPairHasher>;
\ No newline at end of file
+// Stores the collisions between pairs of bodies sorted by the body indices. The sorted order makes the collisions be resolved in the same order every run independent of the allocation locations, insertion order and the order in which the collision system finds the pairs. The storage is contiguous so the solver loops only stream through memory.
+// The collision system first adds all the collisions found this step and then calls endUpdate, which merges them with the collisions from the last step in a single pass. The buffers are reused so after the first few steps nothing is allocated.
+class CollisionMap {
+public:
+	struct Entry {
+		ShapePair key;
+		Collision collision;
+	};
+
+	auto add(const ShapePair& key, const Collision& collision) -> void;
+	// Keeps the collision from the last step unchanged if there was one. Used for pairs that aren't tested, because both bodies are sleeping, so the accumulated impulses are still there when they wake up.
+	auto keep(const ShapePair& key) -> void;
+	// Removes the collisions that weren't added or kept this step. The collisions that were added again are warm started using Collision::update.
+	auto endUpdate() -> void;
+	auto clear() -> void;
+
+	auto size() const -> usize { return collisions.size(); }
+	auto begin() -> std::vector<Entry>::iterator { return collisions.begin(); }
+	auto end() -> std::vector<Entry>::iterator { return collisions.end(); }
+	auto begin() const -> std::vector<Entry>::const_iterator { return collisions.begin(); }
+	auto end() const -> std::vector<Entry>::const_iterator { return collisions.end(); }
+
+	// The order in which the collisions are stored.
+	static auto lessThan(const ShapePair& a, const ShapePair& b) -> bool;
+
+private:
+
+	struct NewEntry {
+		Entry entry;
+		bool keepOld;
+	};
+
+	std::vector<Entry> collisions;
+	std::vector<NewEntry> newCollisions;
+	std::vector<Entry> mergedCollisions;
+};
\ No newline at end of file
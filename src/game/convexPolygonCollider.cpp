@@ -45,7 +45,7 @@ auto ConvexPolygon::massInfo(float density) const -> MassInfo {
         previous = i;  // j is previous vertex to i
     }
 
-    area = abs(area / 2.0f);
+    area = std::abs(area / 2.0f);
 
     float mass = area * density;
 
@@ -55,8 +55,8 @@ auto ConvexPolygon::massInfo(float density) const -> MassInfo {
         float numer = 0.0f;
         for (int j = static_cast<int>(verts.size()) - 1, i = 0; i < verts.size(); j = i, i++) {
             auto P0 = verts[j];
-            auto P1 = verts[0];
-            float a = (float)fabs(cross(P0, P1));
+            auto P1 = verts[i];
+            float a = std::abs(cross(P0, P1));
             float b = (dot(P1, P1) + dot(P1, P0) + dot(P0, P0));
             denom += (a * b);
             numer += a;
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <engine/renderer.hpp>
+#include <engine/camera.hpp>
 
 struct DemoData {
 	const Camera& camera;
@@ -1,5 +1,6 @@
 #include <game/demos/theoJansenLinkageDemo.hpp>
 #include <game/ent.hpp>
+#include <cmath>
 
 #include <imgui/imgui.h>
 using namespace ImGui;
@@ -27,7 +28,7 @@ auto TheoJansenLinkageDemo::load() -> void {
 		const auto lengthAb = distance(aPos, bPos);
 		const auto angleCos = (pow(lengthAb, 2.0f) + pow(lengthAc, 2.0f) - pow(lengthBc, 2.0f)) / (2.0f * lengthAb * lengthAc);
 		const auto angle = acos(angleCos);
-		ASSERT(!isnan(angle));
+		ASSERT(!std::isnan(angle));
 		const auto cPos = aPos + (bPos - aPos).normalized() * Rotation(angle * (flip ? -1.0f : 1.0f)) * lengthAc;
 		const auto c = makeCircle(cPos);
 		return c;
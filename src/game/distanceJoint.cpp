@@ -7,12 +7,7 @@ auto DistanceJoint::preStep(float invDeltaTime) -> void {
 		ent.distanceJoint.destroy(*this);
 	}
 	bias = invDeltaTime;
-}
-
-// Don't know what a correct pendulum should look like. Car keys that were left in the ignition were oscillating back and forth for around 3 minutes and if no one interrupted them, they would have continuted for a bit longer. The car keys were connected by a circle so the friction is should probably different from this kind of joint.
 
-#include <utils/dbg.hpp>
-auto DistanceJoint::applyImpluse() -> void {
 	auto a = ent.body.get(bodyA);
 	auto b = ent.body.get(bodyB);
 	if (!a.has_value() || !b.has_value())
@@ -22,21 +17,28 @@ auto DistanceJoint::applyImpluse() -> void {
 	const auto posOnB = b->transform.pos + anchorOnB * b->transform.rot;
 	const auto bToA = posOnA - posOnB;
 	const auto distanceAb = bToA.length();
-	const auto distanceToFix = distanceAb - requiredDistance;
-	
+	distanceToFix = distanceAb - requiredDistance;
 
 	//Vec2 r1{ 0.0f }, r2{ 0.0f };
-	
-	const auto n = bToA.normalized();
-	Vec2 r1 = posOnA - a->transform.pos, r2 = posOnB - b->transform.pos;
-	float rn1 = dot(r1, n);
-	float rn2 = dot(r2, n);
+
+	normal = bToA.normalized();
+	r1 = posOnA - a->transform.pos;
+	r2 = posOnB - b->transform.pos;
+	float rn1 = dot(r1, normal);
+	float rn2 = dot(r2, normal);
 	float kNormal = a->invMass + b->invMass;
 	kNormal += a->invRotationalInertia * (dot(r1, r1) - rn1 * rn1) + b->invRotationalInertia * (dot(r2, r2) - rn2 * rn2);
 	//kNormal += a->invRotationalInertia * pow(cross(n, r1), 2.0f) + b->invRotationalInertia * pow(cross(n, r2), 2.0f);
+	invNormalEffectiveMass = 1.0f / kNormal;
+}
+
+// Don't know what a correct pendulum should look like. Car keys that were left in the ignition were oscillating back and forth for around 3 minutes and if no one interrupted them, they would have continuted for a bit longer. The car keys were connected by a circle so the friction is should probably different from this kind of joint.
+
+auto DistanceJoint::applyImpluse(SolverBody& a, SolverBody& b) -> void {
+	const auto& n = normal;
 
 	//auto relativeVel = b->vel + posOnB.rotBy90deg() * b->angularVel - (a->vel + posOnA.rotBy90deg() * a->angularVel);
-	auto relativeVel = (b->vel + cross(b->angularVel, r2)) - (a->vel + cross(a->angularVel, r1));
+	auto relativeVel = (b.vel + cross(b.angularVel, r2)) - (a.vel + cross(a.angularVel, r1));
 	float vn = dot(relativeVel, n);
 
 	// Try to zero the velocity by pushing in the direction opposite to the error.
@@ -48,16 +50,16 @@ auto DistanceJoint::applyImpluse() -> void {
 	}
 	/*float dPn = (distanceToFix * bias - vn) / kNormal / 4.0f;*/
 	/*float dPn = (distanceToFix - vn) / kNormal;*/
-	float dPn = (distanceToFix - vn) / kNormal;
+	float dPn = (distanceToFix - vn) * invNormalEffectiveMass;
 	/*float dPn = (distanceToFix - vn) / kNormal;*/
 	//float dPn = (distanceToFix * bias - vn) / kNormal;
 
-	a->vel -= dPn * n * a->invMass;
-	b->vel += dPn * n * b->invMass;
-	a->angularVel -= a->invRotationalInertia * cross(r1, dPn * n);
-	b->angularVel += b->invRotationalInertia * cross(r2, dPn * n);
+	a.vel -= dPn * n * a.invMass;
+	b.vel += dPn * n * b.invMass;
+	a.angularVel -= a.invRotationalInertia * cross(r1, dPn * n);
+	b.angularVel += b.invRotationalInertia * cross(r2, dPn * n);
 
-	relativeVel = b->vel - a->vel;
+	relativeVel = b.vel - a.vel;
 	Vec2 tangent = n.rotBy90deg();
 
 
@@ -96,11 +98,11 @@ auto DistanceJoint::applyImpluse() -> void {
 
 	Vec2 Pt = dPt * tangent;
 
-	a->vel -= a->invMass * Pt;
-	a->angularVel -= a->invRotationalInertia * det(r1, Pt);
+	a.vel -= a.invMass * Pt;
+	a.angularVel -= a.invRotationalInertia * det(r1, Pt);
 
-	b->vel += b->invMass * Pt;
-	b->angularVel += b->invRotationalInertia * det(r2, Pt);
+	b.vel += b.invMass * Pt;
+	b.angularVel += b.invRotationalInertia * det(r2, Pt);
 }
 
 auto DistanceJoint::getEndpoints() const -> std::array<Vec2, 2> {
@@ -11,9 +11,15 @@ struct DistanceJoint {
 	float bias;
 
 	auto preStep(float invDeltaTime) -> void;
-	auto applyImpluse() -> void;
+	auto applyImpluse(SolverBody& a, SolverBody& b) -> void;
 
 	auto getEndpoints() const -> std::array<Vec2, 2>;
+
+	// Computed in preStep from the transforms.
+	Vec2 normal;
+	Vec2 r1, r2;
+	float invNormalEffectiveMass;
+	float distanceToFix;
 };
 
 using DistanceJointId = EntityArray<DistanceJoint>::Id;
@@ -3,6 +3,31 @@
 #include <game/entMacro.hpp>
 
 auto Entites::update() -> void {
+	// The bodies connected by a removed joint might need to start moving again.
+	auto wake = [this](BodyId id) {
+		if (auto body = this->body.get(id); body.has_value() && body->isSleeping()) {
+			body->wake();
+		}
+	};
+	for (const auto& id : distanceJoint.entitiesToRemoveThisFrame()) {
+		if (const auto joint = distanceJoint.get(id); joint.has_value()) {
+			wake(joint->bodyA);
+			wake(joint->bodyB);
+		}
+	}
+	for (const auto& id : revoluteJoint.entitiesToRemoveThisFrame()) {
+		if (const auto joint = revoluteJoint.get(id); joint.has_value()) {
+			wake(joint->bodyA);
+			wake(joint->bodyB);
+		}
+	}
+	for (const auto& id : springJoint.entitiesToRemoveThisFrame()) {
+		if (const auto joint = springJoint.get(id); joint.has_value()) {
+			wake(joint->bodyA);
+			wake(joint->bodyB);
+		}
+	}
+
 #define UPDATE(Name, name) name.update();
 	ENTITY_TYPE_LIST(UPDATE,)
 #undef UPDATE
@@ -3,6 +3,7 @@
 #include <utils/int.hpp>
 #include <utils/refOptional.hpp>
 #include <utils/asserts.hpp>
+#include <utils/pairHash.hpp>
 
 #include <vector>
 
@@ -70,10 +71,14 @@ private:
 
 	std::vector<Id> entitiesToRemove;
 	std::vector<Id> entitiesAddedLastFrame_;
-	std::vector<Id> entitiesAddedThisFrame;
+	std::vector<Id> entitiesAddedThisFrame_;
 	// Could delay the creating of entites until the end of frame. One advantage of doing this is that you can loop over entities and add new ones. The entites would still be created inside the entites list, but the versions would be updated (this also requires the version zero to always be an invalid version, could also make sure it wraps around to 1 on overflow). The created entity ids would be added to at toAdd list, which would be iterated in the update function and the versions would be updated there. Would need to make sure that there aren't any issues if an entity was destroyed on the same frame it was created. Could either first add entites the destroy them or remove all the entites, which are both inside the add and remove list. !!! This wouldn't actually work, when adding an entity pointers could get invalidated so you would need to only allow iterating over indices and only allow access using indices, could make a class that just stores the index and on operator -> gives access to the entity or could just save them into a separate vector, but if I wanted to implmenet the pooling of more complex types so types that store for exapmle vector don't need to get reallocated then this pooling would also need to work for this list.
 public:
 	auto entitiesAddedLastFrame() const -> const std::vector<Id>& { return entitiesAddedLastFrame_; }
+	// Alive, but not yet returned by entitiesAddedLastFrame.
+	auto entitiesAddedThisFrame() const -> const std::vector<Id>& { return entitiesAddedThisFrame_; }
+	// The entites that will be removed on the next update. They are still alive.
+	auto entitiesToRemoveThisFrame() const -> const std::vector<Id>& { return entitiesToRemove; }
 };
 
 namespace std {
@@ -85,7 +90,7 @@ struct hash<EntityArray<Entity>> {
 	using result_type = size_t;
 
 	result_type operator ()(const argument_type& key) const {
-		return std::hash<i32>()(key.index()) * std::hash<i32>()(key.index());
+		return static_cast<size_t>(hashPair(key.index(), key.version()));
 	}
 };
 
@@ -96,8 +101,8 @@ auto EntityArray<Entity>::update() -> void {
 	ASSERT(entities.size() == entityVersions.size());
 	ASSERT(entityVersions.size() == entityIsFree.size());
 
-	std::swap(entitiesAddedThisFrame, entitiesAddedLastFrame_);
-	entitiesAddedThisFrame.clear();
+	std::swap(entitiesAddedThisFrame_, entitiesAddedLastFrame_);
+	entitiesAddedThisFrame_.clear();
 
 	for (const auto id : entitiesToRemove) {
 		if (id.index_ >= entities.size()) {
@@ -171,7 +176,7 @@ auto EntityArray<Entity>::create(Entity&& entity) -> Pair {
 	}
 
 	aliveCount_++;
-	entitiesAddedThisFrame.push_back(id);
+	entitiesAddedThisFrame_.push_back(id);
 	return { id, entities[id.index_] };
 }
 
@@ -214,7 +219,8 @@ auto EntityArray<Entity>::reset() -> void {
 	}
 	entitiesToRemove.clear();
 	entitiesAddedLastFrame_.clear();
-	entitiesAddedThisFrame.clear();
+	entitiesAddedThisFrame_.clear();
+	aliveCount_ = 0;
 }
 
 template<typename Entity>
@@ -77,78 +77,7 @@ Game::Game() {
 }
 
 auto Game::saveLevel() const -> Json::Value {
-	std::unordered_map<i32, i32> oldBodyIndexToNewIndex;
-
-	Level level;
-	level.gravity = gravity;
-
-	for (const auto& [id, body] : ent.body) {
-		// @Hack:
-		if (abs(body.transform.pos.x) > 2000.0f || abs(body.transform.pos.y) > 2000.0f) {
-			continue;
-		}
-		const auto newIndex = static_cast<i32>(level.bodies.size());
-		oldBodyIndexToNewIndex[id.index()] = newIndex;
-
-		auto colliderToLevelCollider = [](const Collider& collider) -> LevelCollider {
-			return std::visit(overloaded{
-				[](const CircleCollider& c) -> LevelCollider { return LevelCircle{ .radius = c.radius }; },
-				[](const BoxCollider& c) -> LevelCollider { return LevelBox{ .size = c.size }; },
-				[](const ConvexPolygon& c) -> LevelCollider { return LevelConvexPolygon{ .verts = c.verts }; },
-			}, collider);
-		};
-
-		// TODO: Maybe check if the convex polygon collider has zero verts.
-
-		level.bodies.push_back(LevelBody{
-			.pos = body.transform.pos,
-			.orientation = body.transform.angle(),
-			.vel = body.vel,
-			.angularVel = body.angularVel,
-			.mass = body.mass,
-			.rotationalInertia = body.rotationalInertia,
-			.coefficientOfFriction = body.coefficientOfFriction,
-			.collider = colliderToLevelCollider(body.collider)
-		});
-	}
-		
-	for (const auto& [id, joint] : ent.distanceJoint) {
-		level.distanceJoints.push_back(LevelDistanceJoint{
-			.bodyAIndex = oldBodyIndexToNewIndex[joint.bodyA.index()],
-			.bodyBIndex = oldBodyIndexToNewIndex[joint.bodyB.index()],
-			.distance = joint.requiredDistance,
-			.anchorA = joint.anchorOnA,
-			.anchorB = joint.anchorOnB
-		});
-	}
-
-	for (const auto& joint : ent.revoluteJoint) {
-		level.revoluteJoints.push_back(LevelRevoluteJoint{
-			.bodyAIndex = oldBodyIndexToNewIndex[joint->bodyA.index()],
-			.bodyBIndex = oldBodyIndexToNewIndex[joint->bodyB.index()],
-			.anchorA = joint->localAnchorA,
-			.anchorB = joint->localAnchorB,
-			.motorSpeed = joint->motorSpeedInRadiansPerSecond,
-		});
-	}
-
-	for (const auto& [id, trail] : ent.trail) {
-		level.trails.push_back(LevelTrail{
-			.bodyIndex = oldBodyIndexToNewIndex[trail.body.index()],
-			.anchor = trail.anchor,
-			.color = trail.color,
-			.maxHistorySize = trail.maxHistorySize,
-		});
-	}
-
-	for (const auto& ignoredCollision : ent.collisionsToIgnore) {
-		level.ignoredCollisions.push_back(LevelIgnoredCollision{
-			.bodyAIndex = oldBodyIndexToNewIndex[ignoredCollision.a.index()],
-			.bodyBIndex = oldBodyIndexToNewIndex[ignoredCollision.b.index()],
-		});
-	}
-
-	return level.toJson();
+	return physics.saveLevel().toJson();
 }
 
 auto Game::saveLevelToFile(std::string_view path) -> void {
@@ -170,79 +99,8 @@ auto Game::loadLevel(const Json::Value& levelJson) -> bool {
 	}
 
 	resetLevel();
-
-	gravity = level.gravity;
-
-	for (const auto& levelBody : level.bodies) {
-		const auto collider = std::visit(overloaded{
-			[](const LevelCircle& c) -> Collider { return CircleCollider{ .radius = c.radius }; },
-			[](const LevelBox& c) -> Collider { return BoxCollider{ .size = c.size }; },
-			[](const LevelConvexPolygon& c) -> Collider { 
-				ConvexPolygon polygon{ .verts = c.verts };
-				polygon.calculateNormals();
-				return polygon;  
-			},
-		}, levelBody.collider);
-		const auto& [_, body] = ent.body.create(Body{ levelBody.pos, collider, false });
-		body.transform.rot = Rotation{ levelBody.orientation };
-		body.vel = levelBody.vel;
-		body.angularVel = levelBody.angularVel;
-		body.mass = levelBody.mass;
-		body.rotationalInertia = levelBody.rotationalInertia;
-		body.coefficientOfFriction = levelBody.coefficientOfFriction;
-		body.updateInvMassAndInertia();
-	}
-
-	for (const auto& levelJoint : level.distanceJoints) {
-		const auto bodyA = ent.body.validate(levelJoint.bodyAIndex);
-		const auto bodyB = ent.body.validate(levelJoint.bodyBIndex);
-		if (!bodyA.has_value() || !bodyB.has_value()) {
-			goto error;
-		}
-		ent.distanceJoint.create(DistanceJoint{
-			.bodyA = *bodyA,
-			.bodyB = *bodyB,
-			.requiredDistance = levelJoint.distance,
-			.anchorOnA = levelJoint.anchorA,
-			.anchorOnB = levelJoint.anchorB,
-		});
-	}
-
-	for (const auto& levelJoint : level.revoluteJoints) {
-		const auto bodyA = ent.body.validate(levelJoint.bodyAIndex);
-		const auto bodyB = ent.body.validate(levelJoint.bodyBIndex);
-		if (!bodyA.has_value() || !bodyB.has_value()) {
-			goto error;
-		}
-		ent.revoluteJoint.create(RevoluteJoint{
-			.bodyA = *bodyA,
-			.bodyB = *bodyB,
-			.localAnchorA = levelJoint.anchorA,
-			.localAnchorB = levelJoint.anchorB,
-			.motorSpeedInRadiansPerSecond = levelJoint.motorSpeed,
-		});
-	}
-
-	for (const auto& levelTrail : level.trails) {
-		const auto body = ent.body.validate(levelTrail.bodyIndex);
-		if (!body.has_value()) {
-			goto error;
-		}
-		ent.trail.create(Trail{
-			.body = *body,
-			.anchor = levelTrail.anchor,
-			.color = levelTrail.color,
-			.maxHistorySize = levelTrail.maxHistorySize,
-		});
-	}
-
-	for (const auto& ignoredCollision : level.ignoredCollisions) {
-		const auto bodyA = ent.body.validate(ignoredCollision.bodyAIndex);
-		const auto bodyB = ent.body.validate(ignoredCollision.bodyBIndex);
-		if (!bodyA.has_value() || !bodyB.has_value()) {
-			goto error;
-		}
-		ent.collisionsToIgnore.insert({ *bodyA, *bodyB });
+	if (!physics.loadLevel(level)) {
+		goto error;
 	}
 	afterLoad();
 
@@ -303,18 +161,42 @@ auto Game::drawUi() -> void {
 		Checkbox("scale contact normals", &scaleContactNormals);
 	}
 
-	auto disableGravity = gravity == Vec2{ 0.0f };
+	auto disableGravity = physics.gravity == Vec2{ 0.0f };
 	Checkbox("disable gravity", &disableGravity);
 	if (disableGravity) {
-		gravity = Vec2{ 0.0f };
+		physics.gravity = Vec2{ 0.0f };
 	} else {
-		gravity = Vec2{ 0.0f, -10.0f };
+		physics.gravity = Vec2{ 0.0f, -10.0f };
+	}
+
+	Checkbox("warm starting", &PhysicsWorld::warmStarting);
+	Checkbox("accumulate impulses", &PhysicsWorld::accumulateImpulses);
+	Checkbox("sleeping", &PhysicsWorld::sleepingEnabled);
+	Checkbox("graph coloring", &PhysicsWorld::graphColoring);
+	Checkbox("wide contact solver", &PhysicsWorld::wideContactSolver);
+	Checkbox("continuous collision detection", &PhysicsWorld::continuousCollisionDetection);
+	Checkbox("speculative contacts", &PhysicsWorld::speculativeContacts);
+	Checkbox("gjk narrowphase", &PhysicsWorld::gjkNarrowphase);
+	Checkbox("sat cache", &PhysicsWorld::satCache);
+	Checkbox("narrowphase timings", &PhysicsWorld::narrowphaseTimings);
+	Checkbox("bvh statistics", &PhysicsWorld::bvhStatistics);
+	auto broadphase = static_cast<int>(physics.broadphaseType());
+	if (Combo("broadphase", &broadphase, "bvh\0spatial hash\0sweep and prune\0\0")) {
+		physics.setBroadphase(static_cast<PhysicsWorld::BroadphaseType>(broadphase));
+	}
+	InputFloat("spatial hash cell size", &SpatialHashCollisionSystem::cellSize);
+	Checkbox("bvh bulk build", &BvhCollisionSystem::bulkBuild);
+	Checkbox("wide bvh", &BvhCollisionSystem::wideTree);
+	InputFloat("rebuild bvh when area grows by", &BvhCollisionSystem::rebuildAreaRatio);
+	if (Button("rebuild bvh")) {
+		physics.bvhCollisionSystem.rebuild();
 	}
-
-	Checkbox("warm starting", &warmStarting);
-	Checkbox("accumulate impulses", &accumulateImpulses);
 	InputInt("solver iterations", &physicsSolverIterations);
 	InputInt("physics substeps", &physicsSubsteps);
+	auto solverThreads = physics.jobSystem.threadCount();
+	if (InputInt("solver threads", &solverThreads)) {
+		physics.jobSystem.setThreadCount(std::clamp(solverThreads, 1, static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))));
+	}
 	End();
 
 	Begin("savestates");
@@ -459,6 +341,8 @@ auto Game::drawUi() -> void {
 			row("collideTotal", physicsProfile.collideTotal);
 			row("colliderUpdateBvh", physicsProfile.collideUpdateBvh);
 			row("collideDetectCollisions", physicsProfile.collideDetectCollisions);
+			row("collideFindPairs", physicsProfile.collideFindPairs);
+			row("continuousCollision", physicsProfile.continuousCollision);
 			row("solveTotal", physicsProfile.solveTotal);
 			row("solvePrestep", physicsProfile.solvePrestep);
 			row("solveVelocities", physicsProfile.solveVelocities);
@@ -466,6 +350,66 @@ auto Game::drawUi() -> void {
 
 			EndTable();
 		}
+		Text("solver islands: %d", physicsProfile.solverIslands);
+		Text("enlarged aabbs: %d", physicsProfile.collideEnlargedAabbs);
+		Text("shrunk aabbs: %d", physicsProfile.collideShrunkAabbs);
+		Text("speculative contact points: %d", physicsProfile.speculativeContactPoints);
+		Text("continuous bodies: %d", physicsProfile.continuousBodies);
+		Text("time of impact hits: %d", physicsProfile.timeOfImpactHits);
+		if (physicsProfile.satCacheTests > 0) {
+			Text("sat cache hits: %d / %d (%.1f%%)", physicsProfile.satCacheHits, physicsProfile.satCacheTests, 100.0f * physicsProfile.satCacheHits / physicsProfile.satCacheTests);
+		}
+		if (PhysicsWorld::gjkNarrowphase) {
+			Text("gjk iterations: %d", physicsProfile.gjkIterations);
+		}
+		if (TreeNode("narrowphase")) {
+			for (i32 a = 0; a < PhysicsProfile::COLLIDER_TYPE_COUNT; a++) {
+				for (i32 b = a; b < PhysicsProfile::COLLIDER_TYPE_COUNT; b++) {
+					const auto pairs = physicsProfile.narrowphasePairs[a][b];
+					if (pairs == 0)
+						continue;
+					if (PhysicsWorld::narrowphaseTimings) {
+						Text("%s %s: %d pairs %.3f ms", colliderTypeName(a), colliderTypeName(b), pairs, physicsProfile.narrowphaseMilliseconds[a][b]);
+					} else {
+						Text("%s %s: %d pairs", colliderTypeName(a), colliderTypeName(b), pairs);
+					}
+				}
+			}
+			TreePop();
+		}
+		if (PhysicsWorld::bvhStatistics && TreeNode("bvh")) {
+			const auto& bvh = physicsProfile.bvh;
+			Text("internal node area: %.2f", bvh.internalNodeArea);
+			Text("leaves: %d", bvh.leafCount);
+			Text("max depth: %d", bvh.maxDepth);
+			Text("average leaf depth: %.2f", bvh.averageLeafDepth);
+			float histogram[BvhStatistics::DEPTH_HISTOGRAM_SIZE];
+			for (i32 i = 0; i < BvhStatistics::DEPTH_HISTOGRAM_SIZE; i++) {
+				histogram[i] = static_cast<float>(bvh.leafDepthHistogram[i]);
+			}
+			PlotHistogram("leaf depths", histogram, BvhStatistics::DEPTH_HISTOGRAM_SIZE, 0, nullptr, 0.0f, FLT_MAX, ImVec2{ 0.0f, 80.0f });
+			TreePop();
+		}
+		if (physicsProfile.coloredIslands != 0 && TreeNode("graph coloring")) {
+			Text("colored islands: %d", physicsProfile.coloredIslands);
+			Text("colors: %d", physicsProfile.graphColors);
+			for (i32 i = 0; i < physicsProfile.graphColors; i++) {
+				Text("color %d: %d constraints", i, physicsProfile.graphColorConstraints[i]);
+			}
+			Text("overflow: %d constraints", physicsProfile.graphColorOverflowConstraints);
+			TreePop();
+		}
+#ifdef _DEBUG
+		const auto& ignored = physicsProfile.collisionsToIgnore;
+		if (TreeNode("collisions to ignore hash table")) {
+			Text("size: %lld", ignored.size);
+			Text("bucket count: %lld", ignored.bucketCount);
+			Text("load factor: %.2f", ignored.loadFactor);
+			Text("max bucket size: %lld", ignored.maxBucketSize);
+			Text("average probe length: %.2f", ignored.averageProbeLength);
+			TreePop();
+		}
+#endif
 		End();
 	}
 
@@ -598,39 +542,46 @@ auto Game::update() -> void {
 					closestFeaturePos = body.transform.pos;
 				}
 
-				auto convexPolygonCase = [&](Span<const Vec2> verts) {
-					if (verts.size() <= 1)
-						return;
-
-					usize previous = verts.size() - 1;
-					for (usize i = 0; i < verts.size(); previous = i, i++) {
-						const auto cursorPosInColliderSpace = cursorPos * body.transform.inversed();
-						const auto pointOnLine = LineSegment{ verts[previous], verts[i] }.closestPointTo(cursorPosInColliderSpace);
-						const auto d = distance(pointOnLine, cursorPosInColliderSpace);
-						if (d < minDistance) {
-							minDistance = d;
-							closestFeaturePos = pointOnLine * body.transform;
-						}
-					}
-				};
-
-				std::visit(overloaded{
-					[&](const BoxCollider& box) {
-						const auto& corners = box.getCorners(Transform::identity);
-						convexPolygonCase(Span{ corners.data(), corners.size() });
-					},
-					[&](const CircleCollider& circle) {
-						const auto centerToPos = cursorPos - body.transform.pos;
-						const auto d = abs(centerToPos.length() - circle.radius);
-						if (d < minDistance) {
-							minDistance = d;
-							closestFeaturePos = body.transform.pos + circle.radius * centerToPos.normalized();
+				for (i32 shapeIndex = 0; shapeIndex < shapeCount(body.collider); shapeIndex++) {
+					const auto shape = colliderShape(body.collider, body.transform, shapeIndex);
+					auto convexPolygonCase = [&](Span<const Vec2> verts) {
+						if (verts.size() <= 1)
+							return;
+
+						usize previous = verts.size() - 1;
+						for (usize i = 0; i < verts.size(); previous = i, i++) {
+							const auto cursorPosInColliderSpace = cursorPos * shape.transform.inversed();
+							const auto pointOnLine = LineSegment{ verts[previous], verts[i] }.closestPointTo(cursorPosInColliderSpace);
+							const auto d = distance(pointOnLine, cursorPosInColliderSpace);
+							if (d < minDistance) {
+								minDistance = d;
+								closestFeaturePos = pointOnLine * shape.transform;
+							}
 						}
-					},
-					[&](const ConvexPolygon& polygon) {
-						convexPolygonCase(polygon.verts);
-					},
-					}, body.collider);
+					};
+
+					std::visit(overloaded{
+						[&](const BoxCollider& box) {
+							const auto& corners = box.getCorners(Transform::identity);
+							convexPolygonCase(Span{ corners.data(), corners.size() });
+						},
+						[&](const CircleCollider& circle) {
+							const auto centerToPos = cursorPos - shape.transform.pos;
+							const auto d = abs(centerToPos.length() - circle.radius);
+							if (d < minDistance) {
+								minDistance = d;
+								closestFeaturePos = shape.transform.pos + circle.radius * centerToPos.normalized();
+							}
+						},
+						[&](const ConvexPolygon& polygon) {
+							convexPolygonCase(Span<const Vec2>{ polygon.verts.data(), polygon.verts.size() });
+						},
+						// The children are visited by the loop.
+						[&](const CompoundCollider&) {
+							ASSERT_NOT_REACHED();
+						},
+						}, shape.collider);
+				}
 			}
 			//Debug::drawPoint(closestFeaturePos, Vec3::RED);
 			//Debug::drawHollowCircle(cursorPos, 0.03f / camera.zoom);
@@ -679,11 +630,11 @@ auto Game::update() -> void {
 		Vec2 previous = cursorPos;
 		for (int i = 0; i < 50; i++) {
 			float x = i / 20.0f / 16.0f / camera.zoom;
-			Vec2 v = cursorPos + Vec2{ x * initialVelocity.x, x * x * gravity.y / 2.0f + x * initialVelocity.y };
+			Vec2 v = cursorPos + Vec2{ x * initialVelocity.x, x * x * physics.gravity.y / 2.0f + x * initialVelocity.y };
 			if ((previous - v).lengthSq() < 0.001f)
 				continue;
 
-			const auto collision = collisionSystem.raycast(previous, v);
+			const auto collision = physics.collisionSystem().raycast(previous, v);
 			if (collision.has_value()) {
 				Debug::drawLine(previous, previous + ((v - previous) * collision->t));
 				Debug::drawPoint(previous + ((v - previous) * collision->t));
@@ -737,6 +688,9 @@ auto Game::update() -> void {
 		if (bodyUnderCursor.has_value() && Input::isMouseButtonDown(MouseButton::LEFT)) {
 			grabbed = bodyUnderCursor;
 			grabPointInGrabbedObjectSpace = bodyUnderCursorPosInSelectedObjectSpace;
+			if (auto body = ent.body.get(*grabbed); body.has_value()) {
+				body->wake();
+			}
 		}
 		if (Input::isMouseButtonUp(MouseButton::LEFT)) {
 			grabbed = std::nullopt;
@@ -905,7 +859,7 @@ auto Game::update() -> void {
 	}
 
 	// The collisions system has to be updated because even if the physics isn't updated, because it registres new entities.
-	collisionSystem.update();
+	physics.collisionSystem().update();
 	if (doPhysicsUpdate) {
 		physicsProfile = PhysicsProfile{};
 		Timer timer;
@@ -928,7 +882,7 @@ auto Game::update() -> void {
 				loadedDemo->physicsStep();
 			}
 
-			physicsStep(substepLength, physicsSolverIterations, physicsProfile);
+			physics.step(substepLength, physicsSolverIterations, physicsProfile);
 		}
 		physicsProfile.total = timer.elapsedMilliseconds();
 	}
@@ -993,108 +947,19 @@ auto Game::update() -> void {
 //	}
 //}
 
-auto Game::physicsStep(float dt, i32 solverIterations, PhysicsProfile& profile) -> void {
-	for (const auto [_, body] : ent.body) {
-		if (body.isStatic())
-			continue;
-
-		// It might be better to use impulses instead of forces so they are independent of the time step.
-		body.vel += (body.force * body.invMass + gravity) * dt;
-		body.force = Vec2{ 0.0f };
-
-		body.angularVel += body.torque * body.invRotationalInertia * dt;
-		body.angularVel *= pow(angularDamping, dt);
-		body.torque = 0.0f;
-	}
-
-	{
-		Timer timerCollision;
-		{
-			Timer timer;
-			collisionSystem.updateBvh();
-			profile.collideUpdateBvh = timer.elapsedMilliseconds();
-		}
-		{
-			Timer timer;
-			collisionSystem.detectCollisions(contacts, ent.collisionsToIgnore);
-			profile.collideDetectCollisions = timer.elapsedMilliseconds();
-		}
-		profile.collideTotal += timerCollision.elapsedMilliseconds();
-	}
-
-	const auto invDt = 1.0f / dt;
-
-	Timer solveTimer;
-	{
-		Timer timer;
-		for (auto& [key, contact] : contacts) {
-			auto a = ent.body.get(key.a);
-			auto b = ent.body.get(key.b);
-			// @Performance: this and the other loop.
-			if (!a.has_value() || !b.has_value())
-				continue;
-			contact.preStep(*a, *b, invDt);
-		}
-
-		for (const auto& [_, joint] : ent.distanceJoint) {
-			joint.preStep(invDt);
-		}
-
-		for (auto joint : ent.revoluteJoint) {
-			joint->preStep(invDt);
-		}
-
-		for (auto joint : ent.springJoint) {
-			joint->preStep(invDt);
-		}
-		profile.solvePrestep += timer.elapsedMilliseconds();
-	}
-
-	{
-		Timer timer;
-		// TODO: Should the constraints be solved separately from collisions?
-		for (int i = 0; i < solverIterations; i++) {
-			for (auto& [key, contact] : contacts) {
-				auto a = ent.body.get(key.a);
-				auto b = ent.body.get(key.b);
-				if (!a.has_value() || !b.has_value())
-					continue;
-				contact.applyImpulse(*a, *b);
-			}
-			for (const auto& [_, joint] : ent.distanceJoint) {
-				joint.applyImpluse();
-			}
-			for (auto joint : ent.revoluteJoint) {
-				joint->applyImpluse();
-			}
-			for (auto joint : ent.springJoint) {
-				joint->applyImpluse();
-			}
-		}
-		profile.solveVelocities = timer.elapsedMilliseconds();
-	}
-	profile.solveTotal += solveTimer.elapsedMilliseconds();
-
-	for (const auto [_, body] : ent.body) {
-		if (body.isStatic())
-			continue;
-		body.transform.pos += body.vel * dt;
-		body.transform.rot *= Rotation{ body.angularVel * dt };
-	}
-}
-
 auto Game::draw(Vec2 cursorPos) -> void {
 	for (const auto& [_, body] : ent.body) {
-		const auto color = body.isStatic() ? Vec3::WHITE / 2.0f : Vec3::WHITE;
+		const auto color = body.isStatic() ? Vec3::WHITE / 2.0f : (body.isSleeping() ? Vec3::WHITE * 0.75f : Vec3::WHITE);
 		Debug::drawCollider(body.collider, body.transform.pos, body.transform.angle(), color);
 	}
 
 	if (drawContacts) {
-		for (const auto& [_, collision] : contacts) {
+		for (const auto& [_, collision] : physics.contacts) {
 			for (i32 i = 0; i < collision.contactCount; i++) {
 				const auto& contact = collision.contacts[i];
 				const auto scale = scaleContactNormals ? contact.separation : 0.1f;
-				Debug::drawRay(contact.pos, -collision.normal * scale, Vec3::RED);
+				// The speculative contacts aren't touching yet.
+				Debug::drawRay(contact.pos, -collision.normal * scale, contact.separation > 0.0f ? Vec3::BLUE : Vec3::RED);
 			}
 		}
 	}
@@ -1160,20 +1025,13 @@ auto Game::draw(Vec2 cursorPos) -> void {
 }
 
 auto Game::resetLevel() -> void {
-	collisionSystem.reset();
-	ent.reset();
-	contacts.clear();
-	gravity = Vec2{ 0.0f, -10.0f };
+	physics.reset();
 	loadedDemo = std::nullopt;
 	selected = std::nullopt;
 }
 
 auto Game::afterLoad() -> void {
-	// For the simulation to be deterministic and to make reloading demos deterministic this code needs to run before before the physics step. If it doesn't there is going to be one step in which collision isn't checked, because the bodies aren't registered in the collisionSystem and won't be untill the next frame, because then they will be accessible throught entitiesAddedThisFrame. So the bodies will get integrated without detecting collisions. 
-	// One way to make sure this works is to call ent.update after all the functions that create entites, but it seems simpler to just call it right after loading a level.
-	// Hopefully there aren't any errors in this logic.
-	ent.update();
-	collisionSystem.update();
+	physics.afterLoad();
 
 	const auto NOT_IGNORED_MAX_AREA = 1000.0f;
 	// Using optional because any amount of bodies in the loop can be ignored.
@@ -1207,6 +1065,14 @@ auto Game::selectToolGui() -> void {
 	// Pushing the index because without this swithing to a different object would preserve the values from the previous object. So you could click on one distance joint set it's length then click on another and it would also change it's length to the previous selected one's length.
 	PushID(entityIdIndex(*selected));
 
+	auto wakeBodies = [](BodyId a, BodyId b) {
+		for (const auto id : { a, b }) {
+			if (auto body = ent.body.get(id); body.has_value()) {
+				body->wake();
+			}
+		}
+	};
+
 	std::visit(overloaded{
 		[&](const BodyId& bodyId) {
 			auto body = ent.body.get(bodyId);
@@ -1220,21 +1086,27 @@ auto Game::selectToolGui() -> void {
 				} else {
 					body->updateMass();
 				}
+				body->wake();
 			}
+			Checkbox("is bullet", &body->isBullet);
 		},
 		[&](const DistanceJointId& jointId) {
 			auto joint = ent.distanceJoint.get(jointId);
 			if (!joint.has_value())
 				return;
 
-			InputFloat("required distance", &joint->requiredDistance);
+			if (InputFloat("required distance", &joint->requiredDistance)) {
+				wakeBodies(joint->bodyA, joint->bodyB);
+			}
 		},
 		[&](const RevoluteJointId& jointId) {
 			auto joint = ent.revoluteJoint.get(jointId);
 			if (!joint.has_value())
 				return;
 			
-			InputFloat("motor speed", &joint->motorSpeedInRadiansPerSecond);
+			if (InputFloat("motor speed", &joint->motorSpeedInRadiansPerSecond)) {
+				wakeBodies(joint->bodyA, joint->bodyB);
+			}
 		},
 		[&](const SpringJointId& jointId) {
 			auto joint = ent.springJoint.get(jointId);
@@ -1430,5 +1302,3 @@ auto Game::selectToolDraw() -> void {
 	}, *selected);
 }
 
-bool Game::warmStarting = true;
-bool Game::accumulateImpulses = true;
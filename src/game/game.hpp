@@ -1,9 +1,8 @@
 #pragma once
 
-#include <game/bvhCollisionSystem.hpp>
+#include <game/physicsWorld.hpp>
 #include <engine/camera.hpp>
 #include <json/JsonValue.hpp>
-#include <game/physicsProfile.hpp>
 #include <game/demo.hpp>
 
 #include <filesystem>
@@ -82,7 +81,6 @@ public:
 	auto openErrorPopupModal(const char* message) -> void;
 	auto displayErrorPopupModal() -> void;
 	auto update() -> void;
-	auto physicsStep(float dt, i32 solverIterations, PhysicsProfile& profile) -> void;
 	auto draw(Vec2 cursorPos) -> void;
 	auto resetLevel() -> void;
 	auto afterLoad() -> void;
@@ -152,8 +150,6 @@ public:
 	bool chainLine = false;
 	std::optional<Vec2> lineStart;
 
-	CollisionMap contacts;
-
 	std::vector<std::unique_ptr<Demo>> demos;
 	std::optional<Demo&> loadedDemo;
 
@@ -161,9 +157,6 @@ public:
 
 	Camera camera;
 
-	Vec2 gravity{ 0.0f };
-	float angularDamping = 0.98f;
-
 	std::optional<Vec2> grabStart;
 
 	bool updatePhysics = true;
@@ -187,13 +180,5 @@ public:
 	bool snapToGrid = true;
 	bool snapToObjects = true;
 
-
-	// This is also called warm starting.
-	// The physics engine uses an iterative systems of equation solver which uses the Gauss-Seidel method. It starts with an initial guess and tries to get as close as possible to the analytical solution (if one exists else it gets it closer to satifying all equations). Enabling this makes it so the solver tries to improve convergence by expoliting temporal coherence between solutions. It uses the solution from the previous frame as the starting guess for the new frame.
-	/*static bool usePreviousStepImpulseSolutionsAsInitialGuess;*/
-	static bool warmStarting;
-	static bool positionCorrection;
-	static bool accumulateImpulses;
-
-	BvhCollisionSystem collisionSystem;
+	PhysicsWorld physics;
 };
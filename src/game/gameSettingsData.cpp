@@ -1,4 +1,4 @@
-#include <game\gameSettingsData.hpp>
+#include <game/gameSettingsData.hpp>
 #include <utils/serialize.hpp>
 using namespace Json;
 
@@ -0,0 +1,374 @@
+#include <game/gjk.hpp>
+#include <utils/asserts.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+auto GjkShape::support(Vec2 dir, i16 startIndex) const -> i16 {
+	const auto count = static_cast<i16>(verts.size());
+	if (startIndex < 0 || startIndex >= count) {
+		ASSERT_NOT_REACHED();
+		startIndex = 0;
+	}
+	const auto next = [count](i16 index, i16 step) -> i16 {
+		return static_cast<i16>((index + step + count) % count);
+	};
+
+	auto index = startIndex;
+	auto indexDot = dot(verts[index], dir);
+	const i16 step = dot(verts[next(index, 1)], dir) > indexDot ? 1 : -1;
+	for (;;) {
+		const auto nextIndex = next(index, step);
+		const auto nextDot = dot(verts[nextIndex], dir);
+		if (nextDot <= indexDot)
+			break;
+		index = nextIndex;
+		indexDot = nextDot;
+	}
+	return index;
+}
+
+// A vert of the Minkowski difference of the cores, b - a, and the verts of a and b it is made of. Everything is in the object space of a.
+struct SimplexVert {
+	Vec2 a;
+	Vec2 b;
+	Vec2 w;
+	i16 indexA;
+	i16 indexB;
+	// The barycentric coordinate of the point of the simplex closest to the origin.
+	float weight;
+};
+
+static auto simplexVert(const GjkShape& a, i16 indexA, const GjkShape& b, i16 indexB, const Transform& bToAObjectSpace) -> SimplexVert {
+	const auto pointA = a.verts[indexA];
+	const auto pointB = b.verts[indexB] * bToAObjectSpace;
+	return SimplexVert{ .a = pointA, .b = pointB, .w = pointB - pointA, .indexA = indexA, .indexB = indexB, .weight = 1.0f };
+}
+
+// The point of the Minkowski difference furthest along dir. startFrom is usually the vert closest to the new one, so the supports walk only a few verts.
+static auto supportVert(const GjkShape& a, const GjkShape& b, const Transform& bToAObjectSpace, Vec2 dir, const SimplexVert& startFrom) -> SimplexVert {
+	const auto indexA = a.support(-dir, startFrom.indexA);
+	const auto indexB = b.support(dir * bToAObjectSpace.rot.inversed(), startFrom.indexB);
+	return simplexVert(a, indexA, b, indexB, bToAObjectSpace);
+}
+
+struct Simplex {
+	SimplexVert verts[3];
+	i32 count;
+
+	// Keeps only the verts of the feature closest to the origin and sets their weights. The regions are tested using the signs of the barycentric coordinates, like in Box2D.
+	auto solve2() -> void;
+	auto solve3() -> void;
+	auto searchDirection() const -> Vec2;
+};
+
+auto Simplex::solve2() -> void {
+	const auto w1 = verts[0].w;
+	const auto w2 = verts[1].w;
+	const auto e12 = w2 - w1;
+
+	const auto d12_2 = -dot(w1, e12);
+	if (d12_2 <= 0.0f) {
+		verts[0].weight = 1.0f;
+		count = 1;
+		return;
+	}
+	const auto d12_1 = dot(w2, e12);
+	if (d12_1 <= 0.0f) {
+		verts[0] = verts[1];
+		verts[0].weight = 1.0f;
+		count = 1;
+		return;
+	}
+	const auto invD12 = 1.0f / (d12_1 + d12_2);
+	verts[0].weight = d12_1 * invD12;
+	verts[1].weight = d12_2 * invD12;
+	count = 2;
+}
+
+auto Simplex::solve3() -> void {
+	const auto w1 = verts[0].w;
+	const auto w2 = verts[1].w;
+	const auto w3 = verts[2].w;
+
+	const auto e12 = w2 - w1;
+	const auto d12_1 = dot(w2, e12);
+	const auto d12_2 = -dot(w1, e12);
+
+	const auto e13 = w3 - w1;
+	const auto d13_1 = dot(w3, e13);
+	const auto d13_2 = -dot(w1, e13);
+
+	const auto e23 = w3 - w2;
+	const auto d23_1 = dot(w3, e23);
+	const auto d23_2 = -dot(w2, e23);
+
+	const auto n123 = det(e12, e13);
+	const auto d123_1 = n123 * det(w2, w3);
+	const auto d123_2 = n123 * det(w3, w1);
+	const auto d123_3 = n123 * det(w1, w2);
+
+	if (d12_2 <= 0.0f && d13_2 <= 0.0f) {
+		verts[0].weight = 1.0f;
+		count = 1;
+		return;
+	}
+	if (d12_1 > 0.0f && d12_2 > 0.0f && d123_3 <= 0.0f) {
+		const auto invD12 = 1.0f / (d12_1 + d12_2);
+		verts[0].weight = d12_1 * invD12;
+		verts[1].weight = d12_2 * invD12;
+		count = 2;
+		return;
+	}
+	if (d13_1 > 0.0f && d13_2 > 0.0f && d123_2 <= 0.0f) {
+		const auto invD13 = 1.0f / (d13_1 + d13_2);
+		verts[0].weight = d13_1 * invD13;
+		verts[1] = verts[2];
+		verts[1].weight = d13_2 * invD13;
+		count = 2;
+		return;
+	}
+	if (d12_1 <= 0.0f && d23_2 <= 0.0f) {
+		verts[0] = verts[1];
+		verts[0].weight = 1.0f;
+		count = 1;
+		return;
+	}
+	if (d13_1 <= 0.0f && d23_1 <= 0.0f) {
+		verts[0] = verts[2];
+		verts[0].weight = 1.0f;
+		count = 1;
+		return;
+	}
+	if (d23_1 > 0.0f && d23_2 > 0.0f && d123_1 <= 0.0f) {
+		const auto invD23 = 1.0f / (d23_1 + d23_2);
+		verts[0] = verts[2];
+		verts[0].weight = d23_2 * invD23;
+		verts[1].weight = d23_1 * invD23;
+		count = 2;
+		return;
+	}
+	// The origin is inside the triangle.
+	const auto invD123 = 1.0f / (d123_1 + d123_2 + d123_3);
+	verts[0].weight = d123_1 * invD123;
+	verts[1].weight = d123_2 * invD123;
+	verts[2].weight = d123_3 * invD123;
+	count = 3;
+}
+
+auto Simplex::searchDirection() const -> Vec2 {
+	if (count == 1) {
+		return -verts[0].w;
+	}
+	// The normal of the edge on the side of the origin.
+	const auto e12 = verts[1].w - verts[0].w;
+	if (det(e12, -verts[0].w) > 0.0f) {
+		return cross(1.0f, e12);
+	}
+	return cross(e12, 1.0f);
+}
+
+auto gjkDistance(const GjkShape& a, const GjkShape& b, const Transform& bToAObjectSpace, GjkCache* cache) -> GjkDistance {
+	Simplex simplex;
+	simplex.count = 0;
+	if (cache != nullptr && cache->count > 0 && cache->count <= 3) {
+		for (i16 i = 0; i < cache->count; i++) {
+			const auto indexA = cache->indexA[i], indexB = cache->indexB[i];
+			// The collider could have been changed.
+			if (indexA < 0 || indexA >= static_cast<i16>(a.verts.size()) || indexB < 0 || indexB >= static_cast<i16>(b.verts.size())) {
+				simplex.count = 0;
+				break;
+			}
+			simplex.verts[simplex.count] = simplexVert(a, indexA, b, indexB, bToAObjectSpace);
+			simplex.count++;
+		}
+		// After rotating the verts of the old simplex can end up on a line or on top of each other, which would make the weights divide by zero.
+		const auto& v = simplex.verts;
+		if ((simplex.count == 2 && (v[1].w - v[0].w).lengthSq() < GJK_OVERLAP_DISTANCE * GJK_OVERLAP_DISTANCE)
+			|| (simplex.count == 3 && std::abs(det(v[1].w - v[0].w, v[2].w - v[0].w)) < GJK_OVERLAP_DISTANCE * GJK_OVERLAP_DISTANCE)) {
+			simplex.count = 0;
+		}
+	}
+	if (simplex.count == 0) {
+		simplex.verts[0] = simplexVert(a, 0, b, 0, bToAObjectSpace);
+		simplex.count = 1;
+	}
+
+	i16 iterations = 0;
+	while (iterations < GJK_MAX_ITERATIONS) {
+		// A new vert that was already in the simplex before solving means that there is no progress.
+		i16 oldIndexA[3], oldIndexB[3];
+		const auto oldCount = simplex.count;
+		for (i32 i = 0; i < oldCount; i++) {
+			oldIndexA[i] = simplex.verts[i].indexA;
+			oldIndexB[i] = simplex.verts[i].indexB;
+		}
+
+		if (simplex.count == 1) {
+			simplex.verts[0].weight = 1.0f;
+		} else if (simplex.count == 2) {
+			simplex.solve2();
+		} else {
+			simplex.solve3();
+		}
+		if (simplex.count == 3)
+			break;
+
+		const auto dir = simplex.searchDirection();
+		// The origin is on the simplex.
+		if (dir.lengthSq() < std::numeric_limits<float>::epsilon() * std::numeric_limits<float>::epsilon())
+			break;
+
+		const auto vert = supportVert(a, b, bToAObjectSpace, dir, simplex.verts[simplex.count - 1]);
+		iterations++;
+		auto duplicate = false;
+		for (i32 i = 0; i < oldCount; i++) {
+			if (vert.indexA == oldIndexA[i] && vert.indexB == oldIndexB[i]) {
+				duplicate = true;
+				break;
+			}
+		}
+		if (duplicate)
+			break;
+		simplex.verts[simplex.count] = vert;
+		simplex.count++;
+	}
+
+	GjkDistance result{ .pointA = Vec2{ 0.0f }, .pointB = Vec2{ 0.0f }, .normal = Vec2{ 0.0f }, .distance = 0.0f };
+	for (i32 i = 0; i < simplex.count; i++) {
+		result.pointA += simplex.verts[i].a * simplex.verts[i].weight;
+		result.pointB += simplex.verts[i].b * simplex.verts[i].weight;
+	}
+	if (simplex.count == 1) {
+		result.distance = simplex.verts[0].w.length();
+		if (result.distance > 0.0f) {
+			result.normal = simplex.verts[0].w / result.distance;
+		}
+	} else if (simplex.count == 2) {
+		result.normal = (simplex.verts[1].w - simplex.verts[0].w).rotBy90deg().normalized();
+		result.distance = dot(result.normal, simplex.verts[0].w);
+		if (result.distance < 0.0f) {
+			result.normal = -result.normal;
+			result.distance = -result.distance;
+		}
+	} else {
+		result.pointB = result.pointA;
+	}
+
+	if (cache != nullptr) {
+		cache->count = static_cast<i16>(simplex.count);
+		for (i32 i = 0; i < simplex.count; i++) {
+			cache->indexA[i] = simplex.verts[i].indexA;
+			cache->indexB[i] = simplex.verts[i].indexB;
+		}
+		cache->iterations = iterations;
+	}
+	return result;
+}
+
+auto epaPenetration(const GjkShape& a, const GjkShape& b, const Transform& bToAObjectSpace, const GjkCache& simplex) -> EpaPenetration {
+	// Every iteration adds one vert so the polytope fits on the stack.
+	SimplexVert polytope[3 + EPA_MAX_ITERATIONS];
+	i32 count = 0;
+	for (i32 i = 0; i < simplex.count; i++) {
+		polytope[count] = simplexVert(a, simplex.indexA[i], b, simplex.indexB[i], bToAObjectSpace);
+		count++;
+	}
+	const auto support = [&](Vec2 dir, const SimplexVert& startFrom) {
+		return supportVert(a, b, bToAObjectSpace, dir, startFrom);
+	};
+
+	// If the cores only touch GJK ends with the origin on a vert or an edge of the simplex. The missing verts are the supports in the directions away from them.
+	if (count == 1) {
+		for (const auto dir : { Vec2{ 1.0f, 0.0f }, Vec2{ -1.0f, 0.0f }, Vec2{ 0.0f, 1.0f }, Vec2{ 0.0f, -1.0f } }) {
+			const auto vert = support(dir, polytope[0]);
+			if ((vert.w - polytope[0].w).lengthSq() > EPA_TOLERANCE * EPA_TOLERANCE) {
+				polytope[count] = vert;
+				count++;
+				break;
+			}
+		}
+	}
+	if (count == 2) {
+		const auto edge = polytope[1].w - polytope[0].w;
+		for (const auto dir : { edge.rotBy90deg(), -edge.rotBy90deg() }) {
+			const auto vert = support(dir, polytope[0]);
+			if (std::abs(det(edge, vert.w - polytope[0].w)) > EPA_TOLERANCE * edge.length()) {
+				polytope[count] = vert;
+				count++;
+				break;
+			}
+		}
+	}
+	if (count < 3) {
+		// The Minkowski difference is a point or a segment, for example for 2 circles with the same center. Any direction separates them.
+		return EpaPenetration{ .normal = Vec2{ 1.0f, 0.0f }, .depth = 0.0f, .pointA = polytope[0].a, .pointB = polytope[0].b };
+	}
+	// The outward normals of the edges of a counterclockwise polygon are the edges rotated clockwise.
+	if (det(polytope[1].w - polytope[0].w, polytope[2].w - polytope[0].w) < 0.0f) {
+		std::swap(polytope[1], polytope[2]);
+	}
+
+	i32 closestEdge = 0;
+	Vec2 closestNormal{ 0.0f };
+	auto closestDistance = std::numeric_limits<float>::infinity();
+	for (i32 iteration = 0; ; iteration++) {
+		closestDistance = std::numeric_limits<float>::infinity();
+		for (i32 i = 0; i < count; i++) {
+			const auto edge = polytope[(i + 1) % count].w - polytope[i].w;
+			if (edge.lengthSq() == 0.0f)
+				continue;
+			const auto normal = edge.rotBy90deg().normalized();
+			const auto distance = dot(normal, polytope[i].w);
+			if (distance < closestDistance) {
+				closestDistance = distance;
+				closestNormal = normal;
+				closestEdge = i;
+			}
+		}
+		if (iteration == EPA_MAX_ITERATIONS)
+			break;
+
+		const auto vert = support(closestNormal, polytope[closestEdge]);
+		// The edge is on the boundary of the difference.
+		if (dot(vert.w, closestNormal) - closestDistance < EPA_TOLERANCE)
+			break;
+		// The verts of the simplex from GJK don't have to be on the boundary of the difference, for example the first one or the ones from the last step. A new vert can make them concave, so like when building a convex hull the verts between the edges the new vert is in front of are replaced by it. These edges are next to each other, because the polytope is convex.
+		bool inFront[3 + EPA_MAX_ITERATIONS];
+		for (i32 i = 0; i < count; i++) {
+			inFront[i] = det(polytope[(i + 1) % count].w - polytope[i].w, vert.w - polytope[i].w) < 0.0f;
+		}
+		// The closest edge is always in front, but because of rounding the test might say it isn't.
+		inFront[closestEdge] = true;
+		SimplexVert expanded[3 + EPA_MAX_ITERATIONS];
+		i32 expandedCount = 0;
+		for (i32 i = 0; i < count; i++) {
+			const auto previousInFront = inFront[(i + count - 1) % count];
+			if (previousInFront && inFront[i])
+				continue;
+			expanded[expandedCount] = polytope[i];
+			expandedCount++;
+			if (!previousInFront && inFront[i]) {
+				expanded[expandedCount] = vert;
+				expandedCount++;
+			}
+		}
+		std::copy(expanded, expanded + expandedCount, polytope);
+		count = expandedCount;
+	}
+
+	// The point of the edge closest to the origin.
+	const auto& start = polytope[closestEdge];
+	const auto& end = polytope[(closestEdge + 1) % count];
+	const auto edge = end.w - start.w;
+	const auto t = edge.lengthSq() == 0.0f ? 0.0f : std::clamp(dot(closestNormal * closestDistance - start.w, edge) / edge.lengthSq(), 0.0f, 1.0f);
+	return EpaPenetration{
+		// Translating b by -closestNormal * closestDistance moves the closest edge of the difference b - a onto the origin.
+		.normal = -closestNormal,
+		.depth = closestDistance,
+		.pointA = start.a + (end.a - start.a) * t,
+		.pointB = start.b + (end.b - start.b) * t,
+	};
+}
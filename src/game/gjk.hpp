@@ -0,0 +1,53 @@
+#pragma once
+
+#include <math/transform.hpp>
+#include <utils/span.hpp>
+
+// A convex polygon inflated by a radius, in the object space of its collider. A circle is a single vertex with the radius of the circle. The verts are counterclockwise.
+// GJK and EPA only need the point of the shape furthest along a direction, so the same code works for every pair of shapes. Only the cores, the shapes without the radii, are used by them, the radii are subtracted from the distance afterwards.
+struct GjkShape {
+	Span<const Vec2> verts;
+	float radius;
+
+	// The index of the vert furthest along dir. The dot products with dir along the boundary of a convex polygon only have one maximum so this walks from startIndex towards the neighbour that is further until neither is. When starting from the support point of a close direction, like the one from the last step, it only visits a few verts even on big polygons.
+	auto support(Vec2 dir, i16 startIndex) const -> i16;
+};
+
+// The indices of the verts of the simplex GJK ended with. Stored in the Collision of the pair, so in the next step GJK starts from the simplex of the last step and usually finishes after 1 or 2 iterations.
+struct GjkCache {
+	i16 indexA[3];
+	i16 indexB[3];
+	// 0 if there is no simplex.
+	i16 count = 0;
+	// Set by gjkDistance. The number of new verts it had to find.
+	i16 iterations = 0;
+};
+
+static constexpr i32 GJK_MAX_ITERATIONS = 20;
+static constexpr i32 EPA_MAX_ITERATIONS = 20;
+// EPA stops when the support point along the normal of the closest edge is closer than this to the edge.
+static constexpr float EPA_TOLERANCE = 0.0001f;
+// Closer cores are treated as overlapping and EPA finds the normal, because which side of the simplex the origin is on is mostly rounding error.
+static constexpr float GJK_OVERLAP_DISTANCE = 0.00001f;
+
+struct GjkDistance {
+	// The closest points of the cores of a and b in the object space of a.
+	Vec2 pointA;
+	Vec2 pointB;
+	// From a to b. Zero if the cores overlap. When the shapes are touching the difference of the points is mostly rounding error, so the normal of the edge of the simplex is used, which has the direction of the edge of one of the shapes.
+	Vec2 normal;
+	float distance;
+};
+// The distance between the cores of the shapes. If cache is not null GJK starts from the simplex in it and the final simplex is written into it. EPA needs the final simplex so pass a cache if the shapes can overlap.
+auto gjkDistance(const GjkShape& a, const GjkShape& b, const Transform& bToAObjectSpace, GjkCache* cache) -> GjkDistance;
+
+struct EpaPenetration {
+	// From a to b in the object space of a. Translating b by normal * depth separates the cores.
+	Vec2 normal;
+	float depth;
+	// The points on the boundaries of the cores of a and b, which have to be moved onto each other to separate them.
+	Vec2 pointA;
+	Vec2 pointB;
+};
+// Expands the simplex that gjkDistance ended with into the edge of the Minkowski difference of the cores closest to the origin. Only valid if gjkDistance found the cores overlapping, which makes the origin lie inside the simplex.
+auto epaPenetration(const GjkShape& a, const GjkShape& b, const Transform& bToAObjectSpace, const GjkCache& simplex) -> EpaPenetration;
@@ -19,6 +19,32 @@ auto LevelConvexPolygon::fromJson(const Json::Value& json) -> LevelConvexPolygon
 	return polygon;
 }
 
+auto LevelCompound::toJson() const -> Json::Value {
+	auto json = Json::Value::emptyObject();
+	json["children"] = Json::Value::emptyArray();
+	auto& childrenJson = json["children"].array();
+	for (const auto& child : children) {
+		childrenJson.push_back({
+			{ "pos", { { "x", child.pos.x }, { "y", child.pos.y } } },
+			{ "orientation", child.orientation },
+			{ "collider", levelColliderToJson(child.collider) },
+		});
+	}
+	return json;
+}
+
+auto LevelCompound::fromJson(const Json::Value& json) -> LevelCompound {
+	LevelCompound compound;
+	for (const auto& child : json.at("children").array()) {
+		compound.children.push_back(LevelCompoundChild{
+			.pos = Vec2{ child.at("pos").at("x").floatNumber(), child.at("pos").at("y").floatNumber() },
+			.orientation = child.at("orientation").floatNumber(),
+			.collider = levelColliderFromJson(child.at("collider")),
+		});
+	}
+	return compound;
+}
+
 auto levelColliderToJson(const LevelCollider& collider) -> Json::Value {
 
 #define JSON(type) \
@@ -28,6 +54,7 @@ auto levelColliderToJson(const LevelCollider& collider) -> Json::Value {
 		JSON(LevelBox)
 		JSON(LevelCircle)
 		JSON(LevelConvexPolygon)
+		JSON(LevelCompound)
 	}, collider);
 
 #undef JSON
@@ -40,6 +67,7 @@ auto levelColliderFromJson(const Json::Value& collider) -> LevelCollider{
 	UNJSON(LevelBox)
 	UNJSON(LevelCircle)
 	UNJSON(LevelConvexPolygon)
+	UNJSON(LevelCompound)
 
 #undef UNJSON
 	ASSERT_NOT_REACHED();
@@ -1,4 +1,4 @@
-#include <game\levelFormat\levelData.hpp>
+#include <game/levelFormat/levelData.hpp>
 #include <utils/serialize.hpp>
 using namespace Json;
 
@@ -36,6 +36,7 @@ auto LevelBody::toJson() const -> Json::Value {
 	result["rotationalInertia"] = Json::Value(rotationalInertia);
 	result["coefficientOfFriction"] = Json::Value(coefficientOfFriction);
 	result["collider"] = levelColliderToJson(collider);
+	result["isBullet"] = Json::Value(isBullet);
 	return result;
 }
 
@@ -49,6 +50,7 @@ auto LevelBody::fromJson(const Json::Value& json) -> LevelBody {
 		.rotationalInertia = json.at("rotationalInertia").number(),
 		.coefficientOfFriction = json.at("coefficientOfFriction").number(),
 		.collider = levelColliderFromJson(json.at("collider")),
+		.isBullet = json.contains("isBullet") ? json.at("isBullet").boolean() : false,
 	};
 }
 
@@ -1,12 +1,74 @@
 #pragma once
 
+#include <utils/int.hpp>
+
+// Only collected in debug builds, because it requires iterating over all the buckets every step.
+struct HashTableStatistics {
+	i64 size = 0;
+	i64 bucketCount = 0;
+	float loadFactor = 0.0f;
+	i64 maxBucketSize = 0;
+	// The average number of elements compared when looking up an element that is in the table. A lookup of an element that isn't in the table compares on average loadFactor elements.
+	float averageProbeLength = 0.0f;
+};
+
+// In 2D the surface area used by the surface area heuristic is the perimeter, so the areas here are perimeters.
+struct BvhStatistics {
+	// The sum of the areas of the internal nodes. This is the cost the insertion minimizes. The lower it is the less nodes are visited when finding the overlapping pairs.
+	float internalNodeArea = 0.0f;
+	i32 leafCount = 0;
+	i32 maxDepth = 0;
+	float averageLeafDepth = 0.0f;
+	static constexpr i32 DEPTH_HISTOGRAM_SIZE = 32;
+	// The number of leaves at each depth. The last element also counts the leaves that are deeper.
+	i32 leafDepthHistogram[DEPTH_HISTOGRAM_SIZE]{};
+};
+
 // could add a counter for how many collisions were checked, but I don't know if this information is useful. Also I don't know how would it work in case of multistepping.
 struct PhysicsProfile {
 	float collideUpdateBvh = 0.0f;
 	float collideDetectCollisions = 0.0f;
+	// The part of collideDetectCollisions spent traversing the bvh.
+	float collideFindPairs = 0.0f;
 	float collideTotal = 0.0f;
+	// The number of aabbs updated by the broadphase, because the bodies left them or because they were much bigger than needed. Updating them is a reinsertion in the bvh. Summed over the steps.
+	i32 collideEnlargedAabbs = 0;
+	i32 collideShrunkAabbs = 0;
+	// The narrowphase split by the types of the colliders of the pairs. Indexed by the indices of the types in the Collider variant, with the smaller index first. Summed over the steps.
+	static constexpr i32 COLLIDER_TYPE_COUNT = 3;
+	i32 narrowphasePairs[COLLIDER_TYPE_COUNT][COLLIDER_TYPE_COUNT]{};
+	// Only measured if PhysicsWorld::narrowphaseTimings is set, because reading the clock takes a big part of the time of a single pair. Summed over the threads so with multiple threads it can be more than collideDetectCollisions.
+	float narrowphaseMilliseconds[COLLIDER_TYPE_COUNT][COLLIDER_TYPE_COUNT]{};
+	// The pairs that had a SatCache from the last step and the ones of them for which the cached face was enough and the full SAT was skipped. Summed over the steps.
+	i32 satCacheTests = 0;
+	i32 satCacheHits = 0;
+	// The new simplex verts GJK had to find with PhysicsWorld::gjkNarrowphase. Starting from the simplex of the last step keeps it low. Summed over the steps.
+	i32 gjkIterations = 0;
+	// The contact points of the bodies that aren't touching yet. Summed over the steps.
+	i32 speculativeContactPoints = 0;
+	// The time spent moving the bodies that use continuous collision detection. Not a part of collideTotal, because it happens after solving.
+	float continuousCollision = 0.0f;
+	// Summed over the steps.
+	i32 continuousBodies = 0;
+	i32 timeOfImpactHits = 0;
 	float solveTotal = 0.0f;
 	float solvePrestep = 0.0f;
 	float solveVelocities = 0.0f;
 	float total = 0.0f;
-};
\ No newline at end of file
+
+	i32 solverIslands = 0;
+	// Islands with at least PhysicsWorld::GRAPH_COLORING_MIN_CONSTRAINTS constraints are split into colors and the constraints of one color are solved in parallel. The counts are summed over all colored islands.
+	static constexpr i32 MAX_GRAPH_COLORS = 32;
+	i32 coloredIslands = 0;
+	// The number of colors that have at least one constraint.
+	i32 graphColors = 0;
+	i32 graphColorConstraints[MAX_GRAPH_COLORS]{};
+	// The constraints that didn't fit into any color. They are solved on a single thread after the colors.
+	i32 graphColorOverflowConstraints = 0;
+	// The batches of contacts solved by the wide contact solver, summed over the solver iterations. Zero if it wasn't used.
+	i32 wideContactBatches = 0;
+
+	// Only computed if PhysicsWorld::bvhStatistics is set or the tree can be rebuilt when it degrades.
+	BvhStatistics bvh;
+	HashTableStatistics collisionsToIgnore;
+};
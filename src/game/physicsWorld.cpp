@@ -0,0 +1,897 @@
+#include <game/physicsWorld.hpp>
+#include <game/ent.hpp>
+#include <game/wideContactSolver.hpp>
+#include <utils/timer.hpp>
+#include <math/utils.hpp>
+#include <utils/overloaded.hpp>
+#include <utils/fileIo.hpp>
+#include <json/JsonParser.hpp>
+#include <bit>
+#include <span>
+
+template<typename Table>
+static auto hashTableStatistics(const Table& table) -> HashTableStatistics {
+	HashTableStatistics statistics{
+		.size = static_cast<i64>(table.size()),
+		.bucketCount = static_cast<i64>(table.bucket_count()),
+		.loadFactor = table.load_factor(),
+	};
+	i64 comparisonsToFindAll = 0;
+	for (usize i = 0; i < table.bucket_count(); i++) {
+		// The i-th element in a bucket requires i comparisons to find.
+		const auto bucketSize = static_cast<i64>(table.bucket_size(i));
+		statistics.maxBucketSize = std::max(statistics.maxBucketSize, bucketSize);
+		comparisonsToFindAll += bucketSize * (bucketSize + 1) / 2;
+	}
+	if (statistics.size != 0) {
+		statistics.averageProbeLength = static_cast<float>(comparisonsToFindAll) / static_cast<float>(statistics.size);
+	}
+	return statistics;
+}
+
+auto PhysicsWorld::step(float dt, i32 solverIterations, PhysicsProfile& profile) -> void {
+	wakeBodiesAffectedByChanges();
+
+	for (const auto [_, body] : ent.body) {
+		if (body.isStatic())
+			continue;
+
+		if (body.isSleeping()) {
+			if (body.force == Vec2{ 0.0f } && body.torque == 0.0f)
+				continue;
+			body.wake();
+		}
+
+		// It might be better to use impulses instead of forces so they are independent of the time step.
+		body.vel += (body.force * body.invMass + gravity) * dt;
+		body.force = Vec2{ 0.0f };
+
+		body.angularVel += body.torque * body.invRotationalInertia * dt;
+		body.angularVel *= pow(angularDamping, dt);
+		body.torque = 0.0f;
+	}
+
+	{
+		Timer timerCollision;
+		{
+			Timer timer;
+			collisionSystem().updateBvh(dt, profile);
+			profile.collideUpdateBvh = timer.elapsedMilliseconds();
+		}
+		{
+			Timer timer;
+			collisionSystem().detectCollisions(dt, contacts, ent.collisionsToIgnore, jobSystem, profile);
+			profile.collideDetectCollisions = timer.elapsedMilliseconds();
+		}
+#ifdef _DEBUG
+		profile.collisionsToIgnore = hashTableStatistics(ent.collisionsToIgnore);
+#endif
+		if (broadphaseType_ == BroadphaseType::BVH && (bvhStatistics || BvhCollisionSystem::rebuildAreaRatio > 0.0f)) {
+			profile.bvh = bvhCollisionSystem.statistics();
+			// The tree is only used again in the next step so it is fine to rebuild it after the collisions were detected.
+			bvhCollisionSystem.rebuildIfDegraded(profile.bvh);
+		}
+		profile.collideTotal += timerCollision.elapsedMilliseconds();
+	}
+
+	const auto invDt = 1.0f / dt;
+
+	Timer solveTimer;
+	{
+		Timer timer;
+		auto canMove = [](const Body& body) -> bool {
+			return !body.isStatic() && body.isAwake;
+		};
+		auto jointCanMove = [&canMove](BodyId bodyA, BodyId bodyB) -> bool {
+			const auto a = ent.body.get(bodyA);
+			const auto b = ent.body.get(bodyB);
+			return a.has_value() && b.has_value() && (canMove(*a) || canMove(*b));
+		};
+
+		contactsToSolve.clear();
+		for (auto& [key, contact] : contacts) {
+			auto a = ent.body.get(key.a);
+			auto b = ent.body.get(key.b);
+			if (!a.has_value() || !b.has_value())
+				continue;
+			// The collisions between sleeping bodies are kept with their accumulated impulses so they can be warm started after waking up.
+			if (!canMove(*a) && !canMove(*b))
+				continue;
+			contact.preStep(*a, *b, invDt);
+			for (i8 i = 0; i < contact.contactCount; i++) {
+				if (contact.contacts[i].separation > 0.0f) {
+					profile.speculativeContactPoints++;
+				}
+			}
+			contactsToSolve.push_back({ &contact, key.a.index(), key.b.index() });
+		}
+
+		distanceJointsToSolve.clear();
+		for (const auto& [_, joint] : ent.distanceJoint) {
+			joint.preStep(invDt);
+			if (jointCanMove(joint.bodyA, joint.bodyB)) {
+				distanceJointsToSolve.push_back({ &joint, joint.bodyA.index(), joint.bodyB.index() });
+			}
+		}
+
+		revoluteJointsToSolve.clear();
+		for (const auto& [_, joint] : ent.revoluteJoint) {
+			joint.preStep(invDt);
+			if (jointCanMove(joint.bodyA, joint.bodyB)) {
+				revoluteJointsToSolve.push_back({ &joint, joint.bodyA.index(), joint.bodyB.index() });
+			}
+		}
+
+		springJointsToSolve.clear();
+		for (const auto& [_, joint] : ent.springJoint) {
+			joint.preStep(invDt);
+			if (jointCanMove(joint.bodyA, joint.bodyB)) {
+				springJointsToSolve.push_back({ &joint, joint.bodyA.index(), joint.bodyB.index() });
+			}
+		}
+
+		// Has to happen after the preStep, because it applies the accumulated impulses to the bodies.
+		for (const auto& [id, body] : ent.body) {
+			const auto index = static_cast<usize>(id.index());
+			if (index >= solverBodies.size()) {
+				solverBodies.resize(index + 1);
+			}
+			solverBodies[index] = SolverBody{
+				.vel = body.vel,
+				.angularVel = body.angularVel,
+				.invMass = body.invMass,
+				.invRotationalInertia = body.invRotationalInertia,
+			};
+		}
+		profile.solvePrestep += timer.elapsedMilliseconds();
+	}
+
+	{
+		Timer timer;
+		buildSolverIslands();
+		profile.solverIslands = static_cast<i32>(solverIslands.size());
+		profile.coloredIslands = static_cast<i32>(coloredIslands.size());
+		// Not accumulated over the substeps like the timings, because the counts of a single step are more useful.
+		std::fill(std::begin(profile.graphColorConstraints), std::end(profile.graphColorConstraints), 0);
+		profile.graphColorOverflowConstraints = 0;
+		profile.wideContactBatches = 0;
+		for (const auto& colored : coloredIslands) {
+			for (i32 i = 0; i < PhysicsProfile::MAX_GRAPH_COLORS; i++) {
+				profile.graphColorConstraints[i] += islandColors[colored.firstColor + i].size();
+			}
+			profile.graphColorOverflowConstraints += islandColors[colored.firstColor + PhysicsProfile::MAX_GRAPH_COLORS].size();
+		}
+		profile.graphColors = 0;
+		for (const auto count : profile.graphColorConstraints) {
+			if (count != 0) {
+				profile.graphColors++;
+			}
+		}
+
+		// The islands don't share any dynamic bodies so they can be solved independently. Each island has it's own copies of the static bodies it touches so nothing is written to the same memory from multiple threads. Inside an island the constraints are solved in the same order as they would be if everything was solved together, so the result doesn't depend on the thread count.
+		// TODO: Should the constraints be solved separately from collisions?
+		jobSystem.parallelFor(static_cast<i32>(uncoloredIslands.size()), [this, solverIterations](i32 index, i32) {
+			const auto& island = solverIslands[uncoloredIslands[index]];
+			for (int i = 0; i < solverIterations; i++) {
+				solveGroupConstraints(island, 0, island.size());
+			}
+		});
+
+		// The constraints of a color don't share any bodies, so they can be solved in parallel. The colors are still solved one after another, so it's Gauss-Seidel between the colors and Jacobi inside them, but because inside a color nothing depends on anything else the result is the same as solving the color serially.
+		// @Performance: Could solve the uncolored islands while waiting for the colors, but then the threads would have to synchronize between colors without blocking.
+		for (const auto& colored : coloredIslands) {
+			for (int i = 0; i < solverIterations; i++) {
+				for (i32 colorIndex = 0; colorIndex < PhysicsProfile::MAX_GRAPH_COLORS; colorIndex++) {
+					const auto& color = islandColors[colored.firstColor + colorIndex];
+					const auto size = color.size();
+					const auto batchCount = (size + GRAPH_COLOR_BATCH_SIZE - 1) / GRAPH_COLOR_BATCH_SIZE;
+					if (wideContactSolver && accumulateImpulses) {
+						profile.wideContactBatches += static_cast<i32>((color.contacts.size() + GRAPH_COLOR_BATCH_SIZE - 1) / GRAPH_COLOR_BATCH_SIZE);
+					}
+					jobSystem.parallelFor(batchCount, [this, &color, size](i32 batch, i32) {
+						const auto begin = batch * GRAPH_COLOR_BATCH_SIZE;
+						const auto end = std::min((batch + 1) * GRAPH_COLOR_BATCH_SIZE, size);
+						if (!wideContactSolver || !accumulateImpulses) {
+							solveGroupConstraints(color, begin, end);
+							return;
+						}
+						// The contacts come first in the group.
+						const auto contactsEnd = std::min(end, color.contacts.size());
+						if (begin < contactsEnd) {
+							solveContactsWide(std::span{ contactsToSolve }.subspan(color.contacts.begin + begin, contactsEnd - begin), islandSolverBodies);
+						}
+						solveGroupConstraints(color, std::max(begin, contactsEnd), end);
+					});
+				}
+				const auto& overflow = islandColors[colored.firstColor + PhysicsProfile::MAX_GRAPH_COLORS];
+				solveGroupConstraints(overflow, 0, overflow.size());
+			}
+		}
+
+		for (usize i = 0; i < islandSolverBodies.size(); i++) {
+			const auto bodyIndex = islandSolverBodyIndices[i];
+			if (!isStaticBody[bodyIndex]) {
+				solverBodies[bodyIndex] = islandSolverBodies[i];
+			}
+		}
+		profile.solveVelocities = timer.elapsedMilliseconds();
+	}
+	profile.solveTotal += solveTimer.elapsedMilliseconds();
+
+	for (const auto& [id, body] : ent.body) {
+		const auto& solverBody = solverBodies[id.index()];
+		body.vel = solverBody.vel;
+		body.angularVel = solverBody.angularVel;
+	}
+
+	continuousBodies.clear();
+	for (const auto [id, body] : ent.body) {
+		if (body.isStatic() || body.isSleeping())
+			continue;
+		if (continuousCollisionDetection && (body.isBullet || (body.vel * dt).length() > innerRadius(body.collider))) {
+			continuousBodies.push_back(id);
+			continue;
+		}
+		body.transform.pos += body.vel * dt;
+		body.transform.rot *= Rotation{ body.angularVel * dt };
+	}
+	{
+		Timer timer;
+		integrateContinuousBodies(dt, profile);
+		profile.continuousCollision += timer.elapsedMilliseconds();
+	}
+
+	updateSleeping(dt);
+}
+
+auto PhysicsWorld::integrateContinuousBodies(float dt, PhysicsProfile& profile) -> void {
+	profile.continuousBodies += static_cast<i32>(continuousBodies.size());
+	// The other bodies are already at their positions at the end of the step. The bullets see the dynamic bodies as not moving, which is fine as long as they are much faster than them.
+	for (const auto& id : continuousBodies) {
+		auto body = ent.body.get(id);
+		auto remainingTime = dt;
+		const auto coreRadius = innerRadius(body->collider) * CONTINUOUS_CORE_FRACTION;
+		for (i32 substep = 0; substep < CONTINUOUS_MAX_SUBSTEPS; substep++) {
+			const BodySweep sweep{ body->transform, body->vel * remainingTime, body->angularVel * remainingTime };
+			const auto end = sweep.at(1.0f);
+			// Everything that can touch the body while it moves is inside this aabb.
+			const auto sweptAabb = aabb(body->collider, sweep.start).combined(aabb(body->collider, end)).addedPadding(rotationRadius(body->collider));
+			continuousCandidates.clear();
+			collisionSystem().queryAabb(sweptAabb, continuousCandidates);
+
+			std::optional<TimeOfImpact> firstImpact;
+			std::optional<BodyId> firstImpactBody;
+			for (const auto& otherId : continuousCandidates) {
+				if (otherId == id)
+					continue;
+				const auto other = ent.body.get(otherId);
+				if (!other->isStatic() && (!body->isBullet || other->isBullet))
+					continue;
+				if (ent.collisionsToIgnore.contains(BodyPair{ id, otherId }))
+					continue;
+				// Only something the center of the body would go through or pass close to can be tunneled through. The body can also overlap the other things at the end of the step, but then the contact pushes it back to the side it came from. Skipping them stops the bodies sliding quickly along the ground from being stopped above it in every step.
+				if (!shapeCast(CircleCollider{ coreRadius }, sweep.start, sweep.translation, other->collider, other->transform).has_value())
+					continue;
+				const BodySweep otherSweep{ other->transform, Vec2{ 0.0f }, 0.0f };
+				const auto impact = timeOfImpact(body->collider, sweep, other->collider, otherSweep, CONTINUOUS_TARGET_DISTANCE);
+				// Comparing the indices when the times are equal so the result doesn't depend on the order of the query results.
+				if (impact.has_value() && (!firstImpact.has_value() || impact->t < firstImpact->t || (impact->t == firstImpact->t && otherId.index() < firstImpactBody->index()))) {
+					firstImpact = impact;
+					firstImpactBody = otherId;
+				}
+			}
+			if (!firstImpact.has_value()) {
+				body->transform = end;
+				break;
+			}
+
+			profile.timeOfImpactHits++;
+			body->transform = sweep.at(firstImpact->t);
+			remainingTime *= 1.0f - firstImpact->t;
+			// The body already overlaps the other body so it stays where it is for the rest of the step and the contact found in the next step pushes it out. Moving it further could push it out on the other side.
+			if (firstImpact->normal == Vec2{ 0.0f })
+				break;
+			// Only the part of the step before the impact is integrated. The rest is integrated in the next substep after applying an impulse at the point of impact that removes the velocity along the normal like in an inelastic collision. The contact is solved properly in the next step, so this only has to stop the body from passing through.
+			auto other = ent.body.get(*firstImpactBody);
+			const auto normal = firstImpact->normal;
+			const auto r1 = firstImpact->point - body->transform.pos;
+			const auto r2 = firstImpact->point - other->transform.pos;
+			const auto relativeVelAtImpact = (body->vel + cross(body->angularVel, r1)) - (other->vel + cross(other->angularVel, r2));
+			const auto approachSpeed = dot(relativeVelAtImpact, normal);
+			if (approachSpeed > 0.0f) {
+				const auto r1CrossNormal = cross(r1, normal);
+				const auto r2CrossNormal = cross(r2, normal);
+				const auto invEffectiveMass = body->invMass + other->invMass + body->invRotationalInertia * r1CrossNormal * r1CrossNormal + other->invRotationalInertia * r2CrossNormal * r2CrossNormal;
+				const auto impulse = normal * (approachSpeed / invEffectiveMass);
+				body->vel -= body->invMass * impulse;
+				body->angularVel -= body->invRotationalInertia * cross(r1, impulse);
+				other->vel += other->invMass * impulse;
+				other->angularVel += other->invRotationalInertia * cross(r2, impulse);
+				if (!other->isStatic()) {
+					other->wake();
+				}
+			}
+		}
+	}
+}
+
+// Stable counting sort of the constraints in [begin, end) by group. constraintGroups[i] is the group of constraints[begin + i]. Sets the range of every group to the part of [begin, end) it occupies. Keeping the order inside a group makes the result the same as solving the constraints of the group in their original order.
+template<typename Constraint>
+static auto sortConstraintsByGroup(
+	std::vector<SolverConstraint<Constraint>>& constraints,
+	i32 begin,
+	i32 end,
+	std::vector<SolverConstraint<Constraint>>& sorted,
+	const std::vector<i32>& constraintGroups,
+	std::span<SolverConstraintGroup> groups,
+	SolverConstraintGroup::Range SolverConstraintGroup::* range) -> void {
+
+	for (auto& group : groups) {
+		group.*range = SolverConstraintGroup::Range{};
+	}
+	for (i32 i = begin; i < end; i++) {
+		(groups[constraintGroups[i - begin]].*range).end++;
+	}
+	i32 offset = begin;
+	for (auto& group : groups) {
+		auto& r = group.*range;
+		const auto count = r.end;
+		r.begin = offset;
+		r.end = offset;
+		offset += count;
+	}
+	sorted.resize(end - begin);
+	for (i32 i = begin; i < end; i++) {
+		auto& r = groups[constraintGroups[i - begin]].*range;
+		sorted[r.end - begin] = constraints[i];
+		r.end++;
+	}
+	std::copy(sorted.begin(), sorted.end(), constraints.begin() + begin);
+}
+
+auto PhysicsWorld::buildSolverIslands() -> void {
+	// The solverBodies were resized to fit all the body indices.
+	const auto bodyCount = solverBodies.size();
+	isStaticBody.resize(bodyCount);
+	islandParent.resize(bodyCount);
+	for (const auto& [id, body] : ent.body) {
+		isStaticBody[id.index()] = body.isStatic();
+		islandParent[id.index()] = id.index();
+	}
+
+	auto connect = [this](i32 a, i32 b) {
+		if (isStaticBody[a] || isStaticBody[b])
+			return;
+		const auto aRoot = findIslandRoot(a);
+		const auto bRoot = findIslandRoot(b);
+		if (aRoot != bRoot) {
+			islandParent[aRoot] = bRoot;
+		}
+	};
+	for (const auto& c : contactsToSolve) connect(c.bodyA, c.bodyB);
+	for (const auto& c : distanceJointsToSolve) connect(c.bodyA, c.bodyB);
+	for (const auto& c : revoluteJointsToSolve) connect(c.bodyA, c.bodyB);
+	for (const auto& c : springJointsToSolve) connect(c.bodyA, c.bodyB);
+
+	// The islands are numbered in the order they are first encountered so the numbering is deterministic.
+	islandIndexOfRoot.assign(bodyCount, -1);
+	solverIslands.clear();
+	auto islandOf = [this](i32 a, i32 b) -> i32 {
+		// At least one of the bodies is dynamic, because constraints between static and sleeping bodies aren't solved.
+		const auto dynamicBody = isStaticBody[a] ? b : a;
+		auto& island = islandIndexOfRoot[findIslandRoot(dynamicBody)];
+		if (island == -1) {
+			island = static_cast<i32>(solverIslands.size());
+			solverIslands.push_back(SolverConstraintGroup{});
+		}
+		return island;
+	};
+
+	auto sortByIsland = [&]<typename Constraint>(std::vector<SolverConstraint<Constraint>>& constraints, std::vector<SolverConstraint<Constraint>>& sorted, SolverConstraintGroup::Range SolverConstraintGroup::* range) {
+		constraintGroups.clear();
+		for (const auto& c : constraints) {
+			constraintGroups.push_back(islandOf(c.bodyA, c.bodyB));
+		}
+		sortConstraintsByGroup(constraints, 0, static_cast<i32>(constraints.size()), sorted, constraintGroups, std::span{ solverIslands }, range);
+	};
+	sortByIsland(contactsToSolve, contactsSortedByGroup, &SolverConstraintGroup::contacts);
+	sortByIsland(distanceJointsToSolve, distanceJointsSortedByGroup, &SolverConstraintGroup::distanceJoints);
+	sortByIsland(revoluteJointsToSolve, revoluteJointsSortedByGroup, &SolverConstraintGroup::revoluteJoints);
+	sortByIsland(springJointsToSolve, springJointsSortedByGroup, &SolverConstraintGroup::springJoints);
+
+	// Coloring small islands isn't worth it, because there are many of them to solve in parallel and the batches would be too small. On 1 thread nothing is solved in parallel, so not coloring keeps the results the same as the serial solver.
+	const auto colorIslands = graphColoring && jobSystem.threadCount() > 1;
+	uncoloredIslands.clear();
+	coloredIslands.clear();
+	islandColors.clear();
+	for (i32 i = 0; i < static_cast<i32>(solverIslands.size()); i++) {
+		if (colorIslands && solverIslands[i].size() >= GRAPH_COLORING_MIN_CONSTRAINTS) {
+			coloredIslands.push_back(ColoredIsland{ .island = i, .firstColor = static_cast<i32>(islandColors.size()) });
+			islandColors.resize(islandColors.size() + PhysicsProfile::MAX_GRAPH_COLORS + 1);
+		} else {
+			uncoloredIslands.push_back(i);
+		}
+	}
+
+	// Copy the bodies of each island next to each other and make the constraints point to the copies.
+	islandSolverBodies.clear();
+	islandSolverBodyIndices.clear();
+	bodyIslandSlot.resize(bodyCount);
+	bodyIslandSlotIsland.assign(bodyCount, -1);
+	auto addSlot = [this](i32 bodyIndex) -> i32 {
+		islandSolverBodies.push_back(solverBodies[bodyIndex]);
+		islandSolverBodyIndices.push_back(bodyIndex);
+		return static_cast<i32>(islandSolverBodies.size()) - 1;
+	};
+	auto slot = [&](i32 island, i32 bodyIndex) -> i32 {
+		if (bodyIslandSlotIsland[bodyIndex] != island) {
+			bodyIslandSlotIsland[bodyIndex] = island;
+			bodyIslandSlot[bodyIndex] = addSlot(bodyIndex);
+		}
+		return bodyIslandSlot[bodyIndex];
+	};
+	// In a colored island constraints from the same color can touch the same static body at the same time, so every constraint gets it's own copy of the static bodies. This also makes the coloring ignore the static bodies.
+	auto coloredSlot = [&](i32 island, i32 bodyIndex) -> i32 {
+		return isStaticBody[bodyIndex] ? addSlot(bodyIndex) : slot(island, bodyIndex);
+	};
+	auto assignSlots = [&]<typename Constraint>(i32 island, bool colored, std::vector<SolverConstraint<Constraint>>& constraints, SolverConstraintGroup::Range range) {
+		for (i32 i = range.begin; i < range.end; i++) {
+			auto& c = constraints[i];
+			c.bodyA = colored ? coloredSlot(island, c.bodyA) : slot(island, c.bodyA);
+			c.bodyB = colored ? coloredSlot(island, c.bodyB) : slot(island, c.bodyB);
+		}
+	};
+	auto assignIslandSlots = [&](i32 i, bool colored) {
+		const auto& island = solverIslands[i];
+		assignSlots(i, colored, contactsToSolve, island.contacts);
+		assignSlots(i, colored, distanceJointsToSolve, island.distanceJoints);
+		assignSlots(i, colored, revoluteJointsToSolve, island.revoluteJoints);
+		assignSlots(i, colored, springJointsToSolve, island.springJoints);
+	};
+	for (const auto island : uncoloredIslands) {
+		assignIslandSlots(island, false);
+	}
+	for (const auto& colored : coloredIslands) {
+		assignIslandSlots(colored.island, true);
+	}
+
+	slotUsedColors.assign(islandSolverBodies.size(), 0);
+	for (i32 i = 0; i < static_cast<i32>(coloredIslands.size()); i++) {
+		colorIsland(i);
+	}
+}
+
+auto PhysicsWorld::colorIsland(i32 coloredIslandIndex) -> void {
+	const auto& colored = coloredIslands[coloredIslandIndex];
+	const auto& island = solverIslands[colored.island];
+	const auto colors = std::span{ islandColors }.subspan(colored.firstColor, PhysicsProfile::MAX_GRAPH_COLORS + 1);
+
+	// Greedy coloring. Every constraint gets the lowest color not used by any of its bodies yet. Going over the constraints in order makes it deterministic. The constraints for which all colors are used go into the overflow group at the end.
+	auto colorConstraints = [&]<typename Constraint>(std::vector<SolverConstraint<Constraint>>& constraints, std::vector<SolverConstraint<Constraint>>& sorted, SolverConstraintGroup::Range SolverConstraintGroup::* range) {
+		const auto r = island.*range;
+		constraintGroups.clear();
+		for (i32 i = r.begin; i < r.end; i++) {
+			const auto& c = constraints[i];
+			const auto usedColors = slotUsedColors[c.bodyA] | slotUsedColors[c.bodyB];
+			const auto color = std::min(std::countr_zero(~usedColors), PhysicsProfile::MAX_GRAPH_COLORS);
+			if (color != PhysicsProfile::MAX_GRAPH_COLORS) {
+				slotUsedColors[c.bodyA] |= 1u << color;
+				slotUsedColors[c.bodyB] |= 1u << color;
+			}
+			constraintGroups.push_back(color);
+		}
+		sortConstraintsByGroup(constraints, r.begin, r.end, sorted, constraintGroups, colors, range);
+	};
+	colorConstraints(contactsToSolve, contactsSortedByGroup, &SolverConstraintGroup::contacts);
+	colorConstraints(distanceJointsToSolve, distanceJointsSortedByGroup, &SolverConstraintGroup::distanceJoints);
+	colorConstraints(revoluteJointsToSolve, revoluteJointsSortedByGroup, &SolverConstraintGroup::revoluteJoints);
+	colorConstraints(springJointsToSolve, springJointsSortedByGroup, &SolverConstraintGroup::springJoints);
+}
+
+auto PhysicsWorld::solveGroupConstraints(const SolverConstraintGroup& group, i32 begin, i32 end) -> void {
+	// Moves [begin, end) to the start of the next array after each array.
+	auto solve = [&](auto& constraints, SolverConstraintGroup::Range range, auto applyImpulse) {
+		const auto first = range.begin + std::max(begin, 0);
+		const auto last = range.begin + std::min(end, range.size());
+		for (i32 i = first; i < last; i++) {
+			const auto& [constraint, a, b] = constraints[i];
+			applyImpulse(*constraint, islandSolverBodies[a], islandSolverBodies[b]);
+		}
+		begin -= range.size();
+		end -= range.size();
+	};
+	solve(contactsToSolve, group.contacts, [](Collision& c, SolverBody& a, SolverBody& b) { c.applyImpulse(a, b); });
+	solve(distanceJointsToSolve, group.distanceJoints, [](DistanceJoint& j, SolverBody& a, SolverBody& b) { j.applyImpluse(a, b); });
+	solve(revoluteJointsToSolve, group.revoluteJoints, [](RevoluteJoint& j, SolverBody& a, SolverBody& b) { j.applyImpluse(a, b); });
+	solve(springJointsToSolve, group.springJoints, [](SpringJoint& j, SolverBody& a, SolverBody& b) { j.applyImpluse(a, b); });
+}
+
+auto PhysicsWorld::wakeBodiesAffectedByChanges() -> void {
+	auto wake = [](BodyId id) {
+		if (auto body = ent.body.get(id); body.has_value() && body->isSleeping()) {
+			body->wake();
+		}
+	};
+
+	// The bodies resting on a removed body have to fall.
+	for (const auto& [key, _] : contacts) {
+		if (!ent.body.isAlive(key.a) || !ent.body.isAlive(key.b)) {
+			wake(key.a);
+			wake(key.b);
+		}
+	}
+
+	for (const auto& id : ent.distanceJoint.entitiesAddedLastFrame()) {
+		if (const auto joint = ent.distanceJoint.get(id); joint.has_value()) {
+			wake(joint->bodyA);
+			wake(joint->bodyB);
+		}
+	}
+	for (const auto& id : ent.revoluteJoint.entitiesAddedLastFrame()) {
+		if (const auto joint = ent.revoluteJoint.get(id); joint.has_value()) {
+			wake(joint->bodyA);
+			wake(joint->bodyB);
+		}
+	}
+	for (const auto& id : ent.springJoint.entitiesAddedLastFrame()) {
+		if (const auto joint = ent.springJoint.get(id); joint.has_value()) {
+			wake(joint->bodyA);
+			wake(joint->bodyB);
+		}
+	}
+}
+
+auto PhysicsWorld::updateSleeping(float dt) -> void {
+	if (!sleepingEnabled) {
+		for (const auto& [_, body] : ent.body) {
+			body.wake();
+		}
+		return;
+	}
+
+	// Union-find over the dynamic bodies. Static bodies don't connect islands, because they aren't affected by the bodies touching them. Only the index of the root has a meaning and it is used to index the other island arrays.
+	islandParent.resize(solverBodies.size());
+	for (const auto& [id, _] : ent.body) {
+		islandParent[id.index()] = id.index();
+	}
+	auto connect = [this](BodyId aId, BodyId bId) {
+		const auto a = ent.body.get(aId);
+		const auto b = ent.body.get(bId);
+		if (!a.has_value() || !b.has_value() || a->isStatic() || b->isStatic())
+			return;
+		const auto aRoot = findIslandRoot(aId.index());
+		const auto bRoot = findIslandRoot(bId.index());
+		if (aRoot != bRoot) {
+			islandParent[aRoot] = bRoot;
+		}
+	};
+	for (const auto& [key, _] : contacts) {
+		connect(key.a, key.b);
+	}
+	for (const auto& [_, joint] : ent.distanceJoint) {
+		connect(joint.bodyA, joint.bodyB);
+	}
+	for (const auto& [_, joint] : ent.revoluteJoint) {
+		connect(joint.bodyA, joint.bodyB);
+	}
+	for (const auto& [_, joint] : ent.springJoint) {
+		connect(joint.bodyA, joint.bodyB);
+	}
+
+	// Box2D uses the same thresholds.
+	static constexpr float LINEAR_SLEEP_TOLERANCE = 0.01f;
+	static constexpr float ANGULAR_SLEEP_TOLERANCE = 2.0f / 180.0f * PI<float>;
+	static constexpr float TIME_TO_SLEEP = 0.5f;
+
+	islandMinSleepTime.resize(solverBodies.size());
+	islandHasAwakeBodies.resize(solverBodies.size());
+	islandHasSleepingBodies.resize(solverBodies.size());
+	for (const auto& [id, _] : ent.body) {
+		islandMinSleepTime[id.index()] = std::numeric_limits<float>::infinity();
+		islandHasAwakeBodies[id.index()] = false;
+		islandHasSleepingBodies[id.index()] = false;
+	}
+
+	for (const auto& [id, body] : ent.body) {
+		if (body.isStatic())
+			continue;
+
+		const auto root = findIslandRoot(id.index());
+		if (body.isSleeping()) {
+			islandHasSleepingBodies[root] = true;
+			continue;
+		}
+
+		islandHasAwakeBodies[root] = true;
+		if (body.vel.lengthSq() > LINEAR_SLEEP_TOLERANCE * LINEAR_SLEEP_TOLERANCE || body.angularVel * body.angularVel > ANGULAR_SLEEP_TOLERANCE * ANGULAR_SLEEP_TOLERANCE) {
+			body.sleepTime = 0.0f;
+		} else {
+			body.sleepTime += dt;
+		}
+		islandMinSleepTime[root] = std::min(islandMinSleepTime[root], body.sleepTime);
+	}
+
+	// A motor keeps adding energy so the island would be put to sleep while it is still being driven. Static bodies aren't connected to islands, so when one of the bodies is static the other one is in an island of its own and both islands are kept awake.
+	for (const auto& [_, joint] : ent.revoluteJoint) {
+		if (joint.motorSpeedInRadiansPerSecond == 0.0f)
+			continue;
+		for (const auto bodyId : { joint.bodyA, joint.bodyB }) {
+			const auto body = ent.body.get(bodyId);
+			if (body.has_value() && !body->isStatic()) {
+				islandMinSleepTime[findIslandRoot(bodyId.index())] = 0.0f;
+			}
+		}
+	}
+
+	for (const auto& [id, body] : ent.body) {
+		if (body.isStatic())
+			continue;
+
+		const auto root = findIslandRoot(id.index());
+		// Islands that are fully sleeping stay asleep.
+		if (!islandHasAwakeBodies[root])
+			continue;
+
+		// Something woke a part of the island so the whole island has to be woken up.
+		if (islandHasSleepingBodies[root]) {
+			body.wake();
+			continue;
+		}
+
+		if (islandMinSleepTime[root] >= TIME_TO_SLEEP) {
+			body.isAwake = false;
+			body.vel = Vec2{ 0.0f };
+			body.angularVel = 0.0f;
+		}
+	}
+}
+
+auto PhysicsWorld::findIslandRoot(i32 bodyIndex) -> i32 {
+	while (islandParent[bodyIndex] != bodyIndex) {
+		// Path halving.
+		islandParent[bodyIndex] = islandParent[islandParent[bodyIndex]];
+		bodyIndex = islandParent[bodyIndex];
+	}
+	return bodyIndex;
+}
+
+auto PhysicsWorld::setBroadphase(BroadphaseType type) -> void {
+	if (type == broadphaseType_)
+		return;
+	broadphaseType_ = type;
+	collisionSystem().reload();
+}
+
+auto PhysicsWorld::collisionSystem() -> Broadphase& {
+	switch (broadphaseType_) {
+	case BroadphaseType::BVH: return bvhCollisionSystem;
+	case BroadphaseType::SPATIAL_HASH: return spatialHashCollisionSystem;
+	case BroadphaseType::SWEEP_AND_PRUNE: return sweepAndPruneCollisionSystem;
+	}
+	ASSERT_NOT_REACHED();
+	return bvhCollisionSystem;
+}
+
+auto PhysicsWorld::reset() -> void {
+	collisionSystem().reset();
+	ent.reset();
+	contacts.clear();
+	gravity = Vec2{ 0.0f, -10.0f };
+}
+
+static auto colliderToLevelCollider(const Collider& collider) -> LevelCollider {
+	return std::visit(overloaded{
+		[](const CircleCollider& c) -> LevelCollider { return LevelCircle{ .radius = c.radius }; },
+		[](const BoxCollider& c) -> LevelCollider { return LevelBox{ .size = c.size }; },
+		[](const ConvexPolygon& c) -> LevelCollider { return LevelConvexPolygon{ .verts = std::vector<Vec2>(c.verts.begin(), c.verts.end()) }; },
+		[](const CompoundCollider& c) -> LevelCollider {
+			LevelCompound compound;
+			for (const auto& child : c.children) {
+				compound.children.push_back(LevelCompoundChild{ .pos = child.transform.pos, .orientation = child.transform.angle(), .collider = colliderToLevelCollider(child.collider) });
+			}
+			return compound;
+		},
+	}, collider);
+}
+
+static auto levelColliderToCollider(const LevelCollider& collider) -> Collider {
+	return std::visit(overloaded{
+		[](const LevelCircle& c) -> Collider { return CircleCollider{ .radius = c.radius }; },
+		[](const LevelBox& c) -> Collider { return BoxCollider{ .size = c.size }; },
+		[](const LevelConvexPolygon& c) -> Collider { 
+			ConvexPolygon polygon;
+			for (const auto& vert : c.verts) {
+				polygon.verts.push_back(vert);
+			}
+			polygon.calculateNormals();
+			return polygon;  
+		},
+		[](const LevelCompound& c) -> Collider {
+			CompoundCollider compound;
+			for (const auto& child : c.children) {
+				compound.children.push_back(CompoundChild{ Transform{ child.pos, child.orientation }, levelColliderToCollider(child.collider) });
+			}
+			return compound;
+		},
+	}, collider);
+}
+
+auto PhysicsWorld::saveLevel() const -> Level {
+	std::unordered_map<i32, i32> oldBodyIndexToNewIndex;
+
+	Level level;
+	level.gravity = gravity;
+
+	for (const auto& [id, body] : ent.body) {
+		// @Hack:
+		if (abs(body.transform.pos.x) > 2000.0f || abs(body.transform.pos.y) > 2000.0f) {
+			continue;
+		}
+		const auto newIndex = static_cast<i32>(level.bodies.size());
+		oldBodyIndexToNewIndex[id.index()] = newIndex;
+
+		// TODO: Maybe check if the convex polygon collider has zero verts.
+
+		level.bodies.push_back(LevelBody{
+			.pos = body.transform.pos,
+			.orientation = body.transform.angle(),
+			.vel = body.vel,
+			.angularVel = body.angularVel,
+			.mass = body.mass,
+			.rotationalInertia = body.rotationalInertia,
+			.coefficientOfFriction = body.coefficientOfFriction,
+			.collider = colliderToLevelCollider(body.collider),
+			.isBullet = body.isBullet,
+		});
+	}
+		
+	for (const auto& [id, joint] : ent.distanceJoint) {
+		level.distanceJoints.push_back(LevelDistanceJoint{
+			.bodyAIndex = oldBodyIndexToNewIndex[joint.bodyA.index()],
+			.bodyBIndex = oldBodyIndexToNewIndex[joint.bodyB.index()],
+			.distance = joint.requiredDistance,
+			.anchorA = joint.anchorOnA,
+			.anchorB = joint.anchorOnB
+		});
+	}
+
+	for (const auto& joint : ent.revoluteJoint) {
+		level.revoluteJoints.push_back(LevelRevoluteJoint{
+			.bodyAIndex = oldBodyIndexToNewIndex[joint->bodyA.index()],
+			.bodyBIndex = oldBodyIndexToNewIndex[joint->bodyB.index()],
+			.anchorA = joint->localAnchorA,
+			.anchorB = joint->localAnchorB,
+			.motorSpeed = joint->motorSpeedInRadiansPerSecond,
+		});
+	}
+
+	for (const auto& [id, trail] : ent.trail) {
+		level.trails.push_back(LevelTrail{
+			.bodyIndex = oldBodyIndexToNewIndex[trail.body.index()],
+			.anchor = trail.anchor,
+			.color = trail.color,
+			.maxHistorySize = trail.maxHistorySize,
+		});
+	}
+
+	for (const auto& ignoredCollision : ent.collisionsToIgnore) {
+		level.ignoredCollisions.push_back(LevelIgnoredCollision{
+			.bodyAIndex = oldBodyIndexToNewIndex[ignoredCollision.a.index()],
+			.bodyBIndex = oldBodyIndexToNewIndex[ignoredCollision.b.index()],
+		});
+	}
+
+	return level;
+}
+
+auto PhysicsWorld::loadLevel(const Level& level) -> bool {
+	gravity = level.gravity;
+
+	for (const auto& levelBody : level.bodies) {
+		const auto& [_, body] = ent.body.create(Body{ levelBody.pos, levelColliderToCollider(levelBody.collider), false });
+		body.transform.rot = Rotation{ levelBody.orientation };
+		body.vel = levelBody.vel;
+		body.angularVel = levelBody.angularVel;
+		body.mass = levelBody.mass;
+		body.rotationalInertia = levelBody.rotationalInertia;
+		body.coefficientOfFriction = levelBody.coefficientOfFriction;
+		body.isBullet = levelBody.isBullet;
+		body.updateInvMassAndInertia();
+	}
+
+	for (const auto& levelJoint : level.distanceJoints) {
+		const auto bodyA = ent.body.validate(levelJoint.bodyAIndex);
+		const auto bodyB = ent.body.validate(levelJoint.bodyBIndex);
+		if (!bodyA.has_value() || !bodyB.has_value()) {
+			return false;
+		}
+		ent.distanceJoint.create(DistanceJoint{
+			.bodyA = *bodyA,
+			.bodyB = *bodyB,
+			.requiredDistance = levelJoint.distance,
+			.anchorOnA = levelJoint.anchorA,
+			.anchorOnB = levelJoint.anchorB,
+		});
+	}
+
+	for (const auto& levelJoint : level.revoluteJoints) {
+		const auto bodyA = ent.body.validate(levelJoint.bodyAIndex);
+		const auto bodyB = ent.body.validate(levelJoint.bodyBIndex);
+		if (!bodyA.has_value() || !bodyB.has_value()) {
+			return false;
+		}
+		ent.revoluteJoint.create(RevoluteJoint{
+			.bodyA = *bodyA,
+			.bodyB = *bodyB,
+			.localAnchorA = levelJoint.anchorA,
+			.localAnchorB = levelJoint.anchorB,
+			.motorSpeedInRadiansPerSecond = levelJoint.motorSpeed,
+		});
+	}
+
+	for (const auto& levelTrail : level.trails) {
+		const auto body = ent.body.validate(levelTrail.bodyIndex);
+		if (!body.has_value()) {
+			return false;
+		}
+		ent.trail.create(Trail{
+			.body = *body,
+			.anchor = levelTrail.anchor,
+			.color = levelTrail.color,
+			.maxHistorySize = levelTrail.maxHistorySize,
+		});
+	}
+
+	for (const auto& ignoredCollision : level.ignoredCollisions) {
+		const auto bodyA = ent.body.validate(ignoredCollision.bodyAIndex);
+		const auto bodyB = ent.body.validate(ignoredCollision.bodyBIndex);
+		if (!bodyA.has_value() || !bodyB.has_value()) {
+			return false;
+		}
+		ent.collisionsToIgnore.insert({ *bodyA, *bodyB });
+	}
+	return true;
+}
+
+auto PhysicsWorld::loadLevelFromFile(const char* path) -> std::optional<const char*> {
+	const std::ifstream file{ path, std::ios_base::binary };
+	if (file.fail()) {
+		return "failed to open file";
+	}
+
+	Level level;
+	try {
+		level = Level::fromJson(Json::parse(readFileToString(file)));
+	} catch (const Json::ParsingError&) {
+		return "failed to parse level";
+	} catch (const Json::JsonError&) {
+		return "failed to load level";
+	}
+
+	reset();
+	if (!loadLevel(level)) {
+		return "failed to load level";
+	}
+	afterLoad();
+	return std::nullopt;
+}
+
+auto PhysicsWorld::afterLoad() -> void {
+	// For the simulation to be deterministic and to make reloading demos deterministic this code needs to run before before the physics step. If it doesn't there is going to be one step in which collision isn't checked, because the bodies aren't registered in the collisionSystem and won't be untill the next frame, because then they will be accessible throught entitiesAddedThisFrame. So the bodies will get integrated without detecting collisions. 
+	// One way to make sure this works is to call ent.update after all the functions that create entites, but it seems simpler to just call it right after loading a level.
+	// Hopefully there aren't any errors in this logic.
+	ent.update();
+	collisionSystem().update();
+}
+
+bool PhysicsWorld::warmStarting = true;
+bool PhysicsWorld::accumulateImpulses = true;
+bool PhysicsWorld::sleepingEnabled = true;
+bool PhysicsWorld::graphColoring = true;
+bool PhysicsWorld::wideContactSolver = true;
+bool PhysicsWorld::continuousCollisionDetection = true;
+bool PhysicsWorld::speculativeContacts = true;
+bool PhysicsWorld::gjkNarrowphase = false;
+bool PhysicsWorld::satCache = true;
+bool PhysicsWorld::narrowphaseTimings = false;
+bool PhysicsWorld::bvhStatistics = false;
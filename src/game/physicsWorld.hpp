@@ -0,0 +1,160 @@
+#pragma once
+
+#include <game/bvhCollisionSystem.hpp>
+#include <game/spatialHashCollisionSystem.hpp>
+#include <game/sweepAndPruneCollisionSystem.hpp>
+#include <game/distanceJoint.hpp>
+#include <game/revoluteJoint.hpp>
+#include <game/springJoint.hpp>
+#include <utils/jobSystem.hpp>
+#include <game/physicsProfile.hpp>
+#include <game/levelFormat/levelData.hpp>
+#include <json/JsonValue.hpp>
+
+// The constraints with the indices of their bodies into the solver body array. Rebuilt in every step so the velocity iterations don't need to look up the bodies in ent.
+template<typename Constraint>
+struct SolverConstraint {
+	Constraint* constraint;
+	i32 bodyA;
+	i32 bodyB;
+};
+
+// Ranges in the constraint arrays of PhysicsWorld. Used for both the islands and the colors.
+struct SolverConstraintGroup {
+	struct Range {
+		i32 begin = 0;
+		i32 end = 0;
+
+		auto size() const -> i32 { return end - begin; }
+	};
+	Range contacts;
+	Range distanceJoints;
+	Range revoluteJoints;
+	Range springJoints;
+
+	auto size() const -> i32 { return contacts.size() + distanceJoints.size() + revoluteJoints.size() + springJoints.size(); }
+};
+
+// Everything needed to step the simulation. The entites themselves are stored in ent. Doesn't depend on the window, renderer, input or ImGui so it can also be used without the game, for example by the headless runner.
+class PhysicsWorld {
+public:
+	auto step(float dt, i32 solverIterations, PhysicsProfile& profile) -> void;
+	auto reset() -> void;
+
+	auto saveLevel() const -> Level;
+	// Expects the world to be empty. If the loading fails midway the entites loaded before the error are kept.
+	[[nodiscard]] auto loadLevel(const Level& level) -> bool;
+	// Resets the world and loads the level. Returns an error message on failure.
+	auto loadLevelFromFile(const char* path) -> std::optional<const char*>;
+	// Has to be called after creating the entites of a level or a demo. Registers the entites in the collision system so collisions are detected in the first step.
+	auto afterLoad() -> void;
+
+	CollisionMap contacts;
+	BvhCollisionSystem bvhCollisionSystem;
+	SpatialHashCollisionSystem spatialHashCollisionSystem;
+	SweepAndPruneCollisionSystem sweepAndPruneCollisionSystem;
+	enum class BroadphaseType {
+		BVH,
+		SPATIAL_HASH,
+		SWEEP_AND_PRUNE,
+	};
+	// Registers all the alive bodies in the new broadphase. The contacts are kept and all the broadphases find the same pairs so switching doesn't change the simulation.
+	auto setBroadphase(BroadphaseType type) -> void;
+	auto broadphaseType() const -> BroadphaseType { return broadphaseType_; }
+	auto collisionSystem() -> Broadphase&;
+
+	Vec2 gravity{ 0.0f };
+	float angularDamping = 0.98f;
+
+	// This is also called warm starting.
+	// The physics engine uses an iterative systems of equation solver which uses the Gauss-Seidel method. It starts with an initial guess and tries to get as close as possible to the analytical solution (if one exists else it gets it closer to satifying all equations). Enabling this makes it so the solver tries to improve convergence by expoliting temporal coherence between solutions. It uses the solution from the previous frame as the starting guess for the new frame.
+	/*static bool usePreviousStepImpulseSolutionsAsInitialGuess;*/
+	static bool warmStarting;
+	static bool positionCorrection;
+	static bool accumulateImpulses;
+	static bool sleepingEnabled;
+	// Splits large islands into colors of constraints that don't share dynamic bodies and solves every color in parallel. Without it a single big island, like a pyramid, is solved on one thread. Only used with more than 1 thread, because coloring changes the order in which the constraints are solved and so the results.
+	static bool graphColoring;
+	static constexpr i32 GRAPH_COLORING_MIN_CONSTRAINTS = 128;
+	// The number of constraints of a color solved by one job.
+	static constexpr i32 GRAPH_COLOR_BATCH_SIZE = 32;
+	// Solves the contacts of a graph color with SIMD, several contacts at a time. Gives the same results as the scalar solver. Only used for colored islands, because the contacts solved together can't share bodies. The islands are only colored with more than 1 thread, so with 1 thread this does nothing.
+	static bool wideContactSolver;
+	// Contacts are also created between bodies that aren't touching yet, but could touch by the end of the step. The solver only removes the velocity that would make them overlap, so the bodies don't pass through each other even without substepping. Can make bodies stop slightly before touching, for example when they move towards an edge they would miss.
+	static bool speculativeContacts;
+	// Stops fast bodies from passing through thin bodies without making every body take smaller steps. Only the fast bodies and the bullets are moved in substeps, up to their times of impact. See Body::isBullet.
+	static bool continuousCollisionDetection;
+	// Uses collideGjk for all the pairs instead of the kernels for each pair of collider types.
+	static bool gjkNarrowphase;
+	// Stores the reference face chosen by SAT in the collisions and starts from it in the next step, see SatCache.
+	static bool satCache;
+	// Measures the time of every narrowphase pair, see PhysicsProfile::narrowphaseMilliseconds.
+	static bool narrowphaseTimings;
+	// Computes PhysicsProfile::bvh every step, which iterates the whole tree. Also computed when BvhCollisionSystem::rebuildAreaRatio is enabled, because it decides when to rebuild using it.
+	static bool bvhStatistics;
+	static constexpr i32 CONTINUOUS_MAX_SUBSTEPS = 4;
+	// How far from the surface the bodies are stopped. Less than the penetration the contacts allow, so the contact found in the next step doesn't push the body back.
+	static constexpr float CONTINUOUS_TARGET_DISTANCE = 0.005f;
+	// The time of impact is only computed with the bodies hit by a circle of this fraction of the innerRadius moving with the center of the body.
+	static constexpr float CONTINUOUS_CORE_FRACTION = 0.5f;
+
+	// Used to solve the islands in parallel. With 1 thread the islands aren't colored, so the results are the same as solving everything on one thread without islands.
+	JobSystem jobSystem;
+
+private:
+	BroadphaseType broadphaseType_ = BroadphaseType::BVH;
+
+	auto wakeBodiesAffectedByChanges() -> void;
+	// Builds the islands of bodies connected by contacts and joints. An island is put to sleep when all of its bodies have been resting for long enough.
+	auto updateSleeping(float dt) -> void;
+	auto findIslandRoot(i32 bodyIndex) -> i32;
+	// Groups the constraints that share dynamic bodies into islands and copies the bodies of every island into islandSolverBodies. Large islands are also colored if graphColoring is enabled and there is more than 1 thread.
+	auto buildSolverIslands() -> void;
+	// Assigns the constraints of the island to colors so that no two constraints of a color share a body. Has to be called after the constraints point into islandSolverBodies.
+	auto colorIsland(i32 island) -> void;
+	// Moves the bodies in continuousBodies to their positions at the end of the step, stopping at the first hit in every substep. Has to be called after the other bodies were integrated.
+	auto integrateContinuousBodies(float dt, PhysicsProfile& profile) -> void;
+	std::vector<BodyId> continuousBodies;
+	std::vector<BodyId> continuousCandidates;
+	// Solves the constraints with indices in [begin, end) of the contacts, distance joints, revolute joints and spring joints of the group concatenated.
+	auto solveGroupConstraints(const SolverConstraintGroup& group, i32 begin, i32 end) -> void;
+
+	std::vector<SolverConstraint<Collision>> contactsToSolve;
+	std::vector<SolverConstraint<DistanceJoint>> distanceJointsToSolve;
+	std::vector<SolverConstraint<RevoluteJoint>> revoluteJointsToSolve;
+	std::vector<SolverConstraint<SpringJoint>> springJointsToSolve;
+	std::vector<SolverBody> solverBodies;
+
+	std::vector<SolverConstraintGroup> solverIslands;
+	// The bodies of the islands stored next to each other. The static bodies are copied into every island that uses them. The indices in the constraints point into this array after buildSolverIslands.
+	std::vector<SolverBody> islandSolverBodies;
+	// The body index of each element of islandSolverBodies.
+	std::vector<i32> islandSolverBodyIndices;
+	std::vector<i32> uncoloredIslands;
+	struct ColoredIsland {
+		i32 island;
+		// Index of the first of the PhysicsProfile::MAX_GRAPH_COLORS + 1 groups in islandColors. The last group is the overflow.
+		i32 firstColor;
+	};
+	std::vector<ColoredIsland> coloredIslands;
+	// The constraint ranges of a colored island are sorted by color and these are the subranges.
+	std::vector<SolverConstraintGroup> islandColors;
+
+	// Temporary arrays used by buildSolverIslands. Stored so they don't need to be reallocated every step.
+	std::vector<bool> isStaticBody;
+	std::vector<i32> islandIndexOfRoot;
+	std::vector<i32> constraintGroups;
+	std::vector<i32> bodyIslandSlot;
+	std::vector<i32> bodyIslandSlotIsland;
+	std::vector<u32> slotUsedColors;
+	std::vector<SolverConstraint<Collision>> contactsSortedByGroup;
+	std::vector<SolverConstraint<DistanceJoint>> distanceJointsSortedByGroup;
+	std::vector<SolverConstraint<RevoluteJoint>> revoluteJointsSortedByGroup;
+	std::vector<SolverConstraint<SpringJoint>> springJointsSortedByGroup;
+
+	// Indexed by body index.
+	std::vector<i32> islandParent;
+	std::vector<float> islandMinSleepTime;
+	std::vector<bool> islandHasAwakeBodies;
+	std::vector<bool> islandHasSleepingBodies;
+};
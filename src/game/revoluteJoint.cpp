@@ -9,8 +9,9 @@ auto RevoluteJoint::preStep(float invDeltaTime) -> void {
 		ent.revoluteJoint.destroy(*this);
 		return;
 	}
-	const auto rA = localAnchorA * a->transform.rot;
-	const auto rB = localAnchorB * b->transform.rot;
+	rA = localAnchorA * a->transform.rot;
+	rB = localAnchorB * b->transform.rot;
+	error = (b->transform.pos + rB) - (a->transform.pos + rA);
 	if (a->isStatic() && b->isStatic()) {
 		// Without this it creates a zero matrix. 
 		m = Mat2::identity;
@@ -23,30 +24,21 @@ auto RevoluteJoint::preStep(float invDeltaTime) -> void {
 	
 }
 
-auto RevoluteJoint::applyImpluse() -> void {
-	auto a = ent.body.get(bodyA);
-	auto b = ent.body.get(bodyB);
-	if (!a.has_value() || !b.has_value()) {
-		return;
-	}
-
-	const auto rA = localAnchorA * a->transform.rot;
-	const auto rB = localAnchorB * b->transform.rot;
-	const auto relativeVel = (b->vel + cross(b->angularVel, rB)) - (a->vel + cross(a->angularVel, rA));
-	const auto error = (b->transform.pos + rB) - (a->transform.pos + rA);
+auto RevoluteJoint::applyImpluse(SolverBody& a, SolverBody& b) -> void {
+	const auto relativeVel = (b.vel + cross(b.angularVel, rB)) - (a.vel + cross(a.angularVel, rA));
 	const auto impulse = -(relativeVel + error * bias * 0.2f) * m;
 
-	a->vel -= a->invMass * impulse;
-	a->angularVel -= a->invRotationalInertia * cross(rA, impulse);
-	b->vel += b->invMass * impulse;
-	b->angularVel += b->invRotationalInertia * cross(rB, impulse);
+	a.vel -= a.invMass * impulse;
+	a.angularVel -= a.invRotationalInertia * cross(rA, impulse);
+	b.vel += b.invMass * impulse;
+	b.angularVel += b.invRotationalInertia * cross(rB, impulse);
 
 	if (motorSpeedInRadiansPerSecond != 0.0f) {
-		const auto lambda = 1.0f / (a->invRotationalInertia + b->invRotationalInertia);
-		auto motorImpulse = (a->angularVel - b->angularVel + motorSpeedInRadiansPerSecond) * lambda;
+		const auto lambda = 1.0f / (a.invRotationalInertia + b.invRotationalInertia);
+		auto motorImpulse = (a.angularVel - b.angularVel + motorSpeedInRadiansPerSecond) * lambda;
 		motorImpulse = std::clamp(motorImpulse, -1000.0f, 1000.0f);
-		a->angularVel -= motorImpulse * a->invMass;
-		b->angularVel += motorImpulse * b->invMass;
+		a.angularVel -= motorImpulse * a.invMass;
+		b.angularVel += motorImpulse * b.invMass;
 	}
 }
 
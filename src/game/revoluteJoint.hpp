@@ -10,11 +10,14 @@ struct RevoluteJoint {
 	float bias;
 
 	auto preStep(float invDeltaTime) -> void;
-	auto applyImpluse() -> void;
+	auto applyImpluse(SolverBody& a, SolverBody& b) -> void;
 
 	auto anchorsWorldSpace() const -> std::array<Vec2, 2>;
 
 	Mat2 m;
+	// Computed in preStep from the transforms.
+	Vec2 rA, rB;
+	Vec2 error;
 };
 
 using RevoluteJointId = EntityArray<RevoluteJoint>::Id;
@@ -0,0 +1,312 @@
+#include <game/spatialHashCollisionSystem.hpp>
+#include <utils/timer.hpp>
+#include <algorithm>
+#include <bit>
+
+auto SpatialHashCollisionSystem::update() -> void {
+	const auto oldSize = proxies.size();
+	std::erase_if(proxies, [](const Proxy& proxy) { return !ent.body.isAlive(proxy.body); });
+
+	for (const auto bodyId : ent.body.entitiesAddedLastFrame()) {
+		addProxies(bodyId);
+	}
+
+	if (proxies.size() != oldSize || !ent.body.entitiesAddedLastFrame().empty()) {
+		proxiesChanged = true;
+		cellsOutdated = true;
+	}
+}
+
+auto SpatialHashCollisionSystem::reset() -> void {
+	proxies.clear();
+	proxiesChanged = true;
+	cellsOutdated = true;
+}
+
+auto SpatialHashCollisionSystem::reload() -> void {
+	reset();
+	for (const auto& id : bodiesToReload()) {
+		addProxies(id);
+	}
+	rebuildCells();
+}
+
+auto SpatialHashCollisionSystem::addProxies(BodyId bodyId) -> void {
+	const auto body = ent.body.get(bodyId);
+	if (!body.has_value()) {
+		ASSERT_NOT_REACHED();
+		return;
+	}
+	for (i32 shape = 0; shape < shapeCount(body->collider); shape++) {
+		proxies.push_back(Proxy{ bodyId, shape, fatAabb(*body, shape, 0.0f), false });
+	}
+}
+
+auto SpatialHashCollisionSystem::updateBvh(float dt, PhysicsProfile& profile) -> void {
+	for (auto& proxy : proxies) {
+		const auto body = ent.body.get(proxy.body);
+		if (!body.has_value()) {
+			ASSERT_NOT_REACHED();
+			continue;
+		}
+		if (body->isStatic() || body->isSleeping())
+			continue;
+
+		if (const auto updatedAabb = updatedFatAabb(*body, proxy.shape, proxy.aabb, dt, profile); updatedAabb.has_value()) {
+			proxy.aabb = *updatedAabb;
+			cellsOutdated = true;
+		}
+	}
+	if (cellSize > 0.0f && cellSize != usedCellSize) {
+		cellsOutdated = true;
+	}
+	if (cellsOutdated) {
+		rebuildCells();
+	}
+}
+
+auto SpatialHashCollisionSystem::detectCollisions(float dt, CollisionMap& collisions, const IgnoredCollisions& collisionsToIgnore, JobSystem& jobSystem, PhysicsProfile& profile) -> void {
+	if (cellsOutdated) {
+		rebuildCells();
+	}
+
+	Timer findPairsTimer;
+	beginFindingPairs(jobSystem);
+	// Most buckets are empty or have a single entry so they are processed in groups.
+	static constexpr i32 BUCKETS_PER_TASK = 256;
+	const auto bucketCount = static_cast<i32>(bucketStart.size()) - 1;
+	const auto bucketTasks = (bucketCount + BUCKETS_PER_TASK - 1) / BUCKETS_PER_TASK;
+	const auto oversizedCount = static_cast<i32>(oversizedProxies.size());
+	jobSystem.parallelFor(bucketTasks + oversizedCount, [&](i32 taskIndex, i32 threadIndex) {
+		if (taskIndex >= bucketTasks) {
+			collideOversized(oversizedProxies[taskIndex - bucketTasks], collisionsToIgnore, threadPairs[threadIndex]);
+			return;
+		}
+		const auto end = std::min((taskIndex + 1) * BUCKETS_PER_TASK, bucketCount);
+		for (i32 i = taskIndex * BUCKETS_PER_TASK; i < end; i++) {
+			collideBucket(static_cast<u32>(i), collisionsToIgnore, threadPairs[threadIndex]);
+		}
+	});
+	endFindingPairs();
+	profile.collideFindPairs = findPairsTimer.elapsedMilliseconds();
+
+	collidePairs(dt, collisions, jobSystem, profile);
+}
+
+auto SpatialHashCollisionSystem::visitRay(Vec2 start, Vec2 end, Vec2 halfSize, const RayVisitor& visitor) const -> void {
+	const auto dir = end - start;
+	const Vec2 invDir{ 1.0f / dir.x, 1.0f / dir.y };
+	auto maxT = 1.0f;
+	auto visitProxy = [&](const Proxy& proxy) {
+		if (Aabb{ proxy.aabb.min - halfSize, proxy.aabb.max + halfSize }.rayEntryT(start, invDir, maxT) <= maxT) {
+			maxT = std::min(maxT, visitor(proxy.body, proxy.shape));
+		}
+	};
+	for (const auto proxyIndex : oversizedProxies) {
+		visitProxy(proxies[proxyIndex]);
+	}
+	if (bucketStart.size() <= 1)
+		return;
+
+	if (halfSize != Vec2{ 0.0f }) {
+		// The extended aabbs can be in the cells next to the ones the ray crosses so all the cells overlapping the swept aabb are visited.
+		const auto swept = Aabb{ start.min(end) - halfSize, start.max(end) + halfSize };
+		forEachEntryOverlapping(swept, [&](const CellEntry& entry) {
+			visitProxy(proxies[entry.proxy]);
+		});
+		return;
+	}
+
+	// Amanatides and Woo grid traversal. The cells are visited in the order the ray crosses them so the traversal can stop as soon as there is a hit before the end of the current cell.
+	auto x = cellCoordinate(start.x);
+	auto y = cellCoordinate(start.y);
+	const auto endX = cellCoordinate(end.x);
+	const auto endY = cellCoordinate(end.y);
+	const auto stepX = dir.x > 0.0f ? 1 : -1;
+	const auto stepY = dir.y > 0.0f ? 1 : -1;
+	const auto infinity = std::numeric_limits<float>::infinity();
+	// The t at which the ray crosses the next vertical and horizontal cell boundary.
+	auto tMaxX = dir.x == 0.0f ? infinity : ((x + (stepX > 0 ? 1 : 0)) * usedCellSize - start.x) / dir.x;
+	auto tMaxY = dir.y == 0.0f ? infinity : ((y + (stepY > 0 ? 1 : 0)) * usedCellSize - start.y) / dir.y;
+	const auto tDeltaX = dir.x == 0.0f ? infinity : usedCellSize / std::abs(dir.x);
+	const auto tDeltaY = dir.y == 0.0f ? infinity : usedCellSize / std::abs(dir.y);
+	// Limits the number of steps in case the rounding makes the traversal miss the end cell.
+	auto cellsLeft = std::abs(static_cast<i64>(endX) - x) + std::abs(static_cast<i64>(endY) - y) + 1;
+	while (cellsLeft > 0) {
+		const auto cellBucket = bucket(x, y);
+		for (auto i = bucketStart[cellBucket]; i < bucketStart[cellBucket + 1]; i++) {
+			const auto& entry = cellEntries[i];
+			if (entry.x == x && entry.y == y) {
+				visitProxy(proxies[entry.proxy]);
+			}
+		}
+		if (maxT <= std::min(tMaxX, tMaxY))
+			break;
+		if (tMaxX < tMaxY) {
+			x += stepX;
+			tMaxX += tDeltaX;
+		} else {
+			y += stepY;
+			tMaxY += tDeltaY;
+		}
+		cellsLeft--;
+	}
+}
+
+auto SpatialHashCollisionSystem::visitAabb(const Aabb& aabb, const std::function<void(BodyId body, i32 shape)>& visitor) const -> void {
+	for (const auto proxyIndex : oversizedProxies) {
+		if (proxies[proxyIndex].aabb.collides(aabb)) {
+			visitor(proxies[proxyIndex].body, proxies[proxyIndex].shape);
+		}
+	}
+	if (bucketStart.size() <= 1)
+		return;
+
+	const auto minX = cellCoordinate(aabb.min.x);
+	const auto minY = cellCoordinate(aabb.min.y);
+	forEachEntryOverlapping(aabb, [&](const CellEntry& entry) {
+		const auto& proxy = proxies[entry.proxy];
+		if (!proxy.aabb.collides(aabb))
+			return;
+		// Like in collideBucket the proxy is only visited in the first cell it shares with the aabb.
+		if (entry.x != std::max(cellCoordinate(proxy.aabb.min.x), minX) || entry.y != std::max(cellCoordinate(proxy.aabb.min.y), minY))
+			return;
+		visitor(proxy.body, proxy.shape);
+	});
+}
+
+auto SpatialHashCollisionSystem::forEachEntryOverlapping(const Aabb& aabb, const std::function<void(const CellEntry& entry)>& function) const -> void {
+	const auto minX = cellCoordinate(aabb.min.x);
+	const auto minY = cellCoordinate(aabb.min.y);
+	const auto maxX = cellCoordinate(aabb.max.x);
+	const auto maxY = cellCoordinate(aabb.max.y);
+	const auto cellCount = (static_cast<i64>(maxX) - minX + 1) * (static_cast<i64>(maxY) - minY + 1);
+	// Looking up more cells than there are entries is slower than going over all of them.
+	if (cellCount > static_cast<i64>(cellEntries.size())) {
+		for (const auto& entry : cellEntries) {
+			if (entry.x >= minX && entry.x <= maxX && entry.y >= minY && entry.y <= maxY) {
+				function(entry);
+			}
+		}
+		return;
+	}
+	for (auto y = minY; y <= maxY; y++) {
+		for (auto x = minX; x <= maxX; x++) {
+			const auto cellBucket = bucket(x, y);
+			for (auto i = bucketStart[cellBucket]; i < bucketStart[cellBucket + 1]; i++) {
+				const auto& entry = cellEntries[i];
+				if (entry.x == x && entry.y == y) {
+					function(entry);
+				}
+			}
+		}
+	}
+}
+
+auto SpatialHashCollisionSystem::rebuildCells() -> void {
+	cellsOutdated = false;
+	if (cellSize > 0.0f) {
+		usedCellSize = cellSize;
+	} else if (proxiesChanged) {
+		proxiesChanged = false;
+		if (!proxies.empty()) {
+			proxySizes.clear();
+			for (const auto& proxy : proxies) {
+				const auto size = proxy.aabb.size();
+				proxySizes.push_back(std::max(size.x, size.y));
+			}
+			const auto median = proxySizes.begin() + proxySizes.size() / 2;
+			std::nth_element(proxySizes.begin(), median, proxySizes.end());
+			// The margins of the aabbs are proportional to the sizes of the bodies so the median body covers a smaller part of a bigger cell. Without the factor the big bodies in scenes with mostly small ones covered more than MAX_CELLS_PER_BODY cells.
+			usedCellSize = std::max(*median * 1.5f, 0.01f);
+		}
+	}
+
+	unsortedCellEntries.clear();
+	oversizedProxies.clear();
+	for (usize i = 0; i < proxies.size(); i++) {
+		auto& proxy = proxies[i];
+		const auto minX = cellCoordinate(proxy.aabb.min.x);
+		const auto minY = cellCoordinate(proxy.aabb.min.y);
+		const auto maxX = cellCoordinate(proxy.aabb.max.x);
+		const auto maxY = cellCoordinate(proxy.aabb.max.y);
+		const auto cellCount = (static_cast<i64>(maxX) - minX + 1) * (static_cast<i64>(maxY) - minY + 1);
+		proxy.oversized = cellCount > MAX_CELLS_PER_BODY;
+		if (proxy.oversized) {
+			oversizedProxies.push_back(static_cast<u32>(i));
+			continue;
+		}
+		for (auto y = minY; y <= maxY; y++) {
+			for (auto x = minX; x <= maxX; x++) {
+				unsortedCellEntries.push_back(CellEntry{ x, y, static_cast<u32>(i) });
+			}
+		}
+	}
+
+	// Twice as many buckets as entries keeps the number of cells sharing a bucket low.
+	const auto bucketCount = std::bit_ceil(std::max(unsortedCellEntries.size() * 2, usize(16)));
+	bucketStart.assign(bucketCount + 1, 0);
+	unsortedCellEntryBuckets.clear();
+	for (const auto& entry : unsortedCellEntries) {
+		const auto entryBucket = bucket(entry.x, entry.y);
+		unsortedCellEntryBuckets.push_back(entryBucket);
+		bucketStart[entryBucket + 1]++;
+	}
+	for (usize i = 1; i < bucketStart.size(); i++) {
+		bucketStart[i] += bucketStart[i - 1];
+	}
+	// The entries are written in order so inside a bucket they stay sorted by the proxy index.
+	cellEntries.resize(unsortedCellEntries.size());
+	for (usize i = 0; i < unsortedCellEntries.size(); i++) {
+		cellEntries[bucketStart[unsortedCellEntryBuckets[i]]++] = unsortedCellEntries[i];
+	}
+	// The loop above moved every start to the start of the next bucket.
+	for (usize i = bucketStart.size() - 1; i > 0; i--) {
+		bucketStart[i] = bucketStart[i - 1];
+	}
+	bucketStart[0] = 0;
+}
+
+auto SpatialHashCollisionSystem::cellCoordinate(float value) const -> i32 {
+	return static_cast<i32>(floor(value / usedCellSize));
+}
+
+auto SpatialHashCollisionSystem::bucket(i32 x, i32 y) const -> u32 {
+	return static_cast<u32>(hashPair(static_cast<u32>(x), static_cast<u32>(y)) & (bucketStart.size() - 2));
+}
+
+auto SpatialHashCollisionSystem::collideBucket(u32 bucket, const IgnoredCollisions& collisionsToIgnore, std::vector<PotentialPair>& pairs) const -> void {
+	const auto begin = bucketStart[bucket];
+	const auto end = bucketStart[bucket + 1];
+	for (auto i = begin; i < end; i++) {
+		const auto& a = cellEntries[i];
+		const auto& aProxy = proxies[a.proxy];
+		for (auto j = i + 1; j < end; j++) {
+			const auto& b = cellEntries[j];
+			// A different cell with the same bucket.
+			if (a.x != b.x || a.y != b.y)
+				continue;
+			const auto& bProxy = proxies[b.proxy];
+			if (!aProxy.aabb.collides(bProxy.aabb))
+				continue;
+			if (cellCoordinate(std::max(aProxy.aabb.min.x, bProxy.aabb.min.x)) != a.x || cellCoordinate(std::max(aProxy.aabb.min.y, bProxy.aabb.min.y)) != a.y)
+				continue;
+			addPotentialPair(aProxy.body, aProxy.shape, bProxy.body, bProxy.shape, collisionsToIgnore, pairs);
+		}
+	}
+}
+
+auto SpatialHashCollisionSystem::collideOversized(u32 proxy, const IgnoredCollisions& collisionsToIgnore, std::vector<PotentialPair>& pairs) const -> void {
+	const auto& oversized = proxies[proxy];
+	for (usize i = 0; i < proxies.size(); i++) {
+		const auto& other = proxies[i];
+		// Pairs of oversized proxies are reported by the one with the lower index.
+		if (other.oversized && i <= proxy)
+			continue;
+		if (oversized.aabb.collides(other.aabb)) {
+			addPotentialPair(oversized.body, oversized.shape, other.body, other.shape, collisionsToIgnore, pairs);
+		}
+	}
+}
+
+float SpatialHashCollisionSystem::cellSize = 0.0f;
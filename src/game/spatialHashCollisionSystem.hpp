@@ -0,0 +1,59 @@
+#pragma once
+
+#include <game/broadphase.hpp>
+
+// Puts the aabbs into the cells of a uniform grid, which are stored in a hash table so the grid doesn't need bounds. Only the bodies in the same cell are tested against each other. Works best when the bodies have similar sizes, like in particle simulations, because then every body covers at most 4 cells and there is no tree to traverse or keep balanced.
+// The table is rebuilt from scratch with a counting sort whenever an aabb changes, which is O(n).
+class SpatialHashCollisionSystem : public Broadphase {
+public:
+	auto update() -> void override;
+	auto reset() -> void override;
+	auto reload() -> void override;
+	auto updateBvh(float dt, PhysicsProfile& profile) -> void override;
+	auto detectCollisions(float dt, CollisionMap& collisions, const IgnoredCollisions& collisionsToIgnore, JobSystem& jobSystem, PhysicsProfile& profile) -> void override;
+
+	// Zero chooses 1.5 times the median size of the aabbs.
+	static float cellSize;
+	// Bodies covering more cells are tested against all the other bodies instead so huge bodies, like the ground, don't fill the table.
+	static constexpr i64 MAX_CELLS_PER_BODY = 64;
+
+protected:
+	// Walks the cells crossed by the ray. The queries don't see the bodies added after the last updateBvh.
+	auto visitRay(Vec2 start, Vec2 end, Vec2 halfSize, const RayVisitor& visitor) const -> void override;
+	auto visitAabb(const Aabb& aabb, const std::function<void(BodyId body, i32 shape)>& visitor) const -> void override;
+
+private:
+	struct Proxy {
+		BodyId body;
+		i32 shape;
+		Aabb aabb;
+		bool oversized;
+	};
+	std::vector<Proxy> proxies;
+
+	struct CellEntry {
+		i32 x;
+		i32 y;
+		u32 proxy;
+	};
+	auto rebuildCells() -> void;
+	auto cellCoordinate(float value) const -> i32;
+	auto bucket(i32 x, i32 y) const -> u32;
+	// A pair of bodies can share multiple cells. It is only reported by the cell containing the minimum corner of the intersection of the aabbs.
+	auto collideBucket(u32 bucket, const IgnoredCollisions& collisionsToIgnore, std::vector<PotentialPair>& pairs) const -> void;
+	auto collideOversized(u32 proxy, const IgnoredCollisions& collisionsToIgnore, std::vector<PotentialPair>& pairs) const -> void;
+	auto forEachEntryOverlapping(const Aabb& aabb, const std::function<void(const CellEntry& entry)>& function) const -> void;
+
+	bool cellsOutdated = true;
+	bool proxiesChanged = true;
+	float usedCellSize = 1.0f;
+	std::vector<float> proxySizes;
+	std::vector<CellEntry> unsortedCellEntries;
+	std::vector<u32> unsortedCellEntryBuckets;
+	// The entries of bucket i are in [bucketStart[i], bucketStart[i + 1]). The bucket count is a power of 2.
+	std::vector<CellEntry> cellEntries;
+	std::vector<i32> bucketStart;
+	std::vector<u32> oversizedProxies;
+	// Adds a proxy for every shape of the body.
+	auto addProxies(BodyId bodyId) -> void;
+};
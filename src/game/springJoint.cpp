@@ -25,13 +25,7 @@ auto SpringJoint::preStep(float invDeltaTime) -> void {
 	b->vel -= normal * error * k / b->mass;
 }
 
-auto SpringJoint::applyImpluse() -> void {
-	auto a = ent.body.get(bodyA);
-	auto b = ent.body.get(bodyB);
-	if (!a.has_value() || !b.has_value()) {
-		return;
-	}
-
+auto SpringJoint::applyImpluse(SolverBody&, SolverBody&) -> void {
 	//const auto distanceAb = ::distance(a->transform.pos, b->transform.pos);
 	//const auto error = distanceAb - restLength;
 	//a->vel += (b->transform.pos - a->transform.pos) * error * invDt * 0.9f;
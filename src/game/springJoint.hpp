@@ -8,7 +8,7 @@ struct SpringJoint {
 	Vec2 localAnchorA{ 0.0f }, localAnchorB{ 0.0f };
 
 	auto preStep(float invDeltaTime) -> void;
-	auto applyImpluse() -> void;
+	auto applyImpluse(SolverBody& a, SolverBody& b) -> void;
 
 	float invDt;
 
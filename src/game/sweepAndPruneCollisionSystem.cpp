@@ -0,0 +1,274 @@
+#include <game/sweepAndPruneCollisionSystem.hpp>
+#include <utils/timer.hpp>
+#include <algorithm>
+
+auto SweepAndPruneCollisionSystem::update() -> void {
+	bool removedProxies = false;
+	for (u32 i = 0; i < proxies.size(); i++) {
+		auto& proxy = proxies[i];
+		if (proxy.used && !ent.body.isAlive(proxy.body)) {
+			proxy.used = false;
+			freeProxies.push_back(i);
+			removedProxies = true;
+		}
+	}
+	if (removedProxies) {
+		// Removing keeps the arrays sorted.
+		for (i32 axis = 0; axis < AXES; axis++) {
+			auto& axisEndpoints = endpoints[axis];
+			std::erase_if(axisEndpoints, [this](const Endpoint& e) { return !proxies[e.proxyAndIsMax & ~MAX_BIT].used; });
+			for (u32 i = 0; i < axisEndpoints.size(); i++) {
+				const auto& e = axisEndpoints[i];
+				proxies[e.proxyAndIsMax & ~MAX_BIT].endpoints[axis][(e.proxyAndIsMax & MAX_BIT) ? 1 : 0] = i;
+			}
+		}
+		std::erase_if(overlappingPairs, [](const ShapePair& pair) { return !ent.body.isAlive(pair.a) || !ent.body.isAlive(pair.b); });
+		pairsChanged = true;
+	}
+
+	newProxyCount = 0;
+	for (const auto bodyId : ent.body.entitiesAddedLastFrame()) {
+		addProxies(bodyId);
+	}
+	const auto usedProxyCount = static_cast<i32>(proxies.size() - freeProxies.size());
+	if (newProxyCount >= BULK_BUILD_MIN_NEW_BODIES && newProxyCount * 4 >= usedProxyCount) {
+		rebuild();
+	} else if (newProxyCount > 0) {
+		// The new ends are at the end of the arrays. Moving them into place adds their pairs.
+		for (i32 axis = 0; axis < AXES; axis++) {
+			sortEndpoints(axis);
+		}
+	}
+}
+
+auto SweepAndPruneCollisionSystem::reset() -> void {
+	proxies.clear();
+	freeProxies.clear();
+	for (auto& axisEndpoints : endpoints) {
+		axisEndpoints.clear();
+	}
+	overlappingPairs.clear();
+	sortedPairs.clear();
+	pairsChanged = true;
+	maxAabbWidth = 0.0f;
+}
+
+auto SweepAndPruneCollisionSystem::reload() -> void {
+	reset();
+	for (const auto& id : bodiesToReload()) {
+		addProxies(id);
+	}
+	rebuild();
+}
+
+auto SweepAndPruneCollisionSystem::updateBvh(float dt, PhysicsProfile& profile) -> void {
+	for (u32 i = 0; i < proxies.size(); i++) {
+		auto& proxy = proxies[i];
+		if (!proxy.used)
+			continue;
+		const auto body = ent.body.get(proxy.body);
+		if (!body.has_value()) {
+			ASSERT_NOT_REACHED();
+			continue;
+		}
+		if (body->isStatic() || body->isSleeping())
+			continue;
+
+		if (const auto updatedAabb = updatedFatAabb(*body, proxy.shape, proxy.aabb, dt, profile); updatedAabb.has_value()) {
+			proxy.aabb = *updatedAabb;
+			updateEndpointValues(i);
+		}
+	}
+	for (i32 axis = 0; axis < AXES; axis++) {
+		sortEndpoints(axis);
+	}
+}
+
+auto SweepAndPruneCollisionSystem::detectCollisions(float dt, CollisionMap& collisions, const IgnoredCollisions& collisionsToIgnore, JobSystem& jobSystem, PhysicsProfile& profile) -> void {
+	Timer findPairsTimer;
+	if (pairsChanged) {
+		pairsChanged = false;
+		sortedPairs.assign(overlappingPairs.begin(), overlappingPairs.end());
+		std::sort(sortedPairs.begin(), sortedPairs.end(), CollisionMap::lessThan);
+	}
+	// The pairs are already in the right order so they are added on one thread.
+	pairs.clear();
+	for (const auto& pair : sortedPairs) {
+		addPotentialPair(pair.a, pair.shapeA, pair.b, pair.shapeB, collisionsToIgnore, pairs);
+	}
+	profile.collideFindPairs = findPairsTimer.elapsedMilliseconds();
+
+	collidePairs(dt, collisions, jobSystem, profile);
+}
+
+auto SweepAndPruneCollisionSystem::visitRay(Vec2 start, Vec2 end, Vec2 halfSize, const RayVisitor& visitor) const -> void {
+	const auto dir = end - start;
+	const Vec2 invDir{ 1.0f / dir.x, 1.0f / dir.y };
+	auto maxT = 1.0f;
+	for (auto it = firstEndpointReaching(std::min(start.x, end.x) - halfSize.x); it != endpoints[0].end(); ++it) {
+		const auto& e = *it;
+		// The hits found so far shorten the part of the ray that can still be hit.
+		if (e.value > std::max(start.x, start.x + dir.x * maxT) + halfSize.x)
+			break;
+		if (e.proxyAndIsMax & MAX_BIT)
+			continue;
+		const auto& proxy = proxies[e.proxyAndIsMax];
+		if (Aabb{ proxy.aabb.min - halfSize, proxy.aabb.max + halfSize }.rayEntryT(start, invDir, maxT) <= maxT) {
+			maxT = std::min(maxT, visitor(proxy.body, proxy.shape));
+		}
+	}
+}
+
+auto SweepAndPruneCollisionSystem::visitAabb(const Aabb& aabb, const std::function<void(BodyId body, i32 shape)>& visitor) const -> void {
+	for (auto it = firstEndpointReaching(aabb.min.x); it != endpoints[0].end(); ++it) {
+		const auto& e = *it;
+		if (e.value > aabb.max.x)
+			break;
+		if (e.proxyAndIsMax & MAX_BIT)
+			continue;
+		const auto& proxy = proxies[e.proxyAndIsMax];
+		if (proxy.aabb.collides(aabb)) {
+			visitor(proxy.body, proxy.shape);
+		}
+	}
+}
+
+auto SweepAndPruneCollisionSystem::firstEndpointReaching(float x) const -> std::vector<Endpoint>::const_iterator {
+	// No aabb is wider than maxAabbWidth so the ones that start before this can't reach x.
+	return std::lower_bound(endpoints[0].begin(), endpoints[0].end(), x - maxAabbWidth, [](const Endpoint& e, float value) { return e.value < value; });
+}
+
+auto SweepAndPruneCollisionSystem::endpointLess(const Endpoint& a, const Endpoint& b) -> bool {
+	if (a.value != b.value)
+		return a.value < b.value;
+	return (a.proxyAndIsMax & MAX_BIT) < (b.proxyAndIsMax & MAX_BIT);
+}
+
+auto SweepAndPruneCollisionSystem::addProxies(BodyId bodyId) -> void {
+	const auto body = ent.body.get(bodyId);
+	if (!body.has_value()) {
+		ASSERT_NOT_REACHED();
+		return;
+	}
+
+	for (i32 shape = 0; shape < shapeCount(body->collider); shape++) {
+		u32 index;
+		if (freeProxies.empty()) {
+			index = static_cast<u32>(proxies.size());
+			proxies.push_back(Proxy{ .aabb = Aabb{ Vec2{ 0.0f }, Vec2{ 0.0f } } });
+		} else {
+			index = freeProxies.back();
+			freeProxies.pop_back();
+		}
+		auto& proxy = proxies[index];
+		proxy.body = bodyId;
+		proxy.shape = shape;
+		proxy.aabb = fatAabb(*body, shape, 0.0f);
+		proxy.used = true;
+		maxAabbWidth = std::max(maxAabbWidth, proxy.aabb.size().x);
+		for (i32 axis = 0; axis < AXES; axis++) {
+			for (const auto isMax : { false, true }) {
+				proxy.endpoints[axis][isMax] = static_cast<u32>(endpoints[axis].size());
+				endpoints[axis].push_back(Endpoint{ endpointValue(proxy, axis, isMax), index | (isMax ? MAX_BIT : 0) });
+			}
+		}
+		newProxyCount++;
+	}
+}
+
+auto SweepAndPruneCollisionSystem::endpointValue(const Proxy& proxy, i32 axis, bool isMax) const -> float {
+	const auto& corner = isMax ? proxy.aabb.max : proxy.aabb.min;
+	return axis == 0 ? corner.x : corner.y;
+}
+
+auto SweepAndPruneCollisionSystem::updateEndpointValues(u32 proxyIndex) -> void {
+	const auto& proxy = proxies[proxyIndex];
+	maxAabbWidth = std::max(maxAabbWidth, proxy.aabb.size().x);
+	for (i32 axis = 0; axis < AXES; axis++) {
+		for (const auto isMax : { false, true }) {
+			endpoints[axis][proxy.endpoints[axis][isMax]].value = endpointValue(proxy, axis, isMax);
+		}
+	}
+}
+
+auto SweepAndPruneCollisionSystem::sortEndpoints(i32 axis) -> void {
+	auto& axisEndpoints = endpoints[axis];
+	for (usize i = 1; i < axisEndpoints.size(); i++) {
+		const auto moved = axisEndpoints[i];
+		const auto movedProxy = moved.proxyAndIsMax & ~MAX_BIT;
+		const auto movedIsMax = (moved.proxyAndIsMax & MAX_BIT) != 0;
+		auto j = i;
+		while (j > 0 && endpointLess(moved, axisEndpoints[j - 1])) {
+			const auto& other = axisEndpoints[j - 1];
+			const auto otherProxy = other.proxyAndIsMax & ~MAX_BIT;
+			const auto otherIsMax = (other.proxyAndIsMax & MAX_BIT) != 0;
+			// A min end passing a max end to the left means the ranges on this axis started overlapping and a max passing a min means they stopped. The pair is only added if the aabbs also overlap on the other axis.
+			if (!movedIsMax && otherIsMax) {
+				if (proxies[movedProxy].aabb.collides(proxies[otherProxy].aabb)) {
+					addPair(movedProxy, otherProxy);
+				}
+			} else if (movedIsMax && !otherIsMax) {
+				removePair(movedProxy, otherProxy);
+			}
+			axisEndpoints[j] = other;
+			proxies[otherProxy].endpoints[axis][otherIsMax] = static_cast<u32>(j);
+			j--;
+		}
+		axisEndpoints[j] = moved;
+		proxies[movedProxy].endpoints[axis][movedIsMax] = static_cast<u32>(j);
+	}
+}
+
+auto SweepAndPruneCollisionSystem::rebuild() -> void {
+	for (i32 axis = 0; axis < AXES; axis++) {
+		auto& axisEndpoints = endpoints[axis];
+		std::sort(axisEndpoints.begin(), axisEndpoints.end(), endpointLess);
+		for (u32 i = 0; i < axisEndpoints.size(); i++) {
+			const auto& e = axisEndpoints[i];
+			proxies[e.proxyAndIsMax & ~MAX_BIT].endpoints[axis][(e.proxyAndIsMax & MAX_BIT) ? 1 : 0] = i;
+		}
+	}
+
+	maxAabbWidth = 0.0f;
+	for (const auto& proxy : proxies) {
+		if (proxy.used) {
+			maxAabbWidth = std::max(maxAabbWidth, proxy.aabb.size().x);
+		}
+	}
+
+	overlappingPairs.clear();
+	pairsChanged = true;
+	// The proxies whose x range contains the current position of the sweep.
+	sweepActiveProxies.clear();
+	for (const auto& e : endpoints[0]) {
+		const auto proxy = e.proxyAndIsMax & ~MAX_BIT;
+		if (e.proxyAndIsMax & MAX_BIT) {
+			const auto it = std::find(sweepActiveProxies.begin(), sweepActiveProxies.end(), proxy);
+			*it = sweepActiveProxies.back();
+			sweepActiveProxies.pop_back();
+			continue;
+		}
+		for (const auto active : sweepActiveProxies) {
+			if (proxies[proxy].aabb.collides(proxies[active].aabb)) {
+				addPair(proxy, active);
+			}
+		}
+		sweepActiveProxies.push_back(proxy);
+	}
+}
+
+auto SweepAndPruneCollisionSystem::addPair(u32 proxyA, u32 proxyB) -> void {
+	const auto& a = proxies[proxyA];
+	const auto& b = proxies[proxyB];
+	if (overlappingPairs.insert(ShapePair{ a.body, a.shape, b.body, b.shape }).second) {
+		pairsChanged = true;
+	}
+}
+
+auto SweepAndPruneCollisionSystem::removePair(u32 proxyA, u32 proxyB) -> void {
+	const auto& a = proxies[proxyA];
+	const auto& b = proxies[proxyB];
+	if (overlappingPairs.erase(ShapePair{ a.body, a.shape, b.body, b.shape }) != 0) {
+		pairsChanged = true;
+	}
+}
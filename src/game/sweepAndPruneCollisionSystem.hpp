@@ -0,0 +1,69 @@
+#pragma once
+
+#include <game/broadphase.hpp>
+
+#include <unordered_set>
+
+// Keeps the ends of the aabbs sorted along both axes and the set of overlapping pairs between steps. The bodies only move a bit every step so the arrays are almost sorted and an insertion sort fixes them in close to linear time. Every swap of a min and a max end is an event that adds or removes a pair so the pairs don't need to be found again every step.
+// Works best when the bodies mostly move along one axis, like on conveyors or along long lines, because then few ends swap on the other axis. Bodies falling through a column of other bodies swap with each of them.
+class SweepAndPruneCollisionSystem : public Broadphase {
+public:
+	auto update() -> void override;
+	auto reset() -> void override;
+	auto reload() -> void override;
+	auto updateBvh(float dt, PhysicsProfile& profile) -> void override;
+	auto detectCollisions(float dt, CollisionMap& collisions, const IgnoredCollisions& collisionsToIgnore, JobSystem& jobSystem, PhysicsProfile& profile) -> void override;
+
+	// Like BvhCollisionSystem::BULK_BUILD_MIN_NEW_LEAVES. Inserting many bodies by sorting is quadratic so the arrays are sorted and swept from scratch instead.
+	static constexpr i32 BULK_BUILD_MIN_NEW_BODIES = 64;
+
+protected:
+	// Go over the min ends along the x axis from the first one that can reach the query until the end of the ray. A single very wide aabb, like the ground, makes them go over almost all the ends.
+	auto visitRay(Vec2 start, Vec2 end, Vec2 halfSize, const RayVisitor& visitor) const -> void override;
+	auto visitAabb(const Aabb& aabb, const std::function<void(BodyId body, i32 shape)>& visitor) const -> void override;
+
+private:
+	static constexpr i32 AXES = 2;
+	struct Proxy {
+		BodyId body;
+		i32 shape;
+		Aabb aabb;
+		// The indices of the ends in endpoints for each axis. The min end is first.
+		u32 endpoints[AXES][2];
+		bool used;
+	};
+	std::vector<Proxy> proxies;
+	std::vector<u32> freeProxies;
+
+	struct Endpoint {
+		float value;
+		// The index of the proxy with MAX_BIT set for max ends.
+		u32 proxyAndIsMax;
+	};
+	static constexpr u32 MAX_BIT = 1u << 31;
+	// When the values are equal the min ends go before the max ends so touching aabbs overlap like in Aabb::collides.
+	static auto endpointLess(const Endpoint& a, const Endpoint& b) -> bool;
+	std::vector<Endpoint> endpoints[AXES];
+	// Only grows between rebuilds so it is always at least the width of the widest aabb.
+	float maxAabbWidth = 0.0f;
+	auto firstEndpointReaching(float x) const -> std::vector<Endpoint>::const_iterator;
+
+	// Adds a proxy for every shape of the body.
+	auto addProxies(BodyId body) -> void;
+	auto endpointValue(const Proxy& proxy, i32 axis, bool isMax) const -> float;
+	auto updateEndpointValues(u32 proxyIndex) -> void;
+	// Sorts the endpoints using insertion sort and updates the pairs.
+	auto sortEndpoints(i32 axis) -> void;
+	// Sorts the endpoints using std::sort and finds the pairs by sweeping along the x axis.
+	auto rebuild() -> void;
+	std::vector<u32> sweepActiveProxies;
+	i32 newProxyCount = 0;
+
+	auto addPair(u32 proxyA, u32 proxyB) -> void;
+	auto removePair(u32 proxyA, u32 proxyB) -> void;
+	// All the pairs with overlapping aabbs, including the ones between static bodies.
+	std::unordered_set<ShapePair, ShapePairHasher> overlappingPairs;
+	// The overlapping pairs in the order of the CollisionMap. Only sorted again after the pairs change.
+	std::vector<ShapePair> sortedPairs;
+	bool pairsChanged = true;
+};
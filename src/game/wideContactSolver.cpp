@@ -0,0 +1,155 @@
+#include <game/wideContactSolver.hpp>
+#include <utils/simd.hpp>
+
+static constexpr i32 LANES = FloatWide::LANES;
+
+// The values of up to LANES contacts transposed so each row can be loaded into a FloatWide. The unused lanes and the missing points of collisions with one point are left as zeros, which makes all their impulses zero.
+struct ContactLanes {
+	enum Body {
+		VEL_X, VEL_Y, ANGULAR_VEL, INV_MASS, INV_ROTATIONAL_INERTIA, BODY_FIELD_COUNT
+	};
+	enum Point {
+		R1_X, R1_Y, R2_X, R2_Y, INV_NORMAL_EFFECTIVE_MASS, INV_TANGENT_EFFECTIVE_MASS, BIAS, ACCUMULATED_NORMAL_IMPULSE, ACCUMULATED_TANGENT_IMPULSE, POINT_FIELD_COUNT
+	};
+
+	alignas(32) float a[BODY_FIELD_COUNT][LANES]{};
+	alignas(32) float b[BODY_FIELD_COUNT][LANES]{};
+	alignas(32) float normalX[LANES]{};
+	alignas(32) float normalY[LANES]{};
+	alignas(32) float coefficientOfFriction[LANES]{};
+	alignas(32) float points[2][POINT_FIELD_COUNT][LANES]{};
+};
+
+struct BodyLanes {
+	FloatWide velX, velY, angularVel, invMass, invRotationalInertia;
+};
+
+static auto gatherBody(const SolverBody& body, float (&lanes)[ContactLanes::BODY_FIELD_COUNT][LANES], i32 lane) -> void {
+	lanes[ContactLanes::VEL_X][lane] = body.vel.x;
+	lanes[ContactLanes::VEL_Y][lane] = body.vel.y;
+	lanes[ContactLanes::ANGULAR_VEL][lane] = body.angularVel;
+	lanes[ContactLanes::INV_MASS][lane] = body.invMass;
+	lanes[ContactLanes::INV_ROTATIONAL_INERTIA][lane] = body.invRotationalInertia;
+}
+
+static auto loadBody(const float (&lanes)[ContactLanes::BODY_FIELD_COUNT][LANES]) -> BodyLanes {
+	return BodyLanes{
+		.velX = FloatWide::load(lanes[ContactLanes::VEL_X]),
+		.velY = FloatWide::load(lanes[ContactLanes::VEL_Y]),
+		.angularVel = FloatWide::load(lanes[ContactLanes::ANGULAR_VEL]),
+		.invMass = FloatWide::load(lanes[ContactLanes::INV_MASS]),
+		.invRotationalInertia = FloatWide::load(lanes[ContactLanes::INV_ROTATIONAL_INERTIA]),
+	};
+}
+
+static auto storeBody(const BodyLanes& body, float (&lanes)[ContactLanes::BODY_FIELD_COUNT][LANES]) -> void {
+	body.velX.store(lanes[ContactLanes::VEL_X]);
+	body.velY.store(lanes[ContactLanes::VEL_Y]);
+	body.angularVel.store(lanes[ContactLanes::ANGULAR_VEL]);
+}
+
+static auto scatterBody(const float (&lanes)[ContactLanes::BODY_FIELD_COUNT][LANES], i32 lane, SolverBody& body) -> void {
+	body.vel.x = lanes[ContactLanes::VEL_X][lane];
+	body.vel.y = lanes[ContactLanes::VEL_Y][lane];
+	body.angularVel = lanes[ContactLanes::ANGULAR_VEL][lane];
+}
+
+auto solveContactsWide(std::span<const SolverConstraint<Collision>> contacts, std::span<SolverBody> bodies) -> void {
+	for (usize first = 0; first < contacts.size(); first += LANES) {
+		const auto laneCount = static_cast<i32>(std::min(static_cast<usize>(LANES), contacts.size() - first));
+		ContactLanes lanes;
+		for (i32 lane = 0; lane < laneCount; lane++) {
+			const auto& [collision, bodyA, bodyB] = contacts[first + lane];
+			gatherBody(bodies[bodyA], lanes.a, lane);
+			gatherBody(bodies[bodyB], lanes.b, lane);
+			lanes.normalX[lane] = collision->normal.x;
+			lanes.normalY[lane] = collision->normal.y;
+			lanes.coefficientOfFriction[lane] = collision->coefficientOfFriction;
+			for (i32 point = 0; point < collision->contactCount; point++) {
+				const auto& p = collision->contacts[point];
+				auto& pointLanes = lanes.points[point];
+				pointLanes[ContactLanes::R1_X][lane] = p.r1.x;
+				pointLanes[ContactLanes::R1_Y][lane] = p.r1.y;
+				pointLanes[ContactLanes::R2_X][lane] = p.r2.x;
+				pointLanes[ContactLanes::R2_Y][lane] = p.r2.y;
+				pointLanes[ContactLanes::INV_NORMAL_EFFECTIVE_MASS][lane] = p.invNormalEffectiveMass;
+				pointLanes[ContactLanes::INV_TANGENT_EFFECTIVE_MASS][lane] = p.invTangentEffectiveMass;
+				pointLanes[ContactLanes::BIAS][lane] = p.bias;
+				pointLanes[ContactLanes::ACCUMULATED_NORMAL_IMPULSE][lane] = p.accumulatedNormalImpluse;
+				pointLanes[ContactLanes::ACCUMULATED_TANGENT_IMPULSE][lane] = p.accumulatedTangentImpulse;
+			}
+		}
+
+		auto a = loadBody(lanes.a);
+		auto b = loadBody(lanes.b);
+		const auto normalX = FloatWide::load(lanes.normalX);
+		const auto normalY = FloatWide::load(lanes.normalY);
+		const auto coefficientOfFriction = FloatWide::load(lanes.coefficientOfFriction);
+		// cross(normal, 1.0f)
+		const auto tangentX = normalY;
+		const auto tangentY = -normalX;
+		const auto zero = FloatWide::splat(0.0f);
+
+		// The operations are written in the same order as in Collision::applyImpulse so the results are exactly the same. For example cross(w, r).x is -w * r.y so adding it is the same as subtracting w * r.y.
+		for (i32 point = 0; point < 2; point++) {
+			auto& pointLanes = lanes.points[point];
+			const auto r1X = FloatWide::load(pointLanes[ContactLanes::R1_X]);
+			const auto r1Y = FloatWide::load(pointLanes[ContactLanes::R1_Y]);
+			const auto r2X = FloatWide::load(pointLanes[ContactLanes::R2_X]);
+			const auto r2Y = FloatWide::load(pointLanes[ContactLanes::R2_Y]);
+			const auto invNormalEffectiveMass = FloatWide::load(pointLanes[ContactLanes::INV_NORMAL_EFFECTIVE_MASS]);
+			const auto invTangentEffectiveMass = FloatWide::load(pointLanes[ContactLanes::INV_TANGENT_EFFECTIVE_MASS]);
+			const auto bias = FloatWide::load(pointLanes[ContactLanes::BIAS]);
+			auto accumulatedNormalImpulse = FloatWide::load(pointLanes[ContactLanes::ACCUMULATED_NORMAL_IMPULSE]);
+			auto accumulatedTangentImpulse = FloatWide::load(pointLanes[ContactLanes::ACCUMULATED_TANGENT_IMPULSE]);
+
+			auto applyImpulse = [&](FloatWide impulseX, FloatWide impulseY) {
+				a.velX = a.velX - a.invMass * impulseX;
+				a.velY = a.velY - a.invMass * impulseY;
+				a.angularVel = a.angularVel - a.invRotationalInertia * (r1X * impulseY - r1Y * impulseX);
+				b.velX = b.velX + b.invMass * impulseX;
+				b.velY = b.velY + b.invMass * impulseY;
+				b.angularVel = b.angularVel + b.invRotationalInertia * (r2X * impulseY - r2Y * impulseX);
+			};
+
+			{
+				const auto relativeVelX = (b.velX - b.angularVel * r2Y) - (a.velX - a.angularVel * r1Y);
+				const auto relativeVelY = (b.velY + b.angularVel * r2X) - (a.velY + a.angularVel * r1X);
+				const auto velocityAlongNormal = relativeVelX * normalX + relativeVelY * normalY;
+				auto normalImpulse = invNormalEffectiveMass * (-velocityAlongNormal + bias);
+				const auto oldNormalImpulse = accumulatedNormalImpulse;
+				accumulatedNormalImpulse = max(oldNormalImpulse + normalImpulse, zero);
+				normalImpulse = accumulatedNormalImpulse - oldNormalImpulse;
+				applyImpulse(normalImpulse * normalX, normalImpulse * normalY);
+			}
+			{
+				const auto relativeVelX = ((b.velX - b.angularVel * r2Y) - a.velX) + a.angularVel * r1Y;
+				const auto relativeVelY = ((b.velY + b.angularVel * r2X) - a.velY) - a.angularVel * r1X;
+				const auto velocityAlongTangent = relativeVelX * tangentX + relativeVelY * tangentY;
+				auto tangentImpulse = invTangentEffectiveMass * -velocityAlongTangent;
+				const auto maxImpulse = coefficientOfFriction * accumulatedNormalImpulse;
+				const auto oldTangentImpulse = accumulatedTangentImpulse;
+				// std::clamp(x, -max, max)
+				accumulatedTangentImpulse = min(max(oldTangentImpulse + tangentImpulse, -maxImpulse), maxImpulse);
+				tangentImpulse = accumulatedTangentImpulse - oldTangentImpulse;
+				applyImpulse(tangentImpulse * tangentX, tangentImpulse * tangentY);
+			}
+
+			accumulatedNormalImpulse.store(pointLanes[ContactLanes::ACCUMULATED_NORMAL_IMPULSE]);
+			accumulatedTangentImpulse.store(pointLanes[ContactLanes::ACCUMULATED_TANGENT_IMPULSE]);
+		}
+
+		storeBody(a, lanes.a);
+		storeBody(b, lanes.b);
+		for (i32 lane = 0; lane < laneCount; lane++) {
+			const auto& [collision, bodyA, bodyB] = contacts[first + lane];
+			scatterBody(lanes.a, lane, bodies[bodyA]);
+			scatterBody(lanes.b, lane, bodies[bodyB]);
+			for (i32 point = 0; point < collision->contactCount; point++) {
+				auto& p = collision->contacts[point];
+				p.accumulatedNormalImpluse = lanes.points[point][ContactLanes::ACCUMULATED_NORMAL_IMPULSE][lane];
+				p.accumulatedTangentImpulse = lanes.points[point][ContactLanes::ACCUMULATED_TANGENT_IMPULSE][lane];
+			}
+		}
+	}
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <game/physicsWorld.hpp>
+#include <span>
+
+// Solves the contacts FloatWide::LANES at a time. The contacts are gathered into lanes, one collision per lane, and the points of the collisions are solved in order like in Collision::applyImpulse, so the result is the same as calling applyImpulse on the contacts one after another.
+// The contacts can't share any bodies, because the lanes are solved at the same time. The contacts of a single graph color satisfy this. Only supports PhysicsWorld::accumulateImpulses.
+auto solveContactsWide(std::span<const SolverConstraint<Collision>> contacts, std::span<SolverBody> bodies) -> void;
@@ -1,4 +1,7 @@
 #include <math/aabb.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 Aabb::Aabb(Vec2 min, Vec2 max)
 	: min{ min }
@@ -77,6 +80,11 @@ auto Aabb::area() const -> float {
 	return s.x * s.y;
 }
 
+auto Aabb::perimeter() const -> float {
+	const auto s = size();
+	return 2.0f * (s.x + s.y);
+}
+
 auto Aabb::collides(const Aabb& other) const -> bool {
 	return min.x <= other.max.x && max.x >= other.min.x
 		&& min.y <= other.max.y && max.y >= other.min.y;
@@ -103,6 +111,30 @@ auto Aabb::rayHits(Vec2 start, Vec2 end) const -> bool {
 	return true;
 }
 
+auto Aabb::rayEntryT(Vec2 start, Vec2 invDir, float maxT) const -> float {
+	const auto infinity = std::numeric_limits<float>::infinity();
+	auto tMin = 0.0f;
+	auto tMax = maxT;
+	for (i32 axis = 0; axis < 2; axis++) {
+		// Multiplying by infinity gives NaN when start is on the boundary so parallel rays are handled separately.
+		if (std::isinf(invDir[axis])) {
+			if (start[axis] < min[axis] || start[axis] > max[axis])
+				return infinity;
+			continue;
+		}
+		auto t0 = (min[axis] - start[axis]) * invDir[axis];
+		auto t1 = (max[axis] - start[axis]) * invDir[axis];
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
+		tMin = std::max(tMin, t0);
+		tMax = std::min(tMax, t1);
+		if (tMin > tMax)
+			return infinity;
+	}
+	return tMin;
+}
+
 auto Aabb::center() const -> Vec2 {
 	return min + (max - min) / 2.0f;
 }
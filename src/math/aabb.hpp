@@ -19,8 +19,12 @@ struct Aabb {
 	auto extended(Vec2 point) const -> Aabb;
 	auto addedPadding(float padding) const -> Aabb;
 	auto area() const -> float;
+	// The 2D equivalent of the surface area used by the surface area heuristic. Unlike the area it isn't zero for thin boxes, like the ones of horizontal or vertical lines.
+	auto perimeter() const -> float;
 	auto collides(const Aabb& other) const -> bool;
 	auto rayHits(Vec2 start, Vec2 end) const -> bool;
+	// Returns the t at which the segment start + dir * t enters the aabb or infinity if it misses it before maxT. Returns 0 if start is inside. invDir is 1 / dir, which the traversals compute once per ray. The zero components of dir are infinities.
+	auto rayEntryT(Vec2 start, Vec2 invDir, float maxT) const -> float;
 	auto center() const->Vec2;
 	auto getCorners() const->std::array<Vec2, 4>;
 
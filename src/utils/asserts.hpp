@@ -1,8 +1,12 @@
 #pragma once
 
 #ifdef _DEBUG
+#ifdef _MSC_VER
 #define ASSERT(expr) do { if (!(expr)) { __debugbreak(); } } while (false)
 #else
+#define ASSERT(expr) do { if (!(expr)) { __builtin_trap(); } } while (false)
+#endif
+#else
 #define ASSERT(expr)
 #endif 
 
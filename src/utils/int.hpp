@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 using u8 = uint8_t;
 using u16 = uint16_t;
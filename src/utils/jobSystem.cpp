@@ -0,0 +1,139 @@
+#include <utils/jobSystem.hpp>
+
+#include <algorithm>
+#include <optional>
+
+JobSystem::JobSystem(i32 threadCount)
+	: threadCount_{ std::max(threadCount, 1) } {
+	startWorkers();
+}
+
+JobSystem::~JobSystem() {
+	stopWorkers();
+}
+
+auto JobSystem::setThreadCount(i32 threadCount) -> void {
+	threadCount = std::max(threadCount, 1);
+	if (threadCount == threadCount_)
+		return;
+
+	stopWorkers();
+	threadCount_ = threadCount;
+	startWorkers();
+}
+
+auto JobSystem::parallelFor(i32 count, const std::function<void(i32 index, i32 threadIndex)>& job) -> void {
+	if (count <= 0)
+		return;
+
+	if (threadCount_ == 1 || count == 1) {
+		for (i32 i = 0; i < count; i++) {
+			job(i, 0);
+		}
+		return;
+	}
+
+	// A few ranges per thread so there is something left to steal when the jobs take different amounts of time.
+	const auto rangeSize = std::max(count / (threadCount_ * 4), 1);
+	const auto rangeCount = (count + rangeSize - 1) / rangeSize;
+
+	currentJob = &job;
+	rangesLeft.store(rangeCount);
+	for (i32 i = 0; i < rangeCount; i++) {
+		const Range range{ i * rangeSize, std::min((i + 1) * rangeSize, count) };
+		auto& queue = *queues[i % threadCount_];
+		std::lock_guard lock{ queue.mutex };
+		queue.ranges.push_back(range);
+	}
+
+	{
+		std::lock_guard lock{ wakeMutex };
+		generation++;
+	}
+	wakeCondition.notify_all();
+
+	runRanges(0);
+	// The ranges taken by the other threads might still be running.
+	while (rangesLeft.load() != 0) {
+		std::this_thread::yield();
+	}
+	currentJob = nullptr;
+}
+
+auto JobSystem::startWorkers() -> void {
+	stopping = false;
+	queues.clear();
+	for (i32 i = 0; i < threadCount_; i++) {
+		queues.push_back(std::make_unique<Queue>());
+	}
+	// The thread with index 0 is the thread calling parallelFor.
+	for (i32 i = 1; i < threadCount_; i++) {
+		workers.emplace_back([this, i] { workerMain(i); });
+	}
+}
+
+auto JobSystem::stopWorkers() -> void {
+	{
+		std::lock_guard lock{ wakeMutex };
+		stopping = true;
+		generation++;
+	}
+	wakeCondition.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+auto JobSystem::workerMain(i32 threadIndex) -> void {
+	u64 lastGeneration = 0;
+	{
+		std::lock_guard lock{ wakeMutex };
+		lastGeneration = generation;
+	}
+
+	for (;;) {
+		{
+			std::unique_lock lock{ wakeMutex };
+			// Checking stopping too, because the worker might have started after the generation was changed by stopWorkers.
+			wakeCondition.wait(lock, [&] { return stopping || generation != lastGeneration; });
+			if (stopping)
+				return;
+			lastGeneration = generation;
+		}
+		runRanges(threadIndex);
+	}
+}
+
+auto JobSystem::runRanges(i32 threadIndex) -> void {
+	while (const auto range = takeRange(threadIndex)) {
+		// currentJob was set before the range was pushed under the queue mutex so it is visible here.
+		for (i32 i = range->begin; i < range->end; i++) {
+			(*currentJob)(i, threadIndex);
+		}
+		rangesLeft.fetch_sub(1);
+	}
+}
+
+auto JobSystem::takeRange(i32 threadIndex) -> std::optional<Range> {
+	{
+		auto& queue = *queues[threadIndex];
+		std::lock_guard lock{ queue.mutex };
+		if (!queue.ranges.empty()) {
+			const auto range = queue.ranges.back();
+			queue.ranges.pop_back();
+			return range;
+		}
+	}
+
+	for (i32 i = 1; i < threadCount_; i++) {
+		auto& queue = *queues[(threadIndex + i) % threadCount_];
+		std::lock_guard lock{ queue.mutex };
+		if (!queue.ranges.empty()) {
+			const auto range = queue.ranges.front();
+			queue.ranges.pop_front();
+			return range;
+		}
+	}
+	return std::nullopt;
+}
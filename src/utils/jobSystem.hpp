@@ -0,0 +1,59 @@
+#pragma once
+
+#include <utils/int.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs jobs on a fixed set of worker threads. Every thread has its own queue of jobs. A thread first takes jobs from the back of its own queue and when it runs out it steals from the front of the other queues, so the threads that finish early help the ones that got the expensive jobs.
+// The thread calling parallelFor also runs jobs and it is counted in the thread count, so with 1 thread everything runs on the calling thread in order.
+class JobSystem {
+public:
+	explicit JobSystem(i32 threadCount = 1);
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	auto operator=(const JobSystem&) -> JobSystem& = delete;
+
+	// Can't be called from inside a job.
+	auto setThreadCount(i32 threadCount) -> void;
+	auto threadCount() const -> i32 { return threadCount_; }
+
+	// Calls job(index, threadIndex) for every index in [0, count) and waits for all of them to finish. threadIndex is in [0, threadCount()) and can be used to index per thread data. The jobs can run in any order so they shouldn't depend on each other.
+	auto parallelFor(i32 count, const std::function<void(i32 index, i32 threadIndex)>& job) -> void;
+
+private:
+	struct Range {
+		i32 begin;
+		i32 end;
+	};
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Range> ranges;
+	};
+
+	auto startWorkers() -> void;
+	auto stopWorkers() -> void;
+	auto workerMain(i32 threadIndex) -> void;
+	// Returns when there are no more ranges to take. Other threads might still be running their last ranges.
+	auto runRanges(i32 threadIndex) -> void;
+	auto takeRange(i32 threadIndex) -> std::optional<Range>;
+
+	i32 threadCount_;
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<Queue>> queues;
+
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+	u64 generation = 0;
+	bool stopping = false;
+
+	const std::function<void(i32, i32)>* currentJob = nullptr;
+	std::atomic<i32> rangesLeft = 0;
+};
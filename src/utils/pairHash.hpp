@@ -1,12 +1,33 @@
 #pragma once
 
+#include <utils/int.hpp>
 #include <algorithm>
+#include <functional>
+
+// The finalizer from splitmix64. Every bit of the input affects every bit of the output so it can be used on keys that only differ in a few low bits like indices.
+// Multiplying the hashes of the elements isn't a good way to combine them. Multiplying by zero always gives zero and (a, b) and (c, d) collide whenever a * b == c * d. Also the std::hash of an integer is just the identity in most implementations.
+inline auto hashMix64(u64 x) -> u64 {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+inline auto hashPair(u32 a, u32 b) -> u64 {
+	return hashMix64((static_cast<u64>(a) << 32) | b);
+}
+
+inline auto hashCombine(u64 a, u64 b) -> u64 {
+	return hashMix64(a ^ (b + 0x9e3779b97f4a7c15ull + (a << 6) + (a >> 2)));
+}
 
 // https://stackoverflow.com/questions/20590656/error-for-hash-function-of-pair-of-ints
 struct PairHash {
     template <typename T, typename U>
     auto operator()(const std::pair<T, U>& x) const -> size_t {
-        return std::hash<T>{}(x.first) * std::hash<U>{}(x.second);
+        return static_cast<size_t>(hashCombine(std::hash<T>{}(x.first), std::hash<U>{}(x.second)));
     }
 };
 
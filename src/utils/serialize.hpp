@@ -2,6 +2,8 @@
 
 #include <../thirdParty/json/JsonValue.hpp>
 
+#include <vector>
+
 template<typename T>
 auto vecToJson(const std::vector<T>& v) -> Json::Value {
 	auto result = Json::Value::emptyArray();
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <utils/int.hpp>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PHYSICS_ENGINE_SSE
+#endif
+
+// A float for every lane. Uses 8 lanes with AVX, 4 with SSE and a plain array of 4 floats on other architectures so the code using it compiles everywhere.
+// Only has the operations needed by the solver. None of them use fused multiply add, so every lane computes exactly the same result as the scalar code with the same order of operations.
+struct FloatWide {
+#if defined(__AVX__)
+	static constexpr i32 LANES = 8;
+	__m256 v;
+
+	static auto load(const float* values) -> FloatWide { return { _mm256_load_ps(values) }; }
+	static auto splat(float value) -> FloatWide { return { _mm256_set1_ps(value) }; }
+	auto store(float* values) const -> void { _mm256_store_ps(values, v); }
+	auto operator+(FloatWide o) const -> FloatWide { return { _mm256_add_ps(v, o.v) }; }
+	auto operator-(FloatWide o) const -> FloatWide { return { _mm256_sub_ps(v, o.v) }; }
+	auto operator*(FloatWide o) const -> FloatWide { return { _mm256_mul_ps(v, o.v) }; }
+	auto operator-() const -> FloatWide { return { _mm256_xor_ps(v, _mm256_set1_ps(-0.0f)) }; }
+	// The same as std::max(a, b) and std::min(a, b) lane by lane. The argument order of the intrinsics matters for NaNs and signed zeros.
+	friend auto max(FloatWide a, FloatWide b) -> FloatWide { return { _mm256_max_ps(b.v, a.v) }; }
+	friend auto min(FloatWide a, FloatWide b) -> FloatWide { return { _mm256_min_ps(b.v, a.v) }; }
+#elif defined(PHYSICS_ENGINE_SSE)
+	static constexpr i32 LANES = 4;
+	__m128 v;
+
+	static auto load(const float* values) -> FloatWide { return { _mm_load_ps(values) }; }
+	static auto splat(float value) -> FloatWide { return { _mm_set1_ps(value) }; }
+	auto store(float* values) const -> void { _mm_store_ps(values, v); }
+	auto operator+(FloatWide o) const -> FloatWide { return { _mm_add_ps(v, o.v) }; }
+	auto operator-(FloatWide o) const -> FloatWide { return { _mm_sub_ps(v, o.v) }; }
+	auto operator*(FloatWide o) const -> FloatWide { return { _mm_mul_ps(v, o.v) }; }
+	auto operator-() const -> FloatWide { return { _mm_xor_ps(v, _mm_set1_ps(-0.0f)) }; }
+	// The same as std::max(a, b) and std::min(a, b) lane by lane. The argument order of the intrinsics matters for NaNs and signed zeros.
+	friend auto max(FloatWide a, FloatWide b) -> FloatWide { return { _mm_max_ps(b.v, a.v) }; }
+	friend auto min(FloatWide a, FloatWide b) -> FloatWide { return { _mm_min_ps(b.v, a.v) }; }
+#else
+	static constexpr i32 LANES = 4;
+	float v[LANES];
+
+	static auto load(const float* values) -> FloatWide {
+		FloatWide result;
+		for (i32 i = 0; i < LANES; i++) result.v[i] = values[i];
+		return result;
+	}
+	static auto splat(float value) -> FloatWide {
+		FloatWide result;
+		for (i32 i = 0; i < LANES; i++) result.v[i] = value;
+		return result;
+	}
+	auto store(float* values) const -> void {
+		for (i32 i = 0; i < LANES; i++) values[i] = v[i];
+	}
+	template<typename Op>
+	static auto map(FloatWide a, FloatWide b, Op op) -> FloatWide {
+		FloatWide result;
+		for (i32 i = 0; i < LANES; i++) result.v[i] = op(a.v[i], b.v[i]);
+		return result;
+	}
+	auto operator+(FloatWide o) const -> FloatWide { return map(*this, o, [](float a, float b) { return a + b; }); }
+	auto operator-(FloatWide o) const -> FloatWide { return map(*this, o, [](float a, float b) { return a - b; }); }
+	auto operator*(FloatWide o) const -> FloatWide { return map(*this, o, [](float a, float b) { return a * b; }); }
+	auto operator-() const -> FloatWide { return map(*this, *this, [](float a, float) { return -a; }); }
+	friend auto max(FloatWide a, FloatWide b) -> FloatWide { return map(a, b, [](float x, float y) { return (x < y) ? y : x; }); }
+	friend auto min(FloatWide a, FloatWide b) -> FloatWide { return map(a, b, [](float x, float y) { return (y < x) ? y : x; }); }
+#endif
+};
+
+#undef PHYSICS_ENGINE_SSE
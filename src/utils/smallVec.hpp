@@ -0,0 +1,187 @@
+#pragma once
+
+#include <utils/int.hpp>
+#include <utils/asserts.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+
+// Like StaticVec, but when it grows past INLINE_CAPACITY the elements are moved to the heap instead of asserting. Small vectors don't allocate and their elements are stored inside the object, so copying them doesn't allocate and reading them doesn't follow a pointer to somewhere else in memory.
+// Only for trivially copyable types, because the elements are copied with memcpy.
+template<typename T, usize INLINE_CAPACITY>
+class SmallVec {
+	static_assert(std::is_trivially_copyable_v<T>);
+	// The heap buffer is allocated as bytes.
+	static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+public:
+	SmallVec() = default;
+	SmallVec(std::initializer_list<T> values);
+	SmallVec(const SmallVec& other);
+	SmallVec(SmallVec&& other) noexcept;
+	auto operator=(const SmallVec& other) -> SmallVec&;
+	auto operator=(SmallVec&& other) noexcept -> SmallVec&;
+	~SmallVec();
+
+	auto push_back(const T& value) -> void;
+	auto pop_back() -> void;
+	auto erase(const T* position) -> T*;
+	auto clear() -> void;
+	auto resize(usize size, const T& value = T{}) -> void;
+	auto reserve(usize capacity) -> void;
+
+	auto data() -> T* { return heap_ == nullptr ? reinterpret_cast<T*>(inline_) : heap_; }
+	auto data() const -> const T* { return heap_ == nullptr ? reinterpret_cast<const T*>(inline_) : heap_; }
+	auto size() const -> usize { return size_; }
+	auto empty() const -> bool { return size_ == 0; }
+	// False if the elements were moved to the heap.
+	auto isInline() const -> bool { return heap_ == nullptr; }
+	auto operator[](usize i) -> T&;
+	auto operator[](usize i) const -> const T&;
+	auto back() -> T&;
+	auto back() const -> const T&;
+
+	auto begin() -> T* { return data(); }
+	auto end() -> T* { return data() + size_; }
+	auto begin() const -> const T* { return data(); }
+	auto end() const -> const T* { return data() + size_; }
+
+private:
+	// nullptr while the elements are stored in inline_.
+	T* heap_ = nullptr;
+	usize size_ = 0;
+	usize capacity_ = INLINE_CAPACITY;
+	alignas(T) u8 inline_[INLINE_CAPACITY * sizeof(T)];
+};
+
+template<typename T, usize INLINE_CAPACITY>
+SmallVec<T, INLINE_CAPACITY>::SmallVec(std::initializer_list<T> values) {
+	reserve(values.size());
+	std::memcpy(data(), values.begin(), values.size() * sizeof(T));
+	size_ = values.size();
+}
+
+template<typename T, usize INLINE_CAPACITY>
+SmallVec<T, INLINE_CAPACITY>::SmallVec(const SmallVec& other) {
+	*this = other;
+}
+
+template<typename T, usize INLINE_CAPACITY>
+SmallVec<T, INLINE_CAPACITY>::SmallVec(SmallVec&& other) noexcept {
+	*this = std::move(other);
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::operator=(const SmallVec& other) -> SmallVec& {
+	if (this == &other)
+		return *this;
+	size_ = 0;
+	reserve(other.size_);
+	std::memcpy(data(), other.data(), other.size_ * sizeof(T));
+	size_ = other.size_;
+	return *this;
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::operator=(SmallVec&& other) noexcept -> SmallVec& {
+	if (this == &other)
+		return *this;
+	if (other.heap_ == nullptr) {
+		return *this = static_cast<const SmallVec&>(other);
+	}
+	// The heap buffer can be taken instead of copying.
+	delete[] reinterpret_cast<u8*>(heap_);
+	heap_ = other.heap_;
+	size_ = other.size_;
+	capacity_ = other.capacity_;
+	other.heap_ = nullptr;
+	other.size_ = 0;
+	other.capacity_ = INLINE_CAPACITY;
+	return *this;
+}
+
+template<typename T, usize INLINE_CAPACITY>
+SmallVec<T, INLINE_CAPACITY>::~SmallVec() {
+	delete[] reinterpret_cast<u8*>(heap_);
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::push_back(const T& value) -> void {
+	if (size_ == capacity_) {
+		// The value might be an element of this vector so it is copied before reallocating.
+		const auto copy = value;
+		reserve(capacity_ * 2);
+		data()[size_] = copy;
+	} else {
+		data()[size_] = value;
+	}
+	size_++;
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::pop_back() -> void {
+	if (size_ == 0) {
+		ASSERT_NOT_REACHED();
+		return;
+	}
+	size_--;
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::erase(const T* position) -> T* {
+	const auto index = static_cast<usize>(position - data());
+	if (index >= size_) {
+		ASSERT_NOT_REACHED();
+		return end();
+	}
+	std::memmove(data() + index, data() + index + 1, (size_ - index - 1) * sizeof(T));
+	size_--;
+	return data() + index;
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::clear() -> void {
+	size_ = 0;
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::resize(usize size, const T& value) -> void {
+	reserve(size);
+	std::fill(data() + std::min(size, size_), data() + size, value);
+	size_ = size;
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::reserve(usize capacity) -> void {
+	if (capacity <= capacity_)
+		return;
+	// Allocated as bytes so T doesn't need to be default constructible.
+	const auto newHeap = reinterpret_cast<T*>(new u8[capacity * sizeof(T)]);
+	std::memcpy(newHeap, data(), size_ * sizeof(T));
+	delete[] reinterpret_cast<u8*>(heap_);
+	heap_ = newHeap;
+	capacity_ = capacity;
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::operator[](usize i) -> T& {
+	ASSERT(i < size_);
+	return data()[i];
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::operator[](usize i) const -> const T& {
+	ASSERT(i < size_);
+	return data()[i];
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::back() -> T& {
+	return (*this)[size_ - 1];
+}
+
+template<typename T, usize INLINE_CAPACITY>
+auto SmallVec<T, INLINE_CAPACITY>::back() const -> const T& {
+	return (*this)[size_ - 1];
+}
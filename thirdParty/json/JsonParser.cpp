@@ -4,6 +4,8 @@
 
 #include <optional>
 #include <charconv>
+#include <cstring>
+#include <limits>
 
 namespace
 {
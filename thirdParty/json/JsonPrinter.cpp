@@ -128,18 +128,18 @@ static void prettyPrintImplementation(std::ostream& os, const Json::Value& value
 			}
 			else
 			{
-				// std::unordered_map doesn't overload the subtraction operator so the decrement operator is used.
+				// std::unordered_map iterators aren't required to be bidirectional so the separator is printed before every element except the first.
 				os << "{\n";
-				for (auto it = value.object().cbegin(); it != (--value.object().cend()); it++)
+				for (auto it = value.object().cbegin(); it != value.object().cend(); it++)
 				{
+					if (it != value.object().cbegin())
+					{
+						os << ",\n";
+					}
 					printIndentation(os, depth);
 					os << '"' << it->first << "\": ";
 					prettyPrintImplementation(os, it->second, depth + 1);
-					os << ",\n";
 				}
-				printIndentation(os, depth);
-				os << '"' << (--value.object().cend())->first << "\": ";
-				prettyPrintImplementation(os, (--value.object().cend())->second, depth + 1);
 				os << "\n";
 
 				printIndentation(os, depth - 1);
@@ -195,16 +195,17 @@ static void printImplementation(std::ostream& os, const Json::Value& value)
 		}
 		else
 		{
-			// std::unordered_map doesn't overload the subtraction operator so the decrement operator is used.
+			// std::unordered_map iterators aren't required to be bidirectional so the separator is printed before every element except the first.
 			os << "{";
-			for (auto it = value.object().cbegin(); it != (--value.object().cend()); it++)
+			for (auto it = value.object().cbegin(); it != value.object().cend(); it++)
 			{
+				if (it != value.object().cbegin())
+				{
+					os << ',';
+				}
 				os << '"' << it->first << "\":";
 				printImplementation(os, it->second);
-				os << ',';
 			}
-			os << '"' << (--value.object().cend())->first << "\":";
-			printImplementation(os, (--value.object().cend())->second);
 			os << "}";
 		}
 		break;
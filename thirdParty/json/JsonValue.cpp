@@ -1,4 +1,4 @@
-#include "jsonValue.hpp"
+#include "JsonValue.hpp"
 #include <assert.h>
 
 Json::Value::Value()
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <unordered_map>
+#include <vector>
+#include <string>
 
 // Constructors and operators for const char* becuase without them it gets implicitly converted to bool.
 
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <algorithm>
 
 auto readFile(std::string_view path) -> std::optional<std::string> {
 	std::ifstream file(path.data(), std::ios::binary);
@@ -290,7 +291,7 @@ auto main() -> int {
 			auto cppPath = (dir / (name.string() + "Data.cpp"));
 			std::ofstream hpp(hppPath), cpp(cppPath);
 			const auto includePath = std::filesystem::relative(hppPath, srcPath);
-			outputConfFileCode(*conf, includePath.string(), hpp, cpp);
+			outputConfFileCode(*conf, includePath.generic_string(), hpp, cpp);
 		}
 	}
 }
\ No newline at end of file